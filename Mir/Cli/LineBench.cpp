@@ -0,0 +1,113 @@
+// getline based readLines against LineIndex on a generated file (or a given one). Lines are
+// compared before timing. Run twice for warm page cache numbers.
+//
+//   mir_line_bench [file] [--lines N] [--repeat N] [--threads N]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utils/LineIndex.h"
+#include "utils/Utils.h"
+
+namespace {
+    namespace File = Mir::Utils::File;
+
+    double timeMs(const std::function<void()>& run) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    double best(int repeat, const std::function<void()>& run) {
+        double result = 1e30;
+        for (int i = 0; i < repeat; i++) {
+            result = std::min(result, timeMs(run));
+        }
+        return result;
+    }
+
+    // Log like lines of varying length, every seventh one with a CRLF ending, no final newline
+    void writeSample(const std::filesystem::path& path, size_t count) {
+        std::ofstream out(path, std::ios::binary);
+        std::string line;
+        for (size_t i = 0; i < count; i++) {
+            line = "2024-05-01T12:00:" + std::to_string(i % 60) + " INFO worker-" + std::to_string(i % 16)
+                + " processed item " + std::to_string(i) + std::string(i % 50, '.');
+            out << line << (i + 1 == count ? "" : i % 7 == 0 ? "\r\n" : "\n");
+        }
+    }
+
+    size_t g_sink = 0; // keeps the optimizer from dropping unused results
+}
+
+int main(int argc, char const *argv[])
+{
+    std::filesystem::path path;
+    size_t lineCount = 2000000;
+    int repeat = 3;
+    size_t threadCount = 0;
+    int i = 1;
+    if (argc > 1 && argv[1][0] != '-') {
+        path = argv[1];
+        i = 2;
+    }
+    for (; i + 1 < argc; i += 2) {
+        std::string_view arg = argv[i];
+        if (arg == "--lines") {
+            lineCount = static_cast<size_t>(std::atoll(argv[i + 1]));
+        } else if (arg == "--repeat") {
+            repeat = std::max(1, std::atoi(argv[i + 1]));
+        } else if (arg == "--threads") {
+            threadCount = static_cast<size_t>(std::atoi(argv[i + 1]));
+        }
+    }
+    bool generated = path.empty();
+    if (generated) {
+        path = std::filesystem::temp_directory_path() / "mir_line_bench.txt";
+        writeSample(path, lineCount);
+    }
+
+    // Same lines first, a fast wrong result is no result
+    std::vector<std::string> expected;
+    {
+        std::ifstream file(path, std::ios::binary);
+        expected = File::readLines(file);
+    }
+    File::LineIndex index(path, threadCount);
+    size_t mismatches = index.size() != expected.size();
+    for (size_t line = 0; line < std::min(index.size(), expected.size()); line++) {
+        mismatches += index[line] != expected[line];
+    }
+    mismatches += File::readLines(path) != expected;
+    std::printf("%zu lines, %zu bytes, %zu mismatches\n", index.size(), index.getText().size(), mismatches);
+
+    double getline = best(repeat, [&] {
+        std::ifstream file(path, std::ios::binary);
+        g_sink += File::readLines(file).size();
+    });
+    double strings = best(repeat, [&] {
+        File::LineIndex lines(path, 1);
+        g_sink += std::vector<std::string>(lines.begin(), lines.end()).size();
+    });
+    double single = best(repeat, [&] { g_sink += File::LineIndex(path, 1).size(); });
+    double parallel = best(repeat, [&] { g_sink += File::LineIndex(path, threadCount).size(); });
+    std::printf("getline readLines    %9.2f ms\n", getline);
+    std::printf("LineIndex strings    %9.2f ms   speedup %5.2fx\n", strings, getline / strings);
+    std::printf("LineIndex 1 thread   %9.2f ms   speedup %5.2fx\n", single, getline / single);
+    std::printf("LineIndex parallel   %9.2f ms   speedup %5.2fx\n", parallel, getline / parallel);
+    std::printf("memory: %zu bytes of offsets vs about %zu in strings\n",
+        index.size() * sizeof(size_t), expected.size() * sizeof(std::string) + index.getText().size());
+
+    if (generated) {
+        index.close();
+        std::filesystem::remove(path);
+    }
+    std::fprintf(stderr, "(%zu)\n", g_sink);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+// Mir::Utils::Text (allocating) vs Mir::Utils::TextView (views and reused buffers) on
+// synthetic mapping file lines, and TextTemplate against repeated replacePlaceholderIf.
+// Results are compared before timing.
+//
+//   mir_text_bench [--lines N] [--repeat N] [--threads N]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utils/TextTemplate.h"
+#include "utils/TextView.h"
+#include "utils/Utils.h"
+
+namespace {
+    namespace Text = Mir::Utils::Text;
+    namespace TextView = Mir::Utils::TextView;
+
+    std::vector<std::string> makeLines(size_t count) {
+        static const char* kTypes[] = {"DI", "DO", "AI", "AO"};
+        std::vector<std::string> lines;
+        lines.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            lines.push_back(std::string("\"") + kTypes[i % 4] + "_{Module}_{Channel}\",Rack" + std::to_string(i % 7)
+                + ",\"Motor " + std::to_string(i) + " start, line " + std::to_string(i % 13) + "\",  slot-"
+                + std::to_string(i % 32) + "  ,{Signal}_" + std::to_string(i * 31 % 1000));
+        }
+        return lines;
+    }
+
+    double timeMs(const std::function<void()>& run) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    size_t g_sink = 0; // keeps the optimizer from dropping unused results
+
+    void compare(const char* name, int repeat, const std::function<void()>& owning, const std::function<void()>& view) {
+        double owningBest = 1e30;
+        double viewBest = 1e30;
+        for (int i = 0; i < repeat; i++) {
+            owningBest = std::min(owningBest, timeMs(owning));
+            viewBest = std::min(viewBest, timeMs(view));
+        }
+        std::printf("%-28s string %9.2f ms   view %9.2f ms   speedup %5.2fx\n",
+            name, owningBest, viewBest, owningBest / viewBest);
+    }
+
+    bool same(const std::vector<std::string>& a, const std::vector<std::string_view>& b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    size_t lineCount = 200000;
+    int repeat = 3;
+    size_t threadCount = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string_view arg = argv[i];
+        if (arg == "--lines") {
+            lineCount = static_cast<size_t>(std::atoll(argv[i + 1]));
+        } else if (arg == "--repeat") {
+            repeat = std::max(1, std::atoi(argv[i + 1]));
+        } else if (arg == "--threads") {
+            threadCount = static_cast<size_t>(std::atoi(argv[i + 1]));
+        }
+    }
+    std::vector<std::string> lines = makeLines(lineCount);
+
+    std::vector<std::string_view> views;
+    std::string buffer;
+    std::string second;
+    const TextView::CharSet spaces(" \t\"");
+
+    // Same answers first, a fast wrong result is no result
+    size_t mismatches = 0;
+    for (const std::string& line : lines) {
+        mismatches += !same(Text::findAllCleanString(line), (TextView::findAllCleanString(line, views), views));
+        mismatches += !same(Text::extractAllBetweenCurlyBraces(line), (TextView::extractAllBetweenCurlyBraces(line, views), views));
+        mismatches += Text::getFirstCleanString(line) != TextView::getFirstCleanString(line);
+        mismatches += Text::findCleanStringAt(line, 3) != TextView::findCleanStringAt(line, 3);
+        mismatches += Text::filterNumbers(line) != (TextView::filterNumbers(line, buffer), buffer);
+        mismatches += Text::removeCharactersFromStr(line, " \t\"") != (TextView::removeCharactersFromStr(line, spaces, buffer), buffer);
+        mismatches += Text::findIOdatatype(line) != TextView::findIOdatatype(line);
+        std::string replaced = line;
+        Text::replacePlaceholderIf(replaced, "Module", "M12");
+        mismatches += replaced != (TextView::replacePlaceholderIf(line, "Module", "M12", buffer), buffer);
+    }
+    std::printf("%zu lines, %zu mismatches\n", lines.size(), mismatches);
+
+    compare("splitAt", repeat,
+        [&] { for (const auto& line : lines) g_sink += Text::splitAt(line, ',').size(); },
+        [&] { for (const auto& line : lines) g_sink += TextView::splitAt(line, ',', views); });
+    compare("findAllCleanString", repeat,
+        [&] { for (const auto& line : lines) g_sink += Text::findAllCleanString(line).size(); },
+        [&] { for (const auto& line : lines) g_sink += TextView::findAllCleanString(line, views); });
+    compare("getFirstCleanString", repeat,
+        [&] { for (const auto& line : lines) g_sink += Text::getFirstCleanString(line).size(); },
+        [&] { for (const auto& line : lines) g_sink += TextView::getFirstCleanString(line).size(); });
+    compare("findCleanStringAt", repeat,
+        [&] { for (const auto& line : lines) g_sink += Text::findCleanStringAt(line, 3).size(); },
+        [&] { for (const auto& line : lines) g_sink += TextView::findCleanStringAt(line, 3).size(); });
+    compare("extractAllBetweenCurlyBraces", repeat,
+        [&] { for (const auto& line : lines) g_sink += Text::extractAllBetweenCurlyBraces(line).size(); },
+        [&] { for (const auto& line : lines) g_sink += TextView::extractAllBetweenCurlyBraces(line, views); });
+    compare("filterNumbers", repeat,
+        [&] { for (const auto& line : lines) g_sink += Text::filterNumbers(line).size(); },
+        [&] { for (const auto& line : lines) { TextView::filterNumbers(line, buffer); g_sink += buffer.size(); } });
+    compare("splitCharsFromNums", repeat,
+        [&] { for (const auto& line : lines) g_sink += Text::splitCharsFromNums(line).second.size(); },
+        [&] { for (const auto& line : lines) { TextView::splitCharsFromNums(line, buffer, second); g_sink += second.size(); } });
+    compare("removeCharactersFromStr", repeat,
+        [&] { for (const auto& line : lines) g_sink += Text::removeCharactersFromStr(line, " \t\"").size(); },
+        [&] { for (const auto& line : lines) { TextView::removeCharactersFromStr(line, spaces, buffer); g_sink += buffer.size(); } });
+    compare("findIOdatatype", repeat,
+        [&] { for (const auto& line : lines) g_sink += Text::findIOdatatype(line).size(); },
+        [&] { for (const auto& line : lines) g_sink += TextView::findIOdatatype(line).size(); });
+    compare("replacePlaceholderIf", repeat,
+        [&] { for (const auto& line : lines) { std::string copy = line; Text::replacePlaceholderIf(copy, "Module", "M12"); g_sink += copy.size(); } },
+        [&] { for (const auto& line : lines) { TextView::replacePlaceholderIf(line, "Module", "M12", buffer); g_sink += buffer.size(); } });
+
+    // Template rendering: one .typ style template, one row of values per generated line
+    const std::string source = "VAR_GLOBAL {Type}_{Module}_{Channel} AT %{Address} : BOOL; (* {Comment} *)";
+    Mir::Utils::TextTemplate tmpl(source);
+    std::vector<std::string> rowStorage;
+    rowStorage.reserve(lineCount * 5);
+    for (size_t i = 0; i < lineCount; i++) {
+        rowStorage.push_back(i % 2 ? "DI" : "DO");
+        rowStorage.push_back("M" + std::to_string(i % 40));
+        rowStorage.push_back(std::to_string(i % 16));
+        rowStorage.push_back("IX" + std::to_string(i / 8) + "." + std::to_string(i % 8));
+        rowStorage.push_back("Motor " + std::to_string(i));
+    }
+    std::vector<std::string_view> table(rowStorage.begin(), rowStorage.end());
+    auto renderOld = [&](size_t row, std::string& out) {
+        out = source;
+        for (size_t slot = 0; slot < 5; slot++) {
+            Text::replacePlaceholderIf(out, tmpl.getSlots()[slot], rowStorage[row * 5 + slot]);
+        }
+    };
+    std::string expected;
+    size_t templateMismatches = 0;
+    for (size_t row = 0; row < lineCount; row++) {
+        renderOld(row, expected);
+        tmpl.render(std::span(table).subspan(row * 5, 5), buffer);
+        templateMismatches += expected != buffer;
+    }
+    std::printf("template: %zu rows, %zu mismatches\n", lineCount, templateMismatches);
+    mismatches += templateMismatches;
+
+    std::vector<std::string> outputs;
+    compare("template render", repeat,
+        [&] { for (size_t row = 0; row < lineCount; row++) { renderOld(row, expected); g_sink += expected.size(); } },
+        [&] { for (size_t row = 0; row < lineCount; row++) { tmpl.render(std::span(table).subspan(row * 5, 5), buffer); g_sink += buffer.size(); } });
+    compare("template batch", repeat,
+        [&] { for (size_t row = 0; row < lineCount; row++) { renderOld(row, expected); g_sink += expected.size(); } },
+        [&] { tmpl.renderBatch(table, outputs, threadCount); g_sink += outputs.size(); });
+    compare("template joined", repeat,
+        [&] { std::string all; for (size_t row = 0; row < lineCount; row++) { renderOld(row, expected); all += expected; all += '\n'; } g_sink += all.size(); },
+        [&] { tmpl.renderJoined(table, "\n", buffer, threadCount); g_sink += buffer.size(); });
+
+    std::fprintf(stderr, "(%zu)\n", g_sink);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+// Scan and expansion timings on a MemoryFileSystem tree, so runs are repeatable and slow shares
+// can be reproduced with injected latency. The spec is the same as MIR_MEMORY_FS for the app.
+//
+//   mir_tree_bench [spec] [--repeat N] [--threads N] [--ignore "pattern,pattern"]
+//   mir_tree_bench depth=2,dirs=10,files=10000,call_us=20000,concurrency=4
+//   mir_tree_bench depth=3 --ignore "dir_0/,*.log"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string_view>
+#include <thread>
+
+#include "FileTree.h"
+#include "FileNodeVisitor.h"
+#include "MemoryFileSystem.h"
+
+namespace {
+    double timeMs(const std::function<void()>& run) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void report(const char* name, double ms, MemoryFileSystem& memory) {
+        MemoryFileSystem::Stats stats = memory.getStats();
+        std::printf("%-18s %10.2f ms   %7zu listings %9zu entries %9zu stats   %10.2f ms injected\n",
+            name, ms, stats.directoriesListed, stats.entriesListed, stats.stats, stats.injected.count() / 1000.0);
+        memory.resetStats();
+    }
+
+    // Opens every folder below the root at once and pumps like the renderer does each frame
+    double streamTopLevel(FileTree& tree, double& firstEntriesMs) {
+        firstEntriesMs = -1;
+        FileNode& root = *tree.getRootNode();
+        return timeMs([&] {
+            auto start = std::chrono::steady_clock::now();
+            for (const auto& child : root.children) {
+                tree.expandNodeAsync(child.get());
+            }
+            while (true) {
+                tree.pumpExpansions();
+                bool loading = false;
+                for (const auto& child : root.children) {
+                    loading |= child->isLoading;
+                    if (firstEntriesMs < 0 && !child->children.empty()) {
+                        firstEntriesMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                    }
+                }
+                if (!loading) {
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    MemoryFileSystem::Shape shape;
+    MemoryFileSystem::Latency latency;
+    shape.filesPerDir = 1000;
+    int repeat = 1;
+    TraversalOptions options;
+    bool ignoring = false;
+    IgnoringFileSystem::Options ignoreOptions;
+    ignoreOptions.patterns.clear();
+    int i = 1;
+    if (argc > 1 && argv[1][0] != '-') {
+        if (!MemoryFileSystem::parseSpec(argv[1], shape, latency)) {
+            std::cerr << "bad spec: " << argv[1] << "\n";
+            return 2;
+        }
+        i = 2;
+    }
+    for (; i + 1 < argc; i += 2) {
+        std::string_view arg = argv[i];
+        if (arg == "--repeat") {
+            repeat = std::max(1, std::atoi(argv[i + 1]));
+        } else if (arg == "--threads") {
+            options.threadCount = static_cast<size_t>(std::atoi(argv[i + 1]));
+        } else if (arg == "--ignore") {
+            ignoring = true;
+            for (std::string_view patterns = argv[i + 1]; !patterns.empty();) {
+                size_t comma = patterns.find(',');
+                ignoreOptions.patterns.emplace_back(patterns.substr(0, comma));
+                patterns = comma == std::string_view::npos ? std::string_view() : patterns.substr(comma + 1);
+            }
+        }
+    }
+
+    auto memory = std::make_shared<MemoryFileSystem>("/mem", shape, latency);
+    std::printf("%llu folders, %llu files, %lld us a call, %lld us an entry, %lld us a stat, %zu concurrent\n",
+        static_cast<unsigned long long>(MemoryFileSystem::countDirectories(shape)),
+        static_cast<unsigned long long>(MemoryFileSystem::countFiles(shape)),
+        static_cast<long long>(latency.perCall.count()), static_cast<long long>(latency.perEntry.count()),
+        static_cast<long long>(latency.perStat.count()), latency.maxConcurrentCalls);
+
+    // Every tree of a run is made the same way, the rules wrap the provider up front so the
+    // root is listed once
+    std::shared_ptr<IgnoringFileSystem> filter;
+    auto makeTree = [&] {
+        std::shared_ptr<FileSystemProvider> provider = memory;
+        if (ignoring) {
+            filter = std::make_shared<IgnoringFileSystem>(memory, ignoreOptions);
+            filter->setRoot(memory->getRoot());
+            provider = filter;
+        }
+        auto tree = std::make_unique<FileTree>(memory->getRoot(), provider);
+        tree->getPrefetcher().setEnabled(false);
+        return tree;
+    };
+    auto reportIgnored = [&] {
+        if (filter) {
+            IgnoringFileSystem::Stats ignored = filter->getStats();
+            std::printf("%-18s %zu folders, %zu files (%llu bytes) skipped\n", "ignored",
+                ignored.skippedFolders, ignored.skippedFiles, static_cast<unsigned long long>(ignored.skippedBytes));
+        }
+    };
+
+    for (int run = 0; run < repeat; run++) {
+        std::unique_ptr<FileTree> tree;
+        report("open root", timeMs([&] { tree = makeTree(); }), *memory);
+
+        // Sync expansion of everything, like a search over an unloaded tree
+        TreeStatsVisitor serial;
+        TraversalOptions loadOptions = options;
+        loadOptions.expandWith = tree.get();
+        report("serial load", timeMs([&] { traverse(*tree->getRootNode(), serial, loadOptions); }), *memory);
+        reportIgnored();
+
+        tree = makeTree();
+        memory->resetStats();
+        TreeStatsVisitor parallel;
+        loadOptions.expandWith = tree.get();
+        report("parallel load", timeMs([&] { traverseParallel(*tree->getRootNode(), parallel, loadOptions); }), *memory);
+        if (parallel.files != serial.files || parallel.directories != serial.directories) {
+            std::printf("mismatch: serial %zu/%zu, parallel %zu/%zu\n", serial.directories, serial.files, parallel.directories, parallel.files);
+            return 1;
+        }
+
+        // What the user sees: every top level folder opened at once through the IoScheduler
+        tree = makeTree();
+        memory->resetStats();
+        double firstEntriesMs;
+        report("stream top level", streamTopLevel(*tree, firstEntriesMs), *memory);
+        std::printf("%-18s %10.2f ms\n", "first entries", firstEntriesMs);
+    }
+    return 0;
+}
@@ -0,0 +1,224 @@
+// Expansion, eviction, refresh and rendering of one FileTree from several threads at once, on a
+// MemoryFileSystem tree. Readers walk the published snapshots without the tree's lock like the
+// renderer does. Meant to run under ThreadSanitizer or AddressSanitizer, configure with
+// -DMIR_ENABLE_TSAN=ON. Exits with 1 when a reader saw a broken tree or no refresh ran.
+//
+//   mir_tree_stress [spec] [--seconds N] [--writers N] [--readers N] [--budget KB]
+//   mir_tree_stress depth=4,dirs=6,files=20 --seconds 10 --writers 4 --readers 4
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "FileTree.h"
+#include "MemoryFileSystem.h"
+#include "utils/Epoch.h"
+
+namespace {
+    struct Counters {
+        std::atomic<size_t> walks{0};
+        std::atomic<size_t> nodesRead{0};
+        std::atomic<size_t> frames{0};
+        std::atomic<size_t> expansions{0};
+        std::atomic<size_t> resorts{0};
+        std::atomic<size_t> refreshes{0};
+        std::atomic<size_t> broken{0};
+        std::atomic<size_t> checksum{0};
+    };
+
+    // What the renderer reads of a node, summed so the loads are not optimized away
+    size_t readTree(const FileNode* node, Counters& counters, size_t& checksum) {
+        size_t read = 1;
+        checksum += node->size + node->name.size() + static_cast<size_t>(node->gitStatus.load());
+        checksum += node->isLoading + node->hasMoreEntries + node->hasUnexpandedChildren;
+        for (const FileNode* child : node->readChildren()) {
+            if (!child || child->fullPath.parent_path() != node->fullPath) {
+                counters.broken.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            read += readTree(child, counters, checksum);
+        }
+        return read;
+    }
+
+    // Random walk down the published tree, stops at a folder at most depth levels down
+    FileNode* pickFolder(FileTree& tree, std::mt19937& random, int depth) {
+        FileNode* node = tree.getRootNode();
+        for (int level = 0; node && level < depth; level++) {
+            std::span<FileNode* const> children = node->readChildren();
+            if (children.empty() || random() % 4 == 0) {
+                break;
+            }
+            FileNode* child = children[random() % children.size()];
+            if (child->type != FileType::DIR) {
+                break;
+            }
+            node = child;
+        }
+        return node;
+    }
+
+    // The UI thread: pump, draw what is open, open a folder now and then, stay in budget
+    void renderLoop(FileTree& tree, const std::atomic<bool>& stop, Counters& counters) {
+        std::mt19937 random(1);
+        while (!stop.load(std::memory_order_relaxed)) {
+            tree.pumpExpansions();
+            {
+                Mir::Epoch::ReadGuard guard;
+                // Only the top levels count as open on screen, what writers load below them is
+                // left for enforceMemoryBudget
+                std::vector<std::pair<FileNode*, int>> open{{tree.getRootNode(), 0}};
+                while (!open.empty()) {
+                    auto [node, depth] = open.back();
+                    open.pop_back();
+                    tree.touch(node);
+                    for (FileNode* child : node->readChildren()) {
+                        if (child->type != FileType::DIR) {
+                            continue;
+                        }
+                        if (!child->readChildren().empty()) {
+                            if (depth < 2) {
+                                open.emplace_back(child, depth + 1);
+                            }
+                        } else if (child->hasUnexpandedChildren && random() % 16 == 0) {
+                            tree.expandNodeAsync(child);
+                        }
+                    }
+                }
+            }
+            tree.enforceMemoryBudget();
+            counters.frames.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    void writeLoop(FileTree& tree, const std::atomic<bool>& stop, Counters& counters, unsigned seed) {
+        std::mt19937 random(seed);
+        while (!stop.load(std::memory_order_relaxed)) {
+            unsigned action = random() % 256;
+            Mir::Epoch::ReadGuard guard;
+            FileNode* node = pickFolder(tree, random, 6);
+            if (!node) {
+                continue;
+            }
+            if (action < 2) {
+                tree.refreshRootNode();
+                counters.refreshes.fetch_add(1, std::memory_order_relaxed);
+            } else if (action < 8) {
+                tree.setSortCriteria(action % 2 == 0 ? SortCriteria::Name : SortCriteria::Size);
+                counters.resorts.fetch_add(1, std::memory_order_relaxed);
+            } else if (action < 32) {
+                tree.prefetch(node);
+            } else if (action < 64) {
+                tree.expandNodeAsync(node);
+            } else {
+                for (FileNode* child : node->readChildren()) {
+                    if (child->type == FileType::DIR && tree.expandNode(child)) {
+                        counters.expansions.fetch_add(1, std::memory_order_relaxed);
+                        break;
+                    }
+                }
+            }
+            // Real writers wait on the disk most of the time, leave the lock to the UI thread
+            std::this_thread::yield();
+        }
+    }
+
+    void readLoop(FileTree& tree, const std::atomic<bool>& stop, Counters& counters) {
+        while (!stop.load(std::memory_order_relaxed)) {
+            Mir::Epoch::ReadGuard guard;
+            if (FileNode* root = tree.getRootNode()) {
+                size_t checksum = 0;
+                counters.nodesRead.fetch_add(readTree(root, counters, checksum), std::memory_order_relaxed);
+                counters.checksum.fetch_add(checksum, std::memory_order_relaxed);
+            }
+            // What the status bar shows every frame, read without the lock
+            counters.checksum.fetch_add(tree.getResidentNodeCount() + tree.getResidentBytes() + tree.getEvictedCount(), std::memory_order_relaxed);
+            counters.walks.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    MemoryFileSystem::Shape shape;
+    MemoryFileSystem::Latency latency;
+    shape.depth = 4;
+    shape.dirsPerDir = 6;
+    shape.filesPerDir = 20;
+    int seconds = 5;
+    int writers = 3;
+    int readers = 3;
+    size_t budget = 1024 * 1024;
+    int i = 1;
+    if (argc > 1 && argv[1][0] != '-') {
+        if (!MemoryFileSystem::parseSpec(argv[1], shape, latency)) {
+            std::cerr << "bad spec: " << argv[1] << "\n";
+            return 2;
+        }
+        i = 2;
+    }
+    for (; i + 1 < argc; i += 2) {
+        std::string_view arg = argv[i];
+        if (arg == "--seconds") {
+            seconds = std::max(1, std::atoi(argv[i + 1]));
+        } else if (arg == "--writers") {
+            writers = std::max(0, std::atoi(argv[i + 1]));
+        } else if (arg == "--readers") {
+            readers = std::max(0, std::atoi(argv[i + 1]));
+        } else if (arg == "--budget") {
+            budget = static_cast<size_t>(std::max(0, std::atoi(argv[i + 1]))) * 1024;
+        }
+    }
+
+    auto memory = std::make_shared<MemoryFileSystem>("/mem", shape, latency);
+    std::printf("%llu folders, %llu files, %d writers, %d readers, %zu KB budget, %d s\n",
+        static_cast<unsigned long long>(MemoryFileSystem::countDirectories(shape)),
+        static_cast<unsigned long long>(MemoryFileSystem::countFiles(shape)), writers, readers, budget / 1024, seconds);
+
+    Counters counters;
+    {
+        FileTree tree(memory->getRoot(), memory);
+        tree.setMemoryBudget(budget);
+        tree.setExpansionLimit(0);
+
+        std::atomic<bool> stop{false};
+        std::vector<std::thread> threads;
+        threads.emplace_back([&] { renderLoop(tree, stop, counters); });
+        for (int w = 0; w < writers; w++) {
+            threads.emplace_back([&, w] { writeLoop(tree, stop, counters, 100 + w); });
+        }
+        for (int r = 0; r < readers; r++) {
+            threads.emplace_back([&] { readLoop(tree, stop, counters); });
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        stop.store(true);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        std::printf("%zu frames, %zu walks reading %zu nodes, %zu expansions, %zu resorts, %zu refreshes, %zu evicted folders\n",
+            counters.frames.load(), counters.walks.load(), counters.nodesRead.load(), counters.expansions.load(),
+            counters.resorts.load(), counters.refreshes.load(), tree.getEvictedCount());
+    }
+
+    Mir::Epoch::collect();
+    Mir::Epoch::Stats epoch = Mir::Epoch::getStats();
+    std::printf("epoch: %zu retired, %zu freed, %zu pending\n", epoch.retired, epoch.freed, epoch.pending);
+    if (counters.refreshes.load() == 0) {
+        std::printf("no refresh ran, the run is too short to cover reclaiming whole trees\n");
+        return 1;
+    }
+    if (counters.broken.load() != 0) {
+        std::printf("broken: %zu children did not belong to their parent\n", counters.broken.load());
+        return 1;
+    }
+    return epoch.pending == 0 ? 0 : 1;
+}
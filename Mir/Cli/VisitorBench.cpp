@@ -0,0 +1,120 @@
+// Serial vs parallel traversal timings on a real folder.
+//
+//   mir_visitor_bench <root> [--threads N] [--repeat N] [--hash-bytes N]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string_view>
+
+#include "FileTree.h"
+#include "FileNodeVisitor.h"
+
+namespace {
+    // Stands in for heavy visitors: reads and hashes the head of every file
+    class HeadHashVisitor : public FileNodeVisitor {
+    public:
+        explicit HeadHashVisitor(size_t bytes) : m_bytes(bytes), m_buffer(bytes) {}
+
+        uint64_t combined = 0;
+        size_t hashedFiles = 0;
+
+        VisitAction enter(FileNode& node, int) override {
+            if (node.type != FileType::FILE) {
+                return VisitAction::Continue;
+            }
+            std::ifstream file(node.fullPath, std::ios::binary);
+            file.read(m_buffer.data(), static_cast<std::streamsize>(m_bytes));
+            std::string_view head(m_buffer.data(), static_cast<size_t>(file.gcount()));
+            combined ^= std::hash<std::string_view>{}(head);
+            hashedFiles++;
+            return VisitAction::Continue;
+        }
+        bool canFork() const override { return true; }
+        std::unique_ptr<FileNodeVisitor> fork() const override { return std::make_unique<HeadHashVisitor>(m_bytes); }
+        void merge(FileNodeVisitor& forked) override {
+            auto& other = static_cast<HeadHashVisitor&>(forked);
+            combined ^= other.combined;
+            hashedFiles += other.hashedFiles;
+        }
+
+    private:
+        size_t m_bytes;
+        std::vector<char> m_buffer;
+    };
+
+    double timeMs(const std::function<void()>& run) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    template <typename MakeVisitor>
+    void compare(const char* name, FileNode& root, const TraversalOptions& options, int repeat, MakeVisitor makeVisitor) {
+        // Untimed pass first, whichever mode ran first would otherwise pay for the cold page cache
+        auto warmup = makeVisitor();
+        traverse(root, warmup, options);
+
+        double serialBest = 1e30;
+        double parallelBest = 1e30;
+        auto runSerial = [&] {
+            auto serial = makeVisitor();
+            serialBest = std::min(serialBest, timeMs([&] { traverse(root, serial, options); }));
+        };
+        auto runParallel = [&] {
+            auto parallel = makeVisitor();
+            parallelBest = std::min(parallelBest, timeMs([&] { traverseParallel(root, parallel, options); }));
+        };
+        // Alternating the order keeps whatever the previous run left behind from favouring one mode
+        for (int i = 0; i < repeat; i++) {
+            if (i % 2 == 0) {
+                runSerial();
+                runParallel();
+            } else {
+                runParallel();
+                runSerial();
+            }
+        }
+        std::printf("%-12s serial %9.2f ms   parallel %9.2f ms   speedup %5.2fx\n",
+            name, serialBest, parallelBest, serialBest / parallelBest);
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    if (argc < 2) {
+        std::cerr << "usage: mir_visitor_bench <root> [--threads N] [--repeat N] [--hash-bytes N]\n";
+        return 2;
+    }
+    TraversalOptions options;
+    int repeat = 3;
+    size_t hashBytes = 4096;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string_view arg = argv[i];
+        if (arg == "--threads") {
+            options.threadCount = static_cast<size_t>(std::atoi(argv[i + 1]));
+        } else if (arg == "--repeat") {
+            repeat = std::max(1, std::atoi(argv[i + 1]));
+        } else if (arg == "--hash-bytes") {
+            hashBytes = static_cast<size_t>(std::atoll(argv[i + 1]));
+        }
+    }
+
+    FileTree tree(argv[1]);
+    tree.setMemoryBudget(0);
+    FileNode& root = *tree.getRootNode();
+
+    // First pass loads the whole tree, every later pass walks memory only
+    TreeStatsVisitor stats;
+    TraversalOptions loadOptions = options;
+    loadOptions.expandWith = &tree;
+    double loadMs = timeMs([&] { traverseParallel(root, stats, loadOptions); });
+    std::printf("loaded %zu folders, %zu files (%llu bytes) in %.2f ms\n",
+        stats.directories, stats.files, static_cast<unsigned long long>(stats.totalBytes), loadMs);
+
+    compare("stats", root, options, repeat, [] { return TreeStatsVisitor(); });
+    compare("head hash", root, options, repeat, [&] { return HeadHashVisitor(hashBytes); });
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include "ContentSniffer.h"
+#include "utils/Utils.h"
+#include "utils/BatchIo.h"
+#include <algorithm>
+#include <array>
+
+namespace {
+    struct Magic {
+        std::string_view bytes;
+        size_t offset;
+        FileOpenMode mode;
+    };
+
+    constexpr std::array kMagics = {
+        Magic{"\x89PNG\r\n\x1a\n", 0, FileOpenMode::Image},
+        Magic{"\xFF\xD8\xFF", 0, FileOpenMode::Image},
+        Magic{"GIF87a", 0, FileOpenMode::Image},
+        Magic{"GIF89a", 0, FileOpenMode::Image},
+        Magic{"BM", 0, FileOpenMode::Image},
+        Magic{std::string_view("\x00\x00\x01\x00", 4), 0, FileOpenMode::Image}, // ico
+        Magic{"WEBP", 8, FileOpenMode::Image},
+        Magic{"%PDF", 0, FileOpenMode::Binary},
+        Magic{"PK\x03\x04", 0, FileOpenMode::Binary},
+        Magic{"\x1F\x8B", 0, FileOpenMode::Binary},
+        Magic{"\x7F" "ELF", 0, FileOpenMode::Binary},
+        Magic{"MZ", 0, FileOpenMode::Binary},
+        Magic{"7z\xBC\xAF\x27\x1C", 0, FileOpenMode::Binary},
+        Magic{"\xFD" "7zXZ", 0, FileOpenMode::Binary},
+        Magic{"(\xB5/\xFD", 0, FileOpenMode::Binary}, // zstd
+        Magic{"SQLite format 3", 0, FileOpenMode::Binary},
+        Magic{"ustar", 257, FileOpenMode::Binary},
+        // UTF-16/32 text cannot be shown by the text editor
+        Magic{"\xFF\xFE", 0, FileOpenMode::Binary},
+        Magic{"\xFE\xFF", 0, FileOpenMode::Binary},
+    };
+
+    constexpr std::array<std::string_view, 5> kStructuredExtensions = {
+        ".json", ".geojson", ".har", ".ipynb", ".webmanifest"
+    };
+
+    // One JSON value per line, JsonDocument would only show the first one
+    constexpr std::array<std::string_view, 2> kLineJsonExtensions = {
+        ".jsonl", ".ndjson"
+    };
+
+    constexpr std::array<std::string_view, 28> kCodeExtensions = {
+        ".c", ".cc", ".cpp", ".cxx", ".h", ".hh", ".hpp", ".hxx", ".inl", ".cs", ".java", ".kt", ".rs", ".go",
+        ".py", ".js", ".ts", ".tsx", ".jsx", ".lua", ".sh", ".ps1", ".cmake", ".glsl", ".hlsl", ".sql", ".swift", ".zig"
+    };
+
+    template<size_t N>
+    bool containsExtension(const std::array<std::string_view, N>& list, const std::string& ext) {
+        return std::find(list.begin(), list.end(), ext) != list.end();
+    }
+}
+
+FileOpenMode ContentSniffer::detect(const FileNode& node) {
+    if (node.type != FileType::FILE) {
+        return FileOpenMode::Unsupported;
+    }
+
+    const auto& key = node.fullPath.native();
+    auto it = m_cache.find(key);
+    if (it != m_cache.end() && it->second.size == node.size && it->second.modifiedTime == node.modifiedTime) {
+        return it->second.mode;
+    }
+
+    FileOpenMode mode = detect(readHead(node.fullPath, kSniffSize), node.fullPath);
+    m_cache[key] = CacheEntry{node.size, node.modifiedTime, mode};
+    return mode;
+}
+
+FileOpenMode ContentSniffer::detect(std::string_view head, const std::filesystem::path& path) {
+    FileOpenMode mode = detectFromMagic(head);
+    if (mode != FileOpenMode::Text) {
+        return mode;
+    }
+    if (head.empty()) {
+        return detectTextMode(head, path);
+    }
+
+    // Any NUL is a strong binary signal, lots of control characters is another
+    size_t controlChars = 0;
+    for (unsigned char c : head) {
+        if (c == 0) {
+            return FileOpenMode::Binary;
+        }
+        if (c < 0x20 && c != '\t' && c != '\n' && c != '\r' && c != '\f' && c != '\v' && c != 0x1B) {
+            controlChars++;
+        }
+    }
+    if (controlChars * 20 > head.size()) {
+        return FileOpenMode::Binary;
+    }
+
+    // The head may cut a multibyte sequence in half when it is full
+    if (!Mir::Utils::Text::isValidUtf8(head, head.size() >= kSniffSize)) {
+        return FileOpenMode::Binary;
+    }
+    return detectTextMode(head, path);
+}
+
+std::string ContentSniffer::readHead(const std::filesystem::path& path, size_t count) {
+    return Mir::Utils::File::BatchIo::readHeadSync(path, count);
+}
+
+FileOpenMode ContentSniffer::detectFromMagic(std::string_view head) {
+    for (const auto& magic : kMagics) {
+        if (head.size() >= magic.offset + magic.bytes.size() && head.substr(magic.offset, magic.bytes.size()) == magic.bytes) {
+            // "BM" and "MZ" are short enough to start plain text, check a bit more
+            if (magic.bytes == "BM" && (head.size() < 14 || head[6] != 0 || head[7] != 0)) continue;
+            if (magic.bytes == "MZ" && head.size() < 64) continue;
+            if (magic.bytes == "WEBP" && head.substr(0, 4) != "RIFF") continue;
+            return magic.mode;
+        }
+    }
+    return FileOpenMode::Text;
+}
+
+FileOpenMode ContentSniffer::detectTextMode(std::string_view head, const std::filesystem::path& path) {
+    std::string ext = Mir::Utils::Text::toLowerCase(path.extension().string());
+    if (containsExtension(kStructuredExtensions, ext)) {
+        return FileOpenMode::Structured;
+    }
+    if (containsExtension(kCodeExtensions, ext)) {
+        return FileOpenMode::Code;
+    }
+    if (containsExtension(kLineJsonExtensions, ext)) {
+        return FileOpenMode::Text;
+    }
+
+    // Unknown extension but looks like a JSON document, "[INFO]" style logs should not match
+    if (head.starts_with("\xEF\xBB\xBF")) {
+        head.remove_prefix(3);
+    }
+    size_t first = head.find_first_not_of(" \t\r\n");
+    if (first != std::string_view::npos && (head[first] == '{' || head[first] == '[')) {
+        size_t second = head.find_first_not_of(" \t\r\n", first + 1);
+        if (second != std::string_view::npos) {
+            char c = head[second];
+            if (c == '"' || (head[first] == '[' && (c == '{' || c == '[' || c == ']')) || (head[first] == '{' && c == '}')) {
+                return FileOpenMode::Structured;
+            }
+        }
+    }
+    return FileOpenMode::Text;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "FileNode.h"
+
+enum class FileOpenMode {
+    Text,           // Plain text editor
+    Binary,         // Hex/binary viewer
+    Image,          // Image viewer
+    Code,           // Syntax-highlighted code editor
+    Structured,     // JSON, XML, YAML viewer with formatting
+    Unsupported     // Cannot be opened
+};
+
+// Decides which viewer a file should open in from the first few KB of its content.
+// Results are cached per file and reused while size and modification time are unchanged.
+class ContentSniffer
+{
+public:
+    static constexpr size_t kSniffSize = 4096;
+
+    ContentSniffer() = default;
+    ~ContentSniffer() = default;
+
+    FileOpenMode detect(const FileNode& node);
+    // Uncached, for content that is already in memory
+    static FileOpenMode detect(std::string_view head, const std::filesystem::path& path);
+
+    void clearCache() { m_cache.clear(); }
+    size_t getCacheSize() const { return m_cache.size(); }
+
+private:
+    struct CacheEntry {
+        size_t size = 0;
+        int64_t modifiedTime = 0;
+        FileOpenMode mode = FileOpenMode::Text;
+    };
+    std::unordered_map<std::filesystem::path::string_type, CacheEntry> m_cache;
+
+    static std::string readHead(const std::filesystem::path& path, size_t count);
+    static FileOpenMode detectFromMagic(std::string_view head);
+    static FileOpenMode detectTextMode(std::string_view head, const std::filesystem::path& path);
+};
@@ -0,0 +1,176 @@
+#include "DirectoryPrefetcher.h"
+#include "FileTree.h"
+#include "utils/Profiler.h"
+#include <chrono>
+
+DirectoryPrefetcher::~DirectoryPrefetcher() {
+    // Queued scans still touch this, stale ones return right away
+    std::unique_lock lock(m_mutex);
+    m_generation++;
+    m_drained.wait(lock, [this] { return m_outstanding == 0; });
+}
+
+void DirectoryPrefetcher::request(const std::filesystem::path& _directory) {
+    if (!m_enabled || _directory.empty()) {
+        return;
+    }
+    uint64_t generation;
+    std::shared_ptr<FileSystemProvider> provider;
+    {
+        std::lock_guard lock(m_mutex);
+        const Key& key = _directory.native();
+        auto it = m_cache.find(key);
+        if (it != m_cache.end() && nowMs() - it->second.scannedAtMs <= m_budget.maxAgeMs) {
+            return;
+        }
+        if (m_inFlight.contains(key) || m_outstanding >= m_budget.maxQueued) {
+            return;
+        }
+        m_inFlight.insert(key);
+        m_outstanding++;
+        m_stats.requested++;
+        generation = m_generation;
+        provider = m_provider;
+    }
+
+    Mir::IoScheduler::shared().submit(provider->deviceOf(_directory), Mir::IoPriority::Speculative, [this, provider, _directory, generation]() {
+        size_t operations = scan(*provider, _directory, generation);
+        std::lock_guard lock(m_mutex);
+        if (--m_outstanding == 0) {
+            m_drained.notify_all();
+        }
+        return operations;
+    });
+}
+
+bool DirectoryPrefetcher::take(const std::filesystem::path& _directory, std::vector<std::unique_ptr<FileNode>>& children) {
+    std::lock_guard lock(m_mutex);
+    auto it = m_cache.find(_directory.native());
+    if (it == m_cache.end()) {
+        m_stats.misses++;
+        return false;
+    }
+    if (nowMs() - it->second.scannedAtMs > m_budget.maxAgeMs) {
+        m_stats.misses++;
+        m_stats.wasted++;
+        eraseLocked(it);
+        return false;
+    }
+    children = std::move(it->second.children);
+    eraseLocked(it);
+    m_stats.hits++;
+    return true;
+}
+
+void DirectoryPrefetcher::clear() {
+    std::lock_guard lock(m_mutex);
+    m_stats.wasted += m_cache.size();
+    m_cache.clear();
+    m_lru.clear();
+    m_inFlight.clear();
+    m_stats.cachedEntries = 0;
+    m_stats.cachedBytes = 0;
+    m_generation++;
+}
+
+void DirectoryPrefetcher::setProvider(std::shared_ptr<FileSystemProvider> _provider) {
+    std::lock_guard lock(m_mutex);
+    m_provider = std::move(_provider);
+}
+
+void DirectoryPrefetcher::setBudget(const Budget& budget) {
+    std::lock_guard lock(m_mutex);
+    m_budget = budget;
+    evictLocked(m_budget.maxBytes);
+}
+
+DirectoryPrefetcher::Budget DirectoryPrefetcher::getBudget() const {
+    std::lock_guard lock(m_mutex);
+    return m_budget;
+}
+
+DirectoryPrefetcher::Stats DirectoryPrefetcher::getStats() const {
+    std::lock_guard lock(m_mutex);
+    return m_stats;
+}
+
+size_t DirectoryPrefetcher::scan(FileSystemProvider& provider, const std::filesystem::path& _directory, uint64_t generation) {
+    MIR_PROFILE_SCOPE("DirectoryPrefetcher::scan");
+
+    size_t maxEntries;
+    {
+        std::lock_guard lock(m_mutex);
+        if (generation != m_generation) {
+            return 0;
+        }
+        maxEntries = m_budget.maxEntriesPerScan;
+    }
+
+    Entry entry;
+    auto reader = provider.openDirectory(_directory);
+    bool aborted = reader == nullptr;
+    size_t operations = 1;
+    FileSystemProvider::Entry listed;
+    while (reader && reader->next(listed)) {
+        operations++;
+        if (entry.children.size() >= maxEntries) {
+            aborted = true;
+            break;
+        }
+        try {
+            auto node = FileTree::makeNode(std::move(listed));
+            entry.bytes += node->getMemoryFootprint();
+            entry.children.push_back(std::move(node));
+        }
+        catch (const std::exception&) { }
+    }
+    reader.reset();
+    if (!aborted) {
+        provider.loadMetadata(entry.children);
+    }
+    entry.scannedAtMs = nowMs();
+    entry.count = entry.children.size();
+
+    std::lock_guard lock(m_mutex);
+    if (generation != m_generation) {
+        return operations;
+    }
+    const Key& key = _directory.native();
+    m_inFlight.erase(key);
+    if (aborted) {
+        m_stats.wasted++;
+        return operations;
+    }
+
+    auto existing = m_cache.find(key);
+    if (existing != m_cache.end()) {
+        m_stats.wasted++;
+        eraseLocked(existing);
+    }
+    m_lru.push_front(key);
+    entry.lru = m_lru.begin();
+    m_stats.cachedEntries += entry.count;
+    m_stats.cachedBytes += entry.bytes;
+    m_cache.emplace(key, std::move(entry));
+    evictLocked(m_budget.maxBytes);
+    return operations;
+}
+
+void DirectoryPrefetcher::evictLocked(size_t maxBytes) {
+    while (m_stats.cachedBytes > maxBytes && !m_lru.empty()) {
+        m_stats.wasted++;
+        eraseLocked(m_cache.find(m_lru.back()));
+    }
+}
+
+void DirectoryPrefetcher::eraseLocked(std::unordered_map<Key, Entry>::iterator it) {
+    // take() may have moved the children out already, the counters use what was recorded on insert
+    m_stats.cachedBytes -= it->second.bytes;
+    m_stats.cachedEntries -= it->second.count;
+    m_lru.erase(it->second.lru);
+    m_cache.erase(it);
+}
+
+int64_t DirectoryPrefetcher::nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
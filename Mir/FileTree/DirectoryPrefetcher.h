@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "FileNode.h"
+#include "FileSystemProvider.h"
+#include "utils/IoScheduler.h"
+
+// Scans directories the user is likely to open next (hovered, children of the one just opened)
+// as speculative IoScheduler jobs, so the following expandNode is served from memory.
+// Scans are bounded by a queue limit, an entry limit per directory and a memory budget.
+class DirectoryPrefetcher
+{
+public:
+    struct Budget {
+        size_t maxQueued = 16;              // pending scans, further hints are dropped
+        size_t maxEntriesPerScan = 20000;   // bigger directories are left to the streaming expansion
+        size_t maxBytes = 32 * 1024 * 1024; // cached nodes, least recently scanned go first
+        int64_t maxAgeMs = 30000;           // older scans are rescanned instead of served
+    };
+
+    struct Stats {
+        size_t requested = 0;   // scans queued
+        size_t hits = 0;        // expansions served from the cache
+        size_t misses = 0;      // expansions that had to scan
+        size_t wasted = 0;      // scans evicted, expired or aborted without being used
+        size_t cachedEntries = 0;
+        size_t cachedBytes = 0;
+    };
+
+    DirectoryPrefetcher() = default;
+    ~DirectoryPrefetcher();
+
+    // Hint, cheap to call every frame for the same directory
+    void request(const std::filesystem::path& directory);
+    // Hands over the cached children of directory, false on a miss
+    bool take(const std::filesystem::path& directory, std::vector<std::unique_ptr<FileNode>>& children);
+    void clear();
+
+    // Scans list through provider, set before the first request (FileTree does)
+    void setProvider(std::shared_ptr<FileSystemProvider> provider);
+
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+    bool isEnabled() const { return m_enabled; }
+    // Only takes effect for limits checked after the call
+    void setBudget(const Budget& budget);
+    Budget getBudget() const;
+    Stats getStats() const;
+
+private:
+    using Key = std::filesystem::path::string_type;
+
+    struct Entry {
+        std::vector<std::unique_ptr<FileNode>> children;
+        size_t count = 0;
+        size_t bytes = 0;
+        int64_t scannedAtMs = 0;
+        std::list<Key>::iterator lru;
+    };
+
+    mutable std::mutex m_mutex;
+    std::shared_ptr<FileSystemProvider> m_provider = FileSystemProvider::native();
+    std::unordered_map<Key, Entry> m_cache;
+    std::list<Key> m_lru;               // front = most recent
+    std::unordered_set<Key> m_inFlight;
+    Budget m_budget;
+    Stats m_stats;
+    uint64_t m_generation = 0;          // bumped by clear(), stale scans are discarded
+    bool m_enabled = true;
+    size_t m_outstanding = 0;           // scans queued or running on the scheduler
+    std::condition_variable m_drained;
+
+    // Entries listed, for the scheduler's latency
+    size_t scan(FileSystemProvider& provider, const std::filesystem::path& directory, uint64_t generation);
+    void evictLocked(size_t maxBytes);
+    void eraseLocked(std::unordered_map<Key, Entry>::iterator it);
+    static int64_t nowMs();
+};
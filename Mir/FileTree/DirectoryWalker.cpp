@@ -0,0 +1,87 @@
+#include "DirectoryWalker.h"
+#include "utils/Utils.h"
+#include <vector>
+
+std::string WalkEntry::getName() const {
+    std::string name = Mir::Utils::File::toUtf8(std::filesystem::path(nativeName));
+    if (!Mir::Utils::Text::isValidUtf8(name)) {
+        name = Mir::Utils::Text::sanitizeUtf8(name);
+    }
+    return name;
+}
+
+namespace {
+    std::basic_string_view<std::filesystem::path::value_type> nativeFilename(const std::filesystem::path& path) {
+        std::basic_string_view<std::filesystem::path::value_type> native = path.native();
+#ifdef _WIN32
+        size_t separator = native.find_last_of(L"\\/");
+#else
+        size_t separator = native.rfind('/');
+#endif
+        return separator == native.npos ? native : native.substr(separator + 1);
+    }
+}
+
+Mir::Generator<const WalkEntry&> walkDirectory(std::filesystem::path root, WalkOptions options) {
+    // Explicit stack instead of recursion, one iterator per open level
+    std::vector<std::filesystem::directory_iterator> stack;
+    std::error_code ec;
+    stack.emplace_back(root, ec);
+    if (ec) {
+        co_return;
+    }
+
+    const std::filesystem::directory_iterator end;
+    WalkEntry view;
+    while (!stack.empty()) {
+        std::filesystem::directory_iterator& it = stack.back();
+        if (it == end) {
+            stack.pop_back();
+            continue;
+        }
+
+        const std::filesystem::directory_entry& entry = *it;
+        view.path = &entry.path();
+        view.nativeName = nativeFilename(entry.path());
+        view.depth = static_cast<int>(stack.size());
+        view.size = 0;
+        view.isSymlink = entry.is_symlink(ec);
+        if (entry.is_directory(ec)) {
+            view.type = FileType::DIR;
+        } else if (entry.is_regular_file(ec)) {
+            view.type = FileType::FILE;
+            if (options.withSize) {
+                view.size = entry.file_size(ec);
+                if (ec) {
+                    view.size = 0;
+                }
+            }
+        } else {
+            view.type = FileType::UNKNOWN;
+        }
+
+        bool descend = view.type == FileType::DIR && (options.followSymlinks || !view.isSymlink) &&
+                       (options.maxDepth < 0 || view.depth < options.maxDepth);
+        if (!options.filter || options.filter(view)) {
+            // The consumer may stop here for good, the frame is destroyed without resuming
+            co_yield view;
+        }
+        if (descend && options.descend && !options.descend(view)) {
+            descend = false;
+        }
+
+        std::filesystem::directory_iterator child;
+        if (descend) {
+            child = std::filesystem::directory_iterator(entry.path(), ec);
+            descend = !ec;
+        }
+        // Advance before pushing, push_back invalidates it
+        it.increment(ec);
+        if (ec) {
+            it = end;
+        }
+        if (descend) {
+            stack.push_back(std::move(child));
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "FileNode.h"
+#include "utils/Generator.h"
+
+// What walkDirectory yields. Only valid until the walk is resumed, copy what you need.
+struct WalkEntry {
+    const std::filesystem::path* path = nullptr;
+    std::basic_string_view<std::filesystem::path::value_type> nativeName; // points into *path
+    FileType type = FileType::UNKNOWN;
+    bool isSymlink = false;
+    uint64_t size = 0;  // files only, 0 unless WalkOptions::withSize
+    int depth = 1;      // children of the root are depth 1
+
+    const std::filesystem::path& getPath() const { return *path; }
+    // UTF-8, allocates, prefer nativeName for comparisons in tight loops
+    std::string getName() const;
+};
+
+struct WalkOptions {
+    int maxDepth = -1;                                  // deepest depth yielded, -1 = unlimited
+    bool withSize = true;                               // costs a stat per file on POSIX
+    bool followSymlinks = false;                        // linked folders can form cycles
+    std::function<bool(const WalkEntry&)> filter;       // false = not yielded (still descended into)
+    std::function<bool(const WalkEntry&)> descend;      // false = folder's contents are skipped
+};
+
+// Lazy, pull based walk straight from directory reads. No FileNodes are made and memory stays
+// at one open directory per level, so it suits one-off scans of huge trees. Breaking out of the
+// loop stops the walk, nothing more is read.
+//
+//   for (const WalkEntry& entry : walkDirectory(root, {.maxDepth = 3})) {
+//       if (entry.type == FileType::FILE && entry.size > (1ull << 30)) { found = entry.getPath(); break; }
+//   }
+Mir::Generator<const WalkEntry&> walkDirectory(std::filesystem::path root, WalkOptions options = {});
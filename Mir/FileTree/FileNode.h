@@ -1,45 +1,121 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
+#include <cstdint>
+#include <filesystem>
+#include <atomic>
+#include <span>
+#include "utils/Epoch.h"
 enum class FileType {
     DIR,
     FILE,
     UNKNOWN
 };
 
+// Set by TreeDiff on the nodes of a comparison tree, None everywhere else
+enum class DiffStatus : uint8_t {
+    None,
+    Unchanged,
+    Added,            // only in the right tree
+    Removed,          // only in the left tree
+    SizeChanged,
+    TimeChanged,      // same size, different mtime (content confirmed equal when hashing is on)
+    ContentChanged,   // same size, hashes differ
+    ChildrenChanged   // directory with a difference somewhere below
+};
+
+// Set by GitStatusOverlay, working tree against the git index. None outside a repository.
+enum class GitStatus : uint8_t {
+    None,
+    Checking,         // stat data differs from the index, content is being hashed
+    Clean,
+    Modified,
+    Untracked,
+    Ignored,
+    Conflicted,       // unmerged entries in the index
+    ChildrenChanged   // directory with a change somewhere below, deleted files included
+};
+
 class FileNodeVisitor;
+
+// children is the writer side, owned and changed by FileTree under its write lock. Readers on
+// other threads (the renderer) use readChildren() inside a Mir::Epoch::ReadGuard, an immutable
+// copy the tree republishes after every change. The flags readers look at are atomic.
 struct FileNode {
+    struct ChildSnapshot {
+        std::vector<FileNode*> nodes;
+    };
+
     std::vector<std::unique_ptr<FileNode>> children;
+    std::atomic<const ChildSnapshot*> publishedChildren{nullptr};
     std::filesystem::path fullPath; 
-    std::wstring name;
+    std::string name; // UTF-8 for display and sorting, fullPath keeps the on-disk bytes
     
     FileType type = FileType::UNKNOWN;
     size_t size = 0; 
-    bool hasUnexpandedChildren = false; 
+    int64_t modifiedTime = 0; // raw file clock ticks, only compared for equality
+    std::atomic<bool> hasUnexpandedChildren{false};
+    bool isSymlink = false;      // recursive walks do not follow these, links can form cycles
+    std::atomic<bool> isLoading{false};      // streaming expansion still running
+    std::atomic<bool> hasMoreEntries{false}; // streaming expansion paused at the page limit
+    std::atomic<bool> isDetached{false};     // unlinked from its tree, only kept alive for readers
+    std::atomic<uint64_t> lastShown{0};      // frame the renderer last drew it open, see FileTree::touch
+    std::atomic<const std::atomic<size_t>*> scanProgress{nullptr}; // entries found by a running streaming expansion
+    bool isArchive = false;      // a FILE that expands like a folder (tar), see TarArchive
+    bool isVirtual = false;      // inside an archive, fullPath does not exist on disk
+    uint32_t extensionId = 0; // interned by the renderer on first use, 0 = not resolved
+    DiffStatus diffStatus = DiffStatus::None;
+    std::atomic<GitStatus> gitStatus{GitStatus::None};
    
     FileNode() { }
-    ~FileNode() {}
+    ~FileNode() { delete publishedChildren.load(std::memory_order_relaxed); }
    
-   std::wstring getExtension() const {
+   std::string_view getExtension() const {
         if (type != FileType::FILE) {
-            return L"";
+            return {};
         }
         
-        size_t dotPos = name.find_last_of(L'.');
-        if (dotPos != std::wstring::npos) {
-            return name.substr(dotPos);
+        size_t dotPos = name.find_last_of('.');
+        if (dotPos != std::string::npos) {
+            return std::string_view(name).substr(dotPos);
         }
-        return L"";
+        return {};
     }
 
 
-    FileNode(const std::wstring& nodeName, FileType nodeType) 
-    : name(nodeName), type(nodeType) {}
+    FileNode(std::string nodeName, FileType nodeType) 
+    : name(std::move(nodeName)), type(nodeType) {}
     
+    // Heap estimate of this node alone, children not included
+    size_t getMemoryFootprint() const {
+        return sizeof(FileNode) + sizeof(std::unique_ptr<FileNode>) + sizeof(FileNode*) + name.capacity() +
+               fullPath.native().capacity() * sizeof(std::filesystem::path::value_type);
+    }
+
     void addChild(std::unique_ptr<FileNode> child) {
         children.push_back(std::move(child));
     }
+
+    // Children as last published, valid until the enclosing ReadGuard ends. Any thread.
+    std::span<FileNode* const> readChildren() const {
+        const ChildSnapshot* snapshot = publishedChildren.load(std::memory_order_acquire);
+        return snapshot ? std::span<FileNode* const>(snapshot->nodes) : std::span<FileNode* const>();
+    }
+
+    // Writer: makes the current children visible to readers, the previous list is retired
+    void publishChildren() {
+        auto* snapshot = new ChildSnapshot();
+        snapshot->nodes.reserve(children.size());
+        for (auto& child : children) {
+            snapshot->nodes.push_back(child.get());
+        }
+        const ChildSnapshot* previous = publishedChildren.exchange(snapshot, std::memory_order_acq_rel);
+        if (previous) {
+            Mir::Epoch::retireWith([previous]() { delete previous; });
+        }
+    }
     
     void accept(FileNodeVisitor& visitor);
 };
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include "FileNodeVisitor.h"
+#include "FileTree.h"
+#include "utils/Profiler.h"
+#include "utils/ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct WalkContext {
+        const TraversalOptions& options;
+        std::atomic<bool>& stopped;
+        // Parallel tasks cannot touch FileTree bookkeeping, they load children themselves and
+        // report the nodes so the calling thread can register them afterwards
+        std::vector<FileNode*>* loaded = nullptr;
+    };
+
+    void ensureChildren(FileNode& node, WalkContext& context) {
+        if (node.type != FileType::DIR || !node.hasUnexpandedChildren || node.isLoading || !context.options.expandWith) {
+            return;
+        }
+        if (context.loaded) {
+            // Archive contents are only known to the FileTree that indexed the archive
+            if (!node.isVirtual && FileTree::loadChildren(&node, context.options.expandWith->getProvider())) {
+                context.loaded->push_back(&node);
+            }
+        } else {
+            context.options.expandWith->expandNode(&node);
+        }
+    }
+
+    bool canDescend(const FileNode& node, int depth, const TraversalOptions& options) {
+        return node.type == FileType::DIR && !node.isSymlink && (options.maxDepth < 0 || depth < options.maxDepth);
+    }
+
+    bool walk(FileNode& node, int depth, FileNodeVisitor& visitor, WalkContext& context) {
+        if (context.stopped.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        VisitAction action = visitor.enter(node, depth);
+        if (action == VisitAction::Stop) {
+            context.stopped.store(true, std::memory_order_relaxed);
+            return false;
+        }
+        if (action == VisitAction::Continue && canDescend(node, depth, context.options)) {
+            ensureChildren(node, context);
+            for (const auto& child : node.children) {
+                if (context.options.prune && context.options.prune(*child)) {
+                    continue;
+                }
+                if (!walk(*child, depth + 1, visitor, context)) {
+                    return false;
+                }
+            }
+        }
+        visitor.leave(node, depth);
+        return true;
+    }
+
+    struct Subtree {
+        FileNode* node;
+        int depth;
+    };
+
+    // Serial part of the parallel walk. Nodes above splitDepth are entered here, their
+    // subtrees at splitDepth become tasks and the nodes are queued for leave() afterwards.
+    bool walkTop(FileNode& node, int depth, int splitDepth, FileNodeVisitor& visitor, WalkContext& context,
+                 std::vector<Subtree>& subtrees, std::vector<Subtree>& pendingLeave) {
+        VisitAction action = visitor.enter(node, depth);
+        if (action == VisitAction::Stop) {
+            context.stopped.store(true, std::memory_order_relaxed);
+            return false;
+        }
+        if (action == VisitAction::Continue && canDescend(node, depth, context.options)) {
+            ensureChildren(node, context);
+            for (const auto& child : node.children) {
+                if (context.options.prune && context.options.prune(*child)) {
+                    continue;
+                }
+                if (child->type != FileType::DIR) {
+                    // Single files are not worth a task
+                    if (!walk(*child, depth + 1, visitor, context)) {
+                        return false;
+                    }
+                } else if (depth + 1 >= splitDepth) {
+                    subtrees.push_back({child.get(), depth + 1});
+                } else if (!walkTop(*child, depth + 1, splitDepth, visitor, context, subtrees, pendingLeave)) {
+                    return false;
+                }
+            }
+        }
+        pendingLeave.push_back({&node, depth});
+        return true;
+    }
+
+    // Smallest depth whose width gives every thread a few subtrees to balance uneven ones
+    int findSplitDepth(FileNode& root, size_t targetWidth, WalkContext& context) {
+        std::vector<FileNode*> level{&root};
+        int depth = 0;
+        while (true) {
+            std::vector<FileNode*> next;
+            for (FileNode* node : level) {
+                if (!canDescend(*node, depth, context.options)) {
+                    continue;
+                }
+                ensureChildren(*node, context);
+                for (const auto& child : node->children) {
+                    if (child->type == FileType::DIR && !(context.options.prune && context.options.prune(*child))) {
+                        next.push_back(child.get());
+                    }
+                }
+            }
+            depth++;
+            if (next.empty() || next.size() >= targetWidth) {
+                return depth;
+            }
+            level = std::move(next);
+        }
+    }
+}
+
+void FileNode::accept(FileNodeVisitor& visitor) {
+    traverse(*this, visitor);
+}
+
+bool traverse(FileNode& root, FileNodeVisitor& visitor, const TraversalOptions& options) {
+    MIR_PROFILE_SCOPE("traverse");
+    std::atomic<bool> stopped{false};
+    WalkContext context{options, stopped};
+    return walk(root, 0, visitor, context);
+}
+
+bool traverseParallel(FileNode& root, FileNodeVisitor& visitor, const TraversalOptions& options) {
+    MIR_PROFILE_SCOPE("traverseParallel");
+    size_t threadCount = options.threadCount != 0 ? options.threadCount : std::max(1u, std::thread::hardware_concurrency());
+    if (threadCount == 1 || !visitor.canFork()) {
+        return traverse(root, visitor, options);
+    }
+
+    std::atomic<bool> stopped{false};
+    WalkContext topContext{options, stopped};
+    std::vector<Subtree> subtrees;
+    std::vector<Subtree> pendingLeave;
+    int splitDepth = findSplitDepth(root, threadCount * 4, topContext);
+    if (!walkTop(root, 0, splitDepth, visitor, topContext, subtrees, pendingLeave)) {
+        return false;
+    }
+
+    // Forks are made here, fork() does not have to be thread safe
+    std::vector<std::unique_ptr<FileNodeVisitor>> forks(subtrees.size());
+    std::vector<std::vector<FileNode*>> loaded(subtrees.size());
+    for (auto& forked : forks) {
+        forked = visitor.fork();
+    }
+    {
+        Mir::ThreadPool pool(std::min(threadCount, std::max<size_t>(subtrees.size(), 1)));
+        for (size_t i = 0; i < subtrees.size(); i++) {
+            pool.submit([&, i]() {
+                WalkContext context{options, stopped, &loaded[i]};
+                walk(*subtrees[i].node, subtrees[i].depth, *forks[i], context);
+            });
+        }
+        pool.waitIdle();
+    }
+
+    for (size_t i = 0; i < forks.size(); i++) {
+        visitor.merge(*forks[i]);
+        if (options.expandWith) {
+            for (FileNode* node : loaded[i]) {
+                options.expandWith->adoptLoadedChildren(node);
+            }
+        }
+    }
+    if (stopped.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    for (const Subtree& top : pendingLeave) {
+        visitor.leave(*top.node, top.depth);
+    }
+    return true;
+}
+
+VisitAction TreeStatsVisitor::enter(FileNode& node, int depth) {
+    if (node.type == FileType::DIR) {
+        directories++;
+    } else if (node.type == FileType::FILE) {
+        files++;
+        totalBytes += node.size;
+        largestFile = std::max<uint64_t>(largestFile, node.size);
+    }
+    maxDepth = std::max(maxDepth, depth);
+    return VisitAction::Continue;
+}
+
+void TreeStatsVisitor::merge(FileNodeVisitor& forked) {
+    auto& other = static_cast<TreeStatsVisitor&>(forked);
+    directories += other.directories;
+    files += other.files;
+    totalBytes += other.totalBytes;
+    largestFile = std::max(largestFile, other.largestFile);
+    maxDepth = std::max(maxDepth, other.maxDepth);
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "FileNode.h"
+
+class FileTree;
+
+enum class VisitAction {
+    Continue,       // visit the children
+    SkipChildren,   // prune below this node, leave() is still called
+    Stop            // end the whole traversal, no further enter() or leave()
+};
+
+// Base class for anything that walks the tree. Override what you need.
+//
+//   class CountVisitor : public FileNodeVisitor {
+//   public:
+//       size_t files = 0;
+//       VisitAction enter(FileNode& node, int) override { files += node.type == FileType::FILE; return VisitAction::Continue; }
+//   };
+//   CountVisitor counter;
+//   root->accept(counter);
+class FileNodeVisitor
+{
+public:
+    virtual ~FileNodeVisitor() = default;
+
+    virtual VisitAction enter(FileNode& /*node*/, int /*depth*/) { return VisitAction::Continue; }
+    // After all children, so directory totals can be computed here
+    virtual void leave(FileNode& /*node*/, int /*depth*/) {}
+
+    // Parallel traversal: every subtree task gets its own fork, forks are merged back on the
+    // calling thread when all tasks are done. Visitors that can't fork are walked serially.
+    virtual bool canFork() const { return false; }
+    virtual std::unique_ptr<FileNodeVisitor> fork() const { return nullptr; }
+    virtual void merge(FileNodeVisitor& /*forked*/) {}
+};
+
+struct TraversalOptions {
+    int maxDepth = -1;                                  // -1 = unlimited, root is depth 0
+    std::function<bool(const FileNode&)> prune;         // true = skip the node and its subtree (root is never pruned)
+    FileTree* expandWith = nullptr;                     // load unexpanded directories while walking
+    size_t threadCount = 0;                             // parallel only, 0 = hardware concurrency
+};
+
+// Depth first, children in their current order. Returns false when a visitor stopped it.
+bool traverse(FileNode& root, FileNodeVisitor& visitor, const TraversalOptions& options = {});
+
+// Walks the top levels serially until there are enough subtrees to keep every thread busy,
+// then runs each subtree on the pool with a forked visitor. enter() and leave() of the top
+// levels run on the calling thread, leave() only after everything below is done. Order between
+// subtrees is not defined. The tree must not be changed by anyone else meanwhile.
+bool traverseParallel(FileNode& root, FileNodeVisitor& visitor, const TraversalOptions& options = {});
+
+// Totals over everything visited, forkable so it works with traverseParallel
+class TreeStatsVisitor : public FileNodeVisitor
+{
+public:
+    size_t directories = 0;
+    size_t files = 0;
+    uint64_t totalBytes = 0;
+    uint64_t largestFile = 0;
+    int maxDepth = 0;
+
+    VisitAction enter(FileNode& node, int depth) override;
+    bool canFork() const override { return true; }
+    std::unique_ptr<FileNodeVisitor> fork() const override { return std::make_unique<TreeStatsVisitor>(); }
+    void merge(FileNodeVisitor& forked) override;
+};
@@ -0,0 +1,380 @@
+#include "FileOperation.h"
+#include "DirectoryWalker.h"
+#include "utils/Profiler.h"
+#include "utils/Utils.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Cancellation and progress are checked between chunks
+    constexpr size_t kCopyChunk = 8 * 1024 * 1024;
+
+    bool isInside(const fs::path& path, const fs::path& directory) {
+        fs::path relative = path.lexically_normal().lexically_relative(directory.lexically_normal());
+        return !relative.empty() && *relative.begin() != "..";
+    }
+}
+
+FileOperation::FileOperation(Kind kind, std::vector<fs::path> sources, fs::path destination)
+    : FileOperation(kind, std::move(sources), std::move(destination), Options{}) {}
+
+FileOperation::FileOperation(Kind kind, std::vector<fs::path> sources, fs::path destination, Options options)
+    : m_kind(kind), m_sources(std::move(sources)), m_destination(std::move(destination)), m_options(options) {}
+
+FileOperation::Progress FileOperation::getProgress() const {
+    Progress progress;
+    progress.totalFiles = m_totalFiles.load(std::memory_order_relaxed);
+    progress.doneFiles = m_doneFiles.load(std::memory_order_relaxed);
+    progress.totalBytes = m_totalBytes.load(std::memory_order_relaxed);
+    progress.doneBytes = m_doneBytes.load(std::memory_order_relaxed);
+    progress.clonedFiles = m_clonedFiles.load(std::memory_order_relaxed);
+    progress.errors = m_errorCount.load(std::memory_order_relaxed);
+    progress.listing = m_listing.load(std::memory_order_relaxed);
+    return progress;
+}
+
+std::vector<std::string> FileOperation::getErrors() const {
+    std::lock_guard lock(m_errorMutex);
+    return m_errors;
+}
+
+void FileOperation::addError(const fs::path& path, std::string_view reason) {
+    m_errorCount.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard lock(m_errorMutex);
+    if (m_errors.size() < kMaxErrorMessages) {
+        m_errors.push_back(Mir::Utils::File::toUtf8(path) + ": " + std::string(reason));
+    }
+}
+
+fs::path FileOperation::uniquePath(const fs::path& directory, const fs::path& name) {
+    std::error_code ec;
+    fs::path candidate = directory / name;
+    if (!fs::exists(fs::symlink_status(candidate, ec))) {
+        return candidate;
+    }
+    // Folders have no extension even with a dot in the name
+    bool isDirectory = fs::is_directory(fs::symlink_status(candidate, ec));
+    fs::path stem = isDirectory ? name : name.stem();
+    fs::path extension = isDirectory ? fs::path() : name.extension();
+    for (int i = 2;; i++) {
+        fs::path numbered = stem;
+        numbered += " (" + std::to_string(i) + ")";
+        numbered += extension;
+        candidate = directory / numbered;
+        if (!fs::exists(fs::symlink_status(candidate, ec))) {
+            return candidate;
+        }
+    }
+}
+
+bool FileOperation::run() {
+    MIR_PROFILE_SCOPE("FileOperation::run");
+    m_pool = std::make_unique<Mir::ThreadPool>(m_options.threadCount, kMaxQueuedFiles);
+
+    for (const fs::path& source : m_sources) {
+        if (isCancelled()) {
+            break;
+        }
+        std::error_code ec;
+        if (m_kind == Kind::Delete) {
+            if (deleteTree(source)) {
+                m_removed.push_back(source);
+            }
+            continue;
+        }
+
+        if (m_kind == Kind::Copy && isInside(m_destination, source)) {
+            addError(source, "cannot copy a folder into itself");
+            continue;
+        }
+        fs::path target = m_options.overwrite ? m_destination / source.filename() : uniquePath(m_destination, source.filename());
+
+        if (m_kind == Kind::Move) {
+            if (isInside(m_destination, source) || source.parent_path() == m_destination) {
+                addError(source, "already there or inside itself");
+                continue;
+            }
+            // Same device: one rename, nothing is copied
+            fs::rename(source, target, ec);
+            if (!ec) {
+                m_created.push_back(target);
+                m_removed.push_back(source);
+                continue;
+            }
+            if (ec != std::errc::cross_device_link) {
+                addError(source, ec.message());
+                continue;
+            }
+        }
+
+        size_t errorsBefore = m_errorCount.load(std::memory_order_relaxed);
+        bool listed = copyTree(source, target);
+        m_pool->waitIdle();
+        if (listed || fs::exists(fs::symlink_status(target, ec))) {
+            m_created.push_back(target);
+        }
+        // Across devices the source only goes once every byte has arrived
+        if (m_kind == Kind::Move && listed && !isCancelled() && m_errorCount.load(std::memory_order_relaxed) == errorsBefore) {
+            if (deleteTree(source)) {
+                m_removed.push_back(source);
+            }
+        }
+    }
+    m_pool->waitIdle();
+    m_listing.store(false, std::memory_order_relaxed);
+    m_pool.reset();
+    return !isCancelled() && m_errorCount.load(std::memory_order_relaxed) == 0;
+}
+
+bool FileOperation::copyTree(const fs::path& source, const fs::path& target) {
+    std::error_code ec;
+    fs::file_status status = fs::symlink_status(source, ec);
+    if (ec) {
+        addError(source, ec.message());
+        return false;
+    }
+    if (fs::is_symlink(status)) {
+        // Links are copied as links, following them could copy half the disk
+        fs::copy_symlink(source, target, ec);
+        if (ec) {
+            addError(source, ec.message());
+        }
+        return !ec;
+    }
+    if (!fs::is_directory(status)) {
+        uint64_t size = fs::file_size(source, ec);
+        m_totalFiles.fetch_add(1, std::memory_order_relaxed);
+        m_totalBytes.fetch_add(size, std::memory_order_relaxed);
+        m_pool->submit([this, source, target, size]() { copyFile(source, target, size); });
+        return true;
+    }
+
+    if (!fs::create_directory(target, ec) && ec) {
+        addError(target, ec.message());
+        return false;
+    }
+    // Folders are created here in walk order, so a parent always exists before its files are queued
+    WalkOptions options;
+    options.withSize = true;
+    options.followSymlinks = false;
+    for (const WalkEntry& entry : walkDirectory(source, std::move(options))) {
+        if (isCancelled()) {
+            return false;
+        }
+        const fs::path& from = entry.getPath();
+        fs::path to = target / from.lexically_relative(source);
+        if (entry.isSymlink) {
+            fs::copy_symlink(from, to, ec);
+            if (ec) {
+                addError(from, ec.message());
+            }
+        } else if (entry.type == FileType::DIR) {
+            fs::create_directory(to, ec);
+            if (ec) {
+                addError(to, ec.message());
+            }
+        } else if (entry.type == FileType::FILE) {
+            m_totalFiles.fetch_add(1, std::memory_order_relaxed);
+            m_totalBytes.fetch_add(entry.size, std::memory_order_relaxed);
+            m_pool->submit([this, from, to = std::move(to), size = entry.size]() { copyFile(from, to, size); });
+        } else {
+            addError(from, "not a regular file, skipped");
+        }
+    }
+    return true;
+}
+
+bool FileOperation::deleteTree(const fs::path& source) {
+    std::error_code ec;
+    fs::file_status status = fs::symlink_status(source, ec);
+    if (ec) {
+        addError(source, ec.message());
+        return false;
+    }
+    if (fs::is_directory(status)) {
+        // Files go in parallel, folders after them deepest first
+        std::vector<fs::path> directories;
+        WalkOptions options;
+        options.withSize = false;
+        options.followSymlinks = false;
+        for (const WalkEntry& entry : walkDirectory(source, std::move(options))) {
+            if (isCancelled()) {
+                break;
+            }
+            if (entry.type == FileType::DIR && !entry.isSymlink) {
+                directories.push_back(entry.getPath());
+                continue;
+            }
+            m_totalFiles.fetch_add(1, std::memory_order_relaxed);
+            m_pool->submit([this, path = entry.getPath()]() {
+                if (isCancelled()) {
+                    return;
+                }
+                std::error_code removeError;
+                if (!fs::remove(path, removeError) && removeError) {
+                    addError(path, removeError.message());
+                }
+                m_doneFiles.fetch_add(1, std::memory_order_relaxed);
+            });
+        }
+        m_pool->waitIdle();
+        if (isCancelled()) {
+            return false;
+        }
+        for (auto it = directories.rbegin(); it != directories.rend(); ++it) {
+            fs::remove(*it, ec);
+        }
+    } else {
+        m_totalFiles.fetch_add(1, std::memory_order_relaxed);
+        m_doneFiles.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (!fs::remove(source, ec)) {
+        addError(source, ec ? ec.message() : "not found");
+        return false;
+    }
+    return true;
+}
+
+#ifdef _WIN32
+namespace {
+    struct CopyContext {
+        std::atomic<uint64_t>* doneBytes;
+        const std::atomic<bool>* cancelled;
+        uint64_t reported = 0;
+    };
+
+    DWORD CALLBACK copyProgress(LARGE_INTEGER, LARGE_INTEGER transferred, LARGE_INTEGER, LARGE_INTEGER, DWORD, DWORD,
+                                HANDLE, HANDLE, LPVOID data) {
+        auto* context = static_cast<CopyContext*>(data);
+        uint64_t now = static_cast<uint64_t>(transferred.QuadPart);
+        context->doneBytes->fetch_add(now - context->reported, std::memory_order_relaxed);
+        context->reported = now;
+        return context->cancelled->load(std::memory_order_relaxed) ? PROGRESS_CANCEL : PROGRESS_CONTINUE;
+    }
+}
+
+bool FileOperation::copyFile(const fs::path& from, const fs::path& to, uint64_t) {
+    if (isCancelled()) {
+        return false;
+    }
+    // CopyFileEx clones on ReFS block cloning volumes and offloads to the server on SMB by itself
+    CopyContext context{&m_doneBytes, &m_cancelled};
+    DWORD flags = m_options.overwrite ? 0 : COPY_FILE_FAIL_IF_EXISTS;
+    if (!CopyFileExW(from.c_str(), to.c_str(), copyProgress, &context, nullptr, flags)) {
+        if (!isCancelled()) {
+            addError(from, std::system_category().message(static_cast<int>(GetLastError())));
+        }
+        return false;
+    }
+    m_doneFiles.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+#else
+bool FileOperation::copyFile(const fs::path& from, const fs::path& to, uint64_t size) {
+    if (isCancelled()) {
+        return false;
+    }
+    int in = ::open(from.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        addError(from, std::strerror(errno));
+        return false;
+    }
+    struct stat info;
+    ::fstat(in, &info);
+    int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (m_options.overwrite ? O_TRUNC : O_EXCL);
+    int out = ::open(to.c_str(), flags, info.st_mode & 07777);
+    if (out < 0) {
+        addError(to, std::strerror(errno));
+        ::close(in);
+        return false;
+    }
+
+    bool ok = true;
+    uint64_t copied = 0;
+#ifdef __linux__
+    // Btrfs, XFS and friends share the extents, nothing is written at all
+    if (::ioctl(out, FICLONE, in) == 0) {
+        copied = size;
+        m_doneBytes.fetch_add(size, std::memory_order_relaxed);
+        m_clonedFiles.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        // In kernel copy, server side on NFS 4.2 and SMB
+        while (!isCancelled()) {
+            ssize_t count = ::copy_file_range(in, nullptr, out, nullptr, kCopyChunk, 0);
+            if (count < 0) {
+                if (copied == 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+                    break; // filesystem pair not supported, the read/write loop below takes over
+                }
+                addError(from, std::strerror(errno));
+                ok = false;
+                break;
+            }
+            if (count == 0) {
+                copied = std::max<uint64_t>(copied, 1); // done, also for empty files
+                break;
+            }
+            copied += static_cast<uint64_t>(count);
+            m_doneBytes.fetch_add(static_cast<uint64_t>(count), std::memory_order_relaxed);
+        }
+    }
+#endif
+    if (ok && copied == 0 && !isCancelled()) {
+        std::vector<char> buffer(std::min<size_t>(kCopyChunk, std::max<uint64_t>(size, 4096)));
+        while (!isCancelled()) {
+            ssize_t count = ::read(in, buffer.data(), buffer.size());
+            if (count <= 0) {
+                ok = count == 0;
+                if (!ok) {
+                    addError(from, std::strerror(errno));
+                }
+                break;
+            }
+            for (ssize_t written = 0; written < count;) {
+                ssize_t result = ::write(out, buffer.data() + written, static_cast<size_t>(count - written));
+                if (result < 0) {
+                    addError(to, std::strerror(errno));
+                    ok = false;
+                    break;
+                }
+                written += result;
+            }
+            if (!ok) {
+                break;
+            }
+            m_doneBytes.fetch_add(static_cast<uint64_t>(count), std::memory_order_relaxed);
+        }
+    }
+
+    if (ok && !isCancelled()) {
+        // Same timestamps as the original so comparisons and sorting by date still match
+        struct timespec times[2] = {info.st_atim, info.st_mtim};
+        ::futimens(out, times);
+    }
+    ::close(in);
+    if (::close(out) != 0 && ok) {
+        addError(to, std::strerror(errno));
+        ok = false;
+    }
+    if (!ok || isCancelled()) {
+        ::unlink(to.c_str());
+        return false;
+    }
+    m_doneFiles.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+#endif
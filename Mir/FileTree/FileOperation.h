@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utils/ThreadPool.h"
+
+// Copy, move or delete files and whole folders from the tree. Folders are walked once, files go
+// to a worker pool as they are found, so the first bytes move while a big tree is still being
+// listed. File contents are never read into this process where the OS can avoid it: a reflink
+// (FICLONE) first, then copy_file_range, CopyFileEx on Windows, plain read/write only as the
+// last resort.
+//
+//   auto operation = std::make_shared<FileOperation>(FileOperation::Kind::Copy, sources, targetFolder);
+//   std::async(std::launch::async, [operation] { operation->run(); });
+//   ... every frame: operation->getProgress(), operation->cancel() from a button
+//   ... when done: patch the tree with getCreated() / getRemoved()
+class FileOperation
+{
+public:
+    enum class Kind {
+        Copy,   // sources into destination, name clashes get " (2)" style names
+        Move,   // rename, copy + delete when crossing devices
+        Delete  // destination unused
+    };
+
+    struct Options {
+        size_t threadCount = 0;     // 0 = hardware concurrency
+        bool overwrite = false;     // replace existing files instead of picking a new name
+    };
+
+    struct Progress {
+        size_t totalFiles = 0;      // grows while folders are still being listed
+        size_t doneFiles = 0;
+        uint64_t totalBytes = 0;
+        uint64_t doneBytes = 0;
+        size_t clonedFiles = 0;     // copies that were a reflink, no data written
+        size_t errors = 0;
+        bool listing = true;        // totals are not final yet
+    };
+
+    FileOperation(Kind kind, std::vector<std::filesystem::path> sources, std::filesystem::path destination = {});
+    FileOperation(Kind kind, std::vector<std::filesystem::path> sources, std::filesystem::path destination, Options options);
+    ~FileOperation() = default;
+
+    // Blocking, run it on a worker thread. True when everything succeeded.
+    bool run();
+    // Thread safe. Files in flight stop at the next chunk, partial copies are removed.
+    void cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+    bool isCancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+    Progress getProgress() const;
+    Kind getKind() const { return m_kind; }
+
+    // After run(): top level entries that appeared and disappeared, to patch a FileTree in place
+    const std::vector<std::filesystem::path>& getCreated() const { return m_created; }
+    const std::vector<std::filesystem::path>& getRemoved() const { return m_removed; }
+    // First few failures as "path: reason", UTF-8
+    std::vector<std::string> getErrors() const;
+
+    // directory/name if that is free, otherwise "stem (2).ext", "stem (3).ext", ...
+    static std::filesystem::path uniquePath(const std::filesystem::path& directory, const std::filesystem::path& name);
+
+private:
+    Kind m_kind;
+    std::vector<std::filesystem::path> m_sources;
+    std::filesystem::path m_destination;
+    Options m_options;
+
+    std::atomic<bool> m_cancelled{false};
+    std::atomic<bool> m_listing{true};
+    std::atomic<size_t> m_totalFiles{0};
+    std::atomic<size_t> m_doneFiles{0};
+    std::atomic<uint64_t> m_totalBytes{0};
+    std::atomic<uint64_t> m_doneBytes{0};
+    std::atomic<size_t> m_clonedFiles{0};
+    std::atomic<size_t> m_errorCount{0};
+
+    mutable std::mutex m_errorMutex;
+    std::vector<std::string> m_errors;
+    static constexpr size_t kMaxErrorMessages = 64;
+    static constexpr size_t kMaxQueuedFiles = 4096;  // listing waits instead of queueing a whole tree
+
+    std::vector<std::filesystem::path> m_created;
+    std::vector<std::filesystem::path> m_removed;
+    std::unique_ptr<Mir::ThreadPool> m_pool;
+
+    bool copyTree(const std::filesystem::path& source, const std::filesystem::path& target);
+    bool deleteTree(const std::filesystem::path& source);
+    bool copyFile(const std::filesystem::path& from, const std::filesystem::path& to, uint64_t size);
+    void addError(const std::filesystem::path& path, std::string_view reason);
+};
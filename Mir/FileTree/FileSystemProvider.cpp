@@ -0,0 +1,94 @@
+#include "FileSystemProvider.h"
+#include "FileTree.h"
+#include "utils/Utils.h"
+
+namespace {
+    class NativeDirectoryReader : public FileSystemProvider::DirectoryReader {
+    public:
+        explicit NativeDirectoryReader(const std::filesystem::path& directory) : m_iterator(directory, m_ec) {}
+
+        bool failed() const { return static_cast<bool>(m_ec); }
+
+        bool next(FileSystemProvider::Entry& entry) override {
+            const std::filesystem::directory_iterator end;
+            while (!m_ec && m_iterator != end) {
+                bool listed = false;
+                try {
+                    listed = NativeFileSystem::toEntry(*m_iterator, false, entry);
+                }
+                catch (const std::exception&) { }
+                m_iterator.increment(m_ec);
+                if (listed) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        std::error_code m_ec;
+        std::filesystem::directory_iterator m_iterator;
+    };
+}
+
+std::shared_ptr<FileSystemProvider> FileSystemProvider::native() {
+    static std::shared_ptr<FileSystemProvider> provider = std::make_shared<NativeFileSystem>();
+    return provider;
+}
+
+bool NativeFileSystem::toEntry(const std::filesystem::directory_entry& _directoryEntry, bool _withMetadata, Entry& _entry) {
+    std::error_code ec;
+    if (_directoryEntry.is_directory(ec)) {
+        _entry.path = _directoryEntry.path();
+        _entry.type = FileType::DIR;
+        _entry.isSymlink = _directoryEntry.is_symlink(ec);
+        _entry.hasMetadata = false;
+        return true;
+    }
+    if (_directoryEntry.is_regular_file(ec)) {
+        _entry.path = _directoryEntry.path();
+        _entry.type = FileType::FILE;
+        _entry.isSymlink = false;
+        _entry.hasMetadata = false;
+#ifndef _WIN32
+        if (_withMetadata)
+#endif
+        {
+            _entry.size = _directoryEntry.file_size(ec);
+            _entry.modifiedTime = _directoryEntry.last_write_time(ec).time_since_epoch().count();
+            _entry.hasMetadata = true;
+        }
+        return true;
+    }
+    return false;
+}
+
+std::unique_ptr<FileSystemProvider::DirectoryReader> NativeFileSystem::openDirectory(const std::filesystem::path& _directory) {
+    auto reader = std::make_unique<NativeDirectoryReader>(_directory);
+    if (reader->failed()) {
+        return nullptr;
+    }
+    return reader;
+}
+
+bool NativeFileSystem::exists(const std::filesystem::path& _path) {
+    std::error_code ec;
+    return std::filesystem::exists(_path, ec);
+}
+
+void NativeFileSystem::loadMetadata(std::vector<std::unique_ptr<FileNode>>& _nodes, size_t _first) {
+    FileTree::loadMetadata(_nodes, _first);
+}
+
+bool NativeFileSystem::readFile(const std::filesystem::path& _path, std::string& _out) {
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(_path, ec)) {
+        return false;
+    }
+    _out = Mir::Utils::File::readFile(_path);
+    return true;
+}
+
+Mir::IoScheduler::DeviceId NativeFileSystem::deviceOf(const std::filesystem::path& _path) {
+    return Mir::IoScheduler::deviceOf(_path);
+}
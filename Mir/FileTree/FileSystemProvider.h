@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FileNode.h"
+#include "utils/IoScheduler.h"
+
+// Where FileTree reads directories and files from. The tree, its streaming expansions and the
+// prefetcher only list and read through the provider, so a different backend (MemoryFileSystem
+// for benchmarks) can stand in for the disk without the UI knowing.
+//
+// Implementations must be safe to call from several worker threads at once.
+class FileSystemProvider
+{
+public:
+    struct Entry {
+        std::filesystem::path path;
+        FileType type = FileType::FILE; // only files and directories are listed
+        bool isSymlink = false;
+        bool hasMetadata = false;       // size and time are set, otherwise loadMetadata fills them
+        uint64_t size = 0;
+        int64_t modifiedTime = 0;
+    };
+
+    // One listing in progress, owned by a single thread at a time
+    class DirectoryReader {
+    public:
+        virtual ~DirectoryReader() = default;
+        // false once the listing is done or failed
+        virtual bool next(Entry& entry) = 0;
+    };
+
+    virtual ~FileSystemProvider() = default;
+
+    // nullptr if the directory cannot be listed
+    virtual std::unique_ptr<DirectoryReader> openDirectory(const std::filesystem::path& directory) = 0;
+    virtual bool exists(const std::filesystem::path& path) = 0;
+    // Size and time for the files in nodes[first..] that were listed without them
+    virtual void loadMetadata(std::vector<std::unique_ptr<FileNode>>& nodes, size_t first = 0) = 0;
+    virtual bool readFile(const std::filesystem::path& path, std::string& out) = 0;
+    // IoScheduler queue for path, each device gets its own
+    virtual Mir::IoScheduler::DeviceId deviceOf(const std::filesystem::path& path) = 0;
+    // Paths are real files, so code that works on the disk directly (file operations, diffs,
+    // the content sniffer, follow mode) may use them
+    virtual bool isNative() const { return false; }
+
+    // The local disk, default for every FileTree
+    static std::shared_ptr<FileSystemProvider> native();
+};
+
+// std::filesystem listing with BatchIo stats, what FileTree always did
+class NativeFileSystem : public FileSystemProvider
+{
+public:
+    std::unique_ptr<DirectoryReader> openDirectory(const std::filesystem::path& directory) override;
+    bool exists(const std::filesystem::path& path) override;
+    void loadMetadata(std::vector<std::unique_ptr<FileNode>>& nodes, size_t first = 0) override;
+    bool readFile(const std::filesystem::path& path, std::string& out) override;
+    Mir::IoScheduler::DeviceId deviceOf(const std::filesystem::path& path) override;
+    bool isNative() const override { return true; }
+
+    // false for anything that is not a file or directory. Without metadata, file size and time are
+    // left for loadMetadata, except on Windows where the listing already has them.
+    static bool toEntry(const std::filesystem::directory_entry& directoryEntry, bool withMetadata, Entry& entry);
+};
@@ -3,124 +3,354 @@
 #include "FileTree.h"
 #include <functional>
 #include <algorithm>
-FileTree::~FileTree() {}
+#include <cassert>
+#include <chrono>
+#include "utils/Profiler.h"
+#include "utils/Utils.h"
+#include "utils/Redraw.h"
+#include "utils/BatchIo.h"
+#include "utils/Epoch.h"
+#include "TreeExporter.h"
+FileTree::~FileTree() {
+    cancelExpansions();
+    // Whoever destroys the tree no longer reads it, anything still retired can go
+    Mir::Epoch::collect();
+}
 
 FileTree::FileTree() : FileTree(fs::current_path()) {}
 
 FileTree::FileTree(const fs::path& _folder) {
-    m_rootNode = buildFileTree(_folder);
-    m_currentNode = m_rootNode.get(); 
+    publishRoot(buildFileTree(_folder));
+    resetResident();
+}
+
+FileTree::FileTree(const fs::path& _folder, std::shared_ptr<FileSystemProvider> _provider) : m_provider(std::move(_provider)) {
+    m_prefetcher.setProvider(m_provider);
+    publishRoot(buildFileTree(_folder));
+    resetResident();
 }
 
 std::unique_ptr<FileNode> FileTree::buildFileTree(const fs::path& _folder) {
-    auto filename = _folder.filename().empty() ? fs::path(_folder).wstring() : _folder.filename().wstring();
-    auto rootNode = std::make_unique<FileNode>(filename, FileType::DIR);
+    MIR_PROFILE_SCOPE("FileTree::buildFileTree");
+    auto filename = _folder.filename().empty() ? _folder : _folder.filename();
+    auto rootNode = std::make_unique<FileNode>(makeNodeName(filename), FileType::DIR);
     
     rootNode->fullPath = _folder;
     
     try {
-        if (!fs::exists(_folder)) {
+        if (!m_provider->exists(_folder)) {
             return rootNode;
         }
         
         rootNode->children.reserve(16);
-        
-        std::error_code ec; // Use error_code to avoid exceptions (faster) copilot :)
-        for (const auto& entry : fs::directory_iterator(_folder, ec)) {
-            if (ec) {
-                break;
-            }
-            
-            try {
-                auto filePath = entry.path();
-                
-                if (fs::is_directory(entry, ec)) {
-                    auto childNode = std::make_unique<FileNode>(filePath.filename().wstring(), FileType::DIR);
-                    childNode->fullPath = filePath;
-                    childNode->hasUnexpandedChildren = true; 
-                    rootNode->addChild(std::move(childNode));
-                }
-                else if (fs::is_regular_file(entry, ec)) {
-                    auto fileNode = std::make_unique<FileNode>(filePath.filename().wstring(), FileType::FILE);
-                    fileNode->size = fs::file_size(entry, ec);
-                    fileNode->fullPath = filePath;
-                    rootNode->addChild(std::move(fileNode));
-                }
-            }
-            catch (const std::exception&) { } 
-        }
+        listDirectory(_folder, *m_provider, rootNode->children);
     }
     catch (const std::exception&) { }
     sortChildren(rootNode.get());
     return rootNode;
 }
 
-void FileTree::printFileTree(FileNode* _node, int _depth) {
-    std::wstring indent(_depth * 2, L' ');
-    
-    std::wcout << indent;
-    if (_node->type == FileType::DIR) {
-        std::wcout << L"[DIR] " << _node->name << std::endl;
+void FileTree::listDirectory(const fs::path& _folder, FileSystemProvider& _provider, std::vector<std::unique_ptr<FileNode>>& _children) {
+    if (auto reader = _provider.openDirectory(_folder)) {
+        FileSystemProvider::Entry entry;
+        while (reader->next(entry)) {
+            try {
+                _children.push_back(makeNode(std::move(entry)));
+            }
+            catch (const std::exception&) { }
+        }
+    }
+    _provider.loadMetadata(_children);
+}
+
+std::string FileTree::makeNodeName(const fs::path& _filename) {
+    // Names are converted once here, the renderer uses them as is every frame
+    std::string name = Mir::Utils::File::toUtf8(_filename);
+    if (!Mir::Utils::Text::isValidUtf8(name)) {
+        name = Mir::Utils::Text::sanitizeUtf8(name);
+    }
+    return name;
+}
+
+std::unique_ptr<FileNode> FileTree::makeNode(const fs::directory_entry& _entry, bool _withMetadata) {
+    FileSystemProvider::Entry entry;
+    if (!NativeFileSystem::toEntry(_entry, _withMetadata, entry)) {
+        return nullptr;
+    }
+    return makeNode(std::move(entry));
+}
+
+std::unique_ptr<FileNode> FileTree::makeNode(FileSystemProvider::Entry&& _entry) {
+    auto node = std::make_unique<FileNode>(makeNodeName(_entry.path.filename()), _entry.type);
+    if (_entry.type == FileType::DIR) {
+        node->hasUnexpandedChildren = true;
+        node->isSymlink = _entry.isSymlink;
     } else {
-        std::wcout << L"[FILE] " << _node->name << L" (" << _node->size << L" bytes)" << std::endl;
+        if (_entry.hasMetadata) {
+            node->size = static_cast<size_t>(_entry.size);
+            node->modifiedTime = _entry.modifiedTime;
+        }
+        // Expands through TarArchive, stays a FILE for everything that reads it from disk
+        node->isArchive = TarArchive::isArchiveName(_entry.path);
+        node->hasUnexpandedChildren = node->isArchive;
     }
-    
-    for (const auto& child : _node->children) {
-        printFileTree(child.get(), _depth + 1);
+    node->fullPath = std::move(_entry.path);
+    return node;
+}
+
+void FileTree::loadMetadata(std::vector<std::unique_ptr<FileNode>>& _nodes, size_t _first) {
+#ifndef _WIN32
+    MIR_PROFILE_SCOPE("FileTree::loadMetadata");
+    // One ring per scanning thread, set up on first use
+    thread_local Mir::Utils::File::BatchIo io;
+    thread_local std::vector<const fs::path*> paths;
+    thread_local std::vector<FileNode*> files;
+    thread_local std::vector<Mir::Utils::File::FileStat> results;
+    paths.clear();
+    files.clear();
+    for (size_t i = _first; i < _nodes.size(); i++) {
+        if (_nodes[i]->type == FileType::FILE) {
+            paths.push_back(&_nodes[i]->fullPath);
+            files.push_back(_nodes[i].get());
+        }
+    }
+    if (files.empty()) {
+        return;
+    }
+    io.stat(paths, results);
+    for (size_t i = 0; i < files.size(); i++) {
+        if (results[i].ok) {
+            files[i]->size = results[i].size;
+            files[i]->modifiedTime = results[i].modifiedTime;
+        }
     }
+#endif
 }
+
 void FileTree::print() {
-    printFileTree(m_rootNode.get());
+    std::lock_guard lock(m_writeMutex);
+    if (!m_rootNode) {
+        return;
+    }
+    // One buffered write per MB instead of a flush per line
+    std::cout.flush();
+    Mir::Utils::File::BufferedWriter out;
+    TreeExporter exporter(out, {});
+    exporter.exportNode(*m_rootNode);
 }
 void FileTree::setRootFolder(const fs::path& _folder) {
+    std::lock_guard lock(m_writeMutex);
     if (!_folder.empty())
     {
-        m_rootNode = buildFileTree(_folder);
-        m_currentNode = m_rootNode.get(); 
+        cancelExpansions();
+        m_prefetcher.clear();
+        m_archives.clear();
+        if (m_ignoring) {
+            m_ignoring->setRoot(_folder);
+        }
+        publishRoot(buildFileTree(_folder));
+        resetResident();
+        openGitStatus();
     }else{
         std::cout << "[FileTree::setRootFolder] tried to set empty root path" << "\n";
     }
     
 }
 
+void FileTree::setProvider(std::shared_ptr<FileSystemProvider> _provider, const fs::path& _rootFolder) {
+    if (!_provider) {
+        std::cout << "[FileTree::setProvider] tried to set empty provider" << "\n";
+        return;
+    }
+    std::lock_guard lock(m_writeMutex);
+    // Nodes and cached listings of the old provider mean nothing to the new one
+    cancelExpansions();
+    if (m_ignoring) {
+        m_ignoring = std::make_shared<IgnoringFileSystem>(std::move(_provider), m_ignoring->getOptions());
+        m_provider = m_ignoring;
+    } else {
+        m_provider = std::move(_provider);
+    }
+    m_prefetcher.setProvider(m_provider);
+    setRootFolder(_rootFolder);
+}
+
+void FileTree::setIgnoreRules(bool _enabled, IgnoringFileSystem::Options _options) {
+    std::lock_guard lock(m_writeMutex);
+    cancelExpansions();
+    std::shared_ptr<FileSystemProvider> source = m_ignoring ? m_ignoring->getSource() : m_provider;
+    if (_enabled) {
+        m_ignoring = std::make_shared<IgnoringFileSystem>(std::move(source), std::move(_options));
+        m_provider = m_ignoring;
+    } else {
+        m_ignoring.reset();
+        m_provider = std::move(source);
+    }
+    m_prefetcher.setProvider(m_provider);
+    if (m_rootNode) {
+        setRootFolder(m_rootNode->fullPath);
+    }
+}
 
-bool FileTree::expandNode(FileNode* node) {
-    if (!node || node->type != FileType::DIR || !node->hasUnexpandedChildren) {
+bool FileTree::setGitStatus(bool _enabled, GitStatusOverlay::Options _options) {
+    std::lock_guard lock(m_writeMutex);
+    if (!_enabled) {
+        m_gitStatus.reset();
+        if (m_rootNode) {
+            std::function<void(FileNode*)> clear = [&](FileNode* node) {
+                node->gitStatus = GitStatus::None;
+                for (const auto& child : node->children) {
+                    clear(child.get());
+                }
+            };
+            clear(m_rootNode.get());
+        }
+        return true;
+    }
+    m_gitStatus = std::make_unique<GitStatusOverlay>(_options);
+    openGitStatus();
+    if (!m_gitStatus->isOpen()) {
+        std::cout << "[FileTree::setGitStatus] " << (m_gitStatus->getError().empty() ? "Not a folder on disk" : m_gitStatus->getError()) << "\n";
         return false;
     }
-    node->children.clear();
-    node->hasUnexpandedChildren = false;
-    
-    try {
-        std::error_code ec;
-        
-        for (const auto& entry : fs::directory_iterator(node->fullPath, ec)) {
-            auto filePath = entry.path();
-            
-            if (fs::is_directory(entry, ec)) {
-                auto childNode = std::make_unique<FileNode>(filePath.filename().wstring(), FileType::DIR);
-                childNode->fullPath = filePath;
-                childNode->hasUnexpandedChildren = true;
-                node->addChild(std::move(childNode));
-            }
-            else if (fs::is_regular_file(entry, ec)) {
-                auto fileNode = std::make_unique<FileNode>(filePath.filename().wstring(), FileType::FILE);
-                fileNode->size = fs::file_size(entry, ec);
-                fileNode->fullPath = filePath;
-                node->addChild(std::move(fileNode));
-            }
+    return true;
+}
+
+void FileTree::openGitStatus() {
+    if (!m_gitStatus) {
+        return;
+    }
+    // Archives and made up providers have no working tree to compare
+    if (!m_rootNode || !m_provider->isNative()) {
+        m_gitStatus->close();
+        return;
+    }
+    if (m_gitStatus->open(m_rootNode->fullPath)) {
+        annotateLoaded(m_rootNode.get());
+    }
+}
+
+void FileTree::annotateGitStatus(FileNode* node, size_t first, size_t count) {
+    if (m_gitStatus) {
+        m_gitStatus->annotate(*this, node, first, count);
+    }
+}
+
+void FileTree::annotateLoaded(FileNode* node) {
+    // Parents first, untracked and ignored folders pass their status on
+    annotateGitStatus(node);
+    for (const auto& child : node->children) {
+        if (child->type == FileType::DIR && !child->children.empty()) {
+            annotateLoaded(child.get());
         }
-        
-        sortChildren(node);
-        return true;
+    }
+}
+
+void FileTree::setRootNode(std::unique_ptr<FileNode> _root) {
+    if (!_root) {
+        std::cout << "[FileTree::setRootNode] tried to set empty root node" << "\n";
+        return;
+    }
+    std::lock_guard lock(m_writeMutex);
+    cancelExpansions();
+    m_prefetcher.clear();
+    m_archives.clear();
+    publishRoot(std::move(_root));
+    resetResident();
+    // Diff results carry their own markers
+    if (m_gitStatus) {
+        m_gitStatus->close();
+    }
+}
+
+bool FileTree::expandNode(FileNode* node) {
+    MIR_PROFILE_SCOPE("FileTree::expandNode");
+    // Keeps node alive while the lock is not held, a refresh may retire it meanwhile
+    Mir::Epoch::ReadGuard guard;
+    std::shared_ptr<FileSystemProvider> provider;
+    {
+        std::lock_guard lock(m_writeMutex);
+        // Readers may hand in a node an earlier eviction or refresh unlinked
+        if (!node || node->isDetached) {
+            return false;
+        }
+        if (node->isArchive || node->isVirtual) {
+            return expandArchive(node);
+        }
+        if (node->type != FileType::DIR || !node->hasUnexpandedChildren) {
+            return false;
+        }
+        if (takePrefetched(node)) {
+            return true;
+        }
+        provider = m_provider;
+    }
+
+    // The listing may block for a long time (network drives), the renderer keeps drawing and
+    // other writers keep going until the result is spliced in below
+    std::vector<std::unique_ptr<FileNode>> children;
+    bool complete = true;
+    try {
+        listDirectory(node->fullPath, *provider, children);
     }
     catch (const std::exception& e) {
+        // Whatever was listed before the error stays
         std::cerr << "Error expanding node: " << e.what() << std::endl;
+        complete = false;
+    }
+
+    std::lock_guard lock(m_writeMutex);
+    // Expanded by someone else, unlinked or listed through a provider that is gone meanwhile
+    if (node->isDetached || !node->hasUnexpandedChildren || provider != m_provider) {
+        return false;
+    }
+    retireChildren(node);
+    node->children = std::move(children);
+    node->hasUnexpandedChildren = false;
+    markExpanded(node);
+    sortChildren(node);
+    node->publishChildren();
+    addResident(node->children);
+    annotateGitStatus(node);
+    if (complete) {
+        prefetchChildDirs(node);
+    }
+    return complete;
+}
+
+Mir::Generator<const WalkEntry&> FileTree::walk(WalkOptions options) const {
+    if (options.maxDepth < 0) {
+        options.maxDepth = m_maxDepth;
+    }
+    // Not a coroutine itself, the generator only holds copies and never this
+    FileNode* root = getRootNode();
+    return walkDirectory(root ? root->fullPath : fs::path(), std::move(options));
+}
+
+bool FileTree::loadChildren(FileNode* node, FileSystemProvider& provider) {
+    if (!node || node->type != FileType::DIR || !node->hasUnexpandedChildren) {
         return false;
     }
+    node->children.clear();
+    node->hasUnexpandedChildren = false;
+    listDirectory(node->fullPath, provider, node->children);
+    return true;
+}
+
+void FileTree::adoptLoadedChildren(FileNode* node) {
+    std::lock_guard lock(m_writeMutex);
+    if (!node || node->isDetached) {
+        return;
+    }
+    sortChildren(node);
+    node->publishChildren();
+    markExpanded(node);
+    addResident(node->children);
+    annotateGitStatus(node);
 }
 
 std::vector<FileNode*> FileTree::getCurrentChildren() const {
+    std::lock_guard lock(m_writeMutex);
     std::vector<FileNode*> result;
     if (!m_currentNode) return result;
     
@@ -131,111 +361,715 @@ std::vector<FileNode*> FileTree::getCurrentChildren() const {
 }
 
 fs::path FileTree::getCurrentPath() const {
+    std::lock_guard lock(m_writeMutex);
     return m_currentNode ? m_currentNode->fullPath : fs::path();
 }
 
+fs::path FileTree::getRootFolder() const {
+    // The renderer asks before the tree is initialized, and a refresh may retire the root meanwhile
+    Mir::Epoch::ReadGuard guard;
+    FileNode* root = getRootNode();
+    return root ? root->fullPath : fs::path();
+}
+
 void FileTree::setSortCriteria(SortCriteria criteria) {
+    std::lock_guard lock(m_writeMutex);
     if (m_sortCriteria != criteria) {
         m_sortCriteria = criteria;
         // Resort current node if it exists
         if (m_currentNode) {
             sortChildren(m_currentNode);
+            m_currentNode->publishChildren();
         }
     }
 }
 
 void FileTree::refreshRootNode() {
-    fs::path currentPath = m_rootNode->fullPath;
-    m_rootNode = buildFileTree(currentPath);
-    m_currentNode = m_rootNode.get();
+    fs::path currentPath;
+    std::string rootName;
+    std::shared_ptr<FileSystemProvider> provider;
+    {
+        std::lock_guard lock(m_writeMutex);
+        if (!m_rootNode) {
+            return; // nothing to refresh before setRootNode()
+        }
+        cancelExpansions();
+        m_prefetcher.clear();
+        currentPath = m_rootNode->fullPath;
+        rootName = m_rootNode->name;
+        if (m_ignoring) {
+            // .gitignore files may have changed as well
+            m_ignoring->setRoot(currentPath);
+        }
+        provider = m_provider;
+    }
+
+    // Listed without the lock like expandNode, the old tree stays up until the new one is ready
+    auto root = std::make_unique<FileNode>(rootName, FileType::DIR);
+    root->fullPath = currentPath;
+    try {
+        if (provider->exists(currentPath)) {
+            listDirectory(currentPath, *provider, root->children);
+        }
+    }
+    catch (const std::exception&) { }
+
+    std::lock_guard lock(m_writeMutex);
+    // A new root or provider was set meanwhile and already replaced the tree
+    if (provider != m_provider || !m_rootNode || m_rootNode->fullPath != currentPath) {
+        return;
+    }
+    // Expansions started on the old tree meanwhile
+    cancelExpansions();
+    sortChildren(root.get());
+    publishRoot(std::move(root));
+    resetResident();
+    // The index is read again, commits and checkouts change it
+    openGitStatus();
 }
 
 void FileTree::sortChildren(FileNode* node) {
+    MIR_PROFILE_SCOPE("FileTree::sortChildren");
     if (!node || node->children.empty()) return;
     
-    switch (m_sortCriteria) {
+    std::sort(node->children.begin(), node->children.end(), 
+        [criteria = m_sortCriteria](const std::unique_ptr<FileNode>& a, const std::unique_ptr<FileNode>& b) {
+            return lessThan(criteria, a, b);
+        });
+}
+
+bool FileTree::lessThan(SortCriteria criteria, const std::unique_ptr<FileNode>& a, const std::unique_ptr<FileNode>& b) {
+    using Mir::Utils::Text::compareCaseInsensitive;
+    switch (criteria) {
         case SortCriteria::TypeThenName:
-            std::sort(node->children.begin(), node->children.end(), 
-                [](const std::unique_ptr<FileNode>& a, const std::unique_ptr<FileNode>& b) {
-                    if (a->type != b->type) {
-                        return a->type == FileType::DIR;
-                    }
-                    
-                    std::wstring nameA = a->name;
-                    std::wstring nameB = b->name;
-                    
-                    std::transform(nameA.begin(), nameA.end(), nameA.begin(), ::towlower);
-                    std::transform(nameB.begin(), nameB.end(), nameB.begin(), ::towlower);
-                    
-                    return nameA < nameB;
-                });
+            if (a->type != b->type) {
+                return a->type == FileType::DIR;
+            }
             break;
             
         case SortCriteria::Extension:
-            std::sort(node->children.begin(), node->children.end(), 
-                [](const std::unique_ptr<FileNode>& a, const std::unique_ptr<FileNode>& b) {
-                    if (a->type != b->type) {
-                        return a->type == FileType::DIR;
-                    }
-                    
-                    if (a->type == FileType::FILE) {
-                        auto extA = a->fullPath.extension().wstring();
-                        auto extB = b->fullPath.extension().wstring();
-                        
-                        std::transform(extA.begin(), extA.end(), extA.begin(), ::towlower);
-                        std::transform(extB.begin(), extB.end(), extB.begin(), ::towlower);
-                        
-                        if (extA != extB) {
-                            return extA < extB;
-                        }
-                    }
-                    
-                    std::wstring nameA = a->name;
-                    std::wstring nameB = b->name;
-                    
-                    std::transform(nameA.begin(), nameA.end(), nameA.begin(), ::towlower);
-                    std::transform(nameB.begin(), nameB.end(), nameB.begin(), ::towlower);
-                    
-                    return nameA < nameB;
-                });
+            if (a->type != b->type) {
+                return a->type == FileType::DIR;
+            }
+            if (a->type == FileType::FILE) {
+                int byExtension = compareCaseInsensitive(a->getExtension(), b->getExtension());
+                if (byExtension != 0) {
+                    return byExtension < 0;
+                }
+            }
             break;
             
         case SortCriteria::Name:
-            std::sort(node->children.begin(), node->children.end(), 
-                [](const std::unique_ptr<FileNode>& a, const std::unique_ptr<FileNode>& b) {
-                    std::wstring nameA = a->name;
-                    std::wstring nameB = b->name;
-                    
-                    std::transform(nameA.begin(), nameA.end(), nameA.begin(), ::towlower);
-                    std::transform(nameB.begin(), nameB.end(), nameB.begin(), ::towlower);
-                    
-                    return nameA < nameB;
-                });
             break;
             
         case SortCriteria::Size:
-            std::sort(node->children.begin(), node->children.end(), 
-                [](const std::unique_ptr<FileNode>& a, const std::unique_ptr<FileNode>& b) {
-                    if (a->type != b->type) {
-                        return a->type == FileType::DIR;
-                    }
-                    
-                    if (a->type == FileType::FILE) {
-                        if (a->size != b->size) {
-                            return a->size > b->size; // Descending order
-                        }
-                    }
-                    
-                    std::wstring nameA = a->name;
-                    std::wstring nameB = b->name;
-                    
-                    std::transform(nameA.begin(), nameA.end(), nameA.begin(), ::towlower);
-                    std::transform(nameB.begin(), nameB.end(), nameB.begin(), ::towlower);
-                    
-                    return nameA < nameB;
-                });
+            if (a->type != b->type) {
+                return a->type == FileType::DIR;
+            }
+            if (a->type == FileType::FILE && a->size != b->size) {
+                return a->size > b->size; // Descending order
+            }
+            break;
+
+        case SortCriteria::DateModified:
+            if (a->type != b->type) {
+                return a->type == FileType::DIR;
+            }
+            if (a->modifiedTime != b->modifiedTime) {
+                return a->modifiedTime > b->modifiedTime; // Newest first
+            }
+            break;
+    }
+    return compareCaseInsensitive(a->name, b->name) < 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Streaming expansion START
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+bool FileTree::expandNodeAsync(FileNode* node) {
+    // Archive listings are in memory once indexed, nothing to stream. expandNode lists
+    // without the lock, so it is not called with it held.
+    if (!m_streamingExpansion || (node && (node->isArchive || node->isVirtual))) {
+        return expandNode(node);
+    }
+    std::lock_guard lock(m_writeMutex);
+    if (!node || node->isDetached || node->type != FileType::DIR || !node->hasUnexpandedChildren) {
+        return false;
+    }
+    if (takePrefetched(node)) {
+        return true;
+    }
+    retireChildren(node);
+    node->hasUnexpandedChildren = false;
+    node->isLoading = true;
+    node->hasMoreEntries = false;
+    markExpanded(node);
+
+    auto job = std::make_shared<ExpansionJob>();
+    job->path = node->fullPath;
+    job->provider = m_provider;
+    job->limit = m_expansionLimit;
+    m_expansions[node] = job;
+    node->scanProgress.store(&job->scanned, std::memory_order_release);
+    submitExpansionJob(job);
+    return true;
+}
+
+void FileTree::submitExpansionJob(const std::shared_ptr<ExpansionJob>& job) {
+    if (job->device == 0) {
+        job->device = m_provider->deviceOf(job->path);
+    }
+    // Workers only hold the job, never the node, so the tree can drop nodes at any time
+    Mir::IoScheduler::shared().submit(job->device, job->priority.load(std::memory_order_relaxed), [job]() { return runExpansionJob(job); });
+}
+
+size_t FileTree::runExpansionJob(const std::shared_ptr<ExpansionJob>& job) {
+    MIR_PROFILE_SCOPE("FileTree::runExpansionJob");
+    size_t operations = 0;
+    if (!job->started) {
+        job->started = true;
+        job->reader = job->provider->openDirectory(job->path);
+        operations++;
+    }
+
+    size_t limit;
+    {
+        std::lock_guard lock(job->mutex);
+        limit = job->limit;
+    }
+
+    std::vector<std::unique_ptr<FileNode>> batch;
+    size_t batchSize = job->delivered == 0 ? kFirstBatchSize : kBatchSize;
+    auto publish = [&](bool paused, bool finished) {
+        job->provider->loadMetadata(batch);
+        {
+            std::lock_guard lock(job->mutex);
+            for (auto& node : batch) {
+                job->pending.push_back(std::move(node));
+            }
+            job->paused = paused;
+            job->finished = finished;
+        }
+        batch.clear();
+        Mir::Redraw::request();
+    };
+
+    FileSystemProvider::Entry entry;
+    while (job->reader) {
+        if (job->cancelled.load(std::memory_order_relaxed)) {
+            return 0;
+        }
+        if (limit != 0 && job->delivered >= limit) {
+            publish(true, false);
+            return operations;
+        }
+        if (!job->reader->next(entry)) {
+            break;
+        }
+        operations++;
+        try {
+            batch.push_back(makeNode(std::move(entry)));
+            job->delivered++;
+        }
+        catch (const std::exception&) { }
+        job->scanned.fetch_add(1, std::memory_order_relaxed);
+
+        if (batch.size() >= batchSize) {
+            publish(false, false);
+            // One batch per turn, then back into the queue at the current priority so visible
+            // folders and other devices are not stuck behind one huge listing. The listing may
+            // end right there, the next turn then only publishes the finish.
+            Mir::IoScheduler::shared().submit(job->device, job->priority.load(std::memory_order_relaxed), [job]() { return runExpansionJob(job); });
+            return operations;
+        }
+    }
+    // Done with the listing, a slow provider may hold a connection for it
+    job->reader.reset();
+    publish(false, true);
+    return operations;
+}
+
+void FileTree::pumpExpansions() {
+    MIR_PROFILE_SCOPE("FileTree::pumpExpansions");
+    std::lock_guard lock(m_writeMutex);
+    for (auto it = m_expansions.begin(); it != m_expansions.end();) {
+        FileNode* node = it->first;
+        ExpansionJob& job = *it->second;
+        // touch() stamps folders the renderer drew, m_frame moves on once per frame
+        bool visible = node->lastShown.load(std::memory_order_relaxed) + 1 >= m_frame.load(std::memory_order_relaxed);
+        job.priority.store(visible ? Mir::IoPriority::Visible : Mir::IoPriority::Normal, std::memory_order_relaxed);
+
+        std::vector<std::unique_ptr<FileNode>> incoming;
+        bool paused, finished;
+        {
+            std::lock_guard lock(job.mutex);
+            paused = job.paused;
+            finished = job.finished;
+            // Merging costs O(children), waiting until the batch is a quarter of the
+            // children keeps the total cost O(n log n) instead of quadratic
+            bool worthMerging = node->children.size() < kFirstBatchSize
+                || job.pending.size() >= std::max(kFirstBatchSize, node->children.size() / 4);
+            if (!job.pending.empty() && (worthMerging || paused || finished)) {
+                incoming.swap(job.pending);
+            }
+        }
+
+        if (!incoming.empty()) {
+            auto compare = [criteria = m_sortCriteria](const std::unique_ptr<FileNode>& a, const std::unique_ptr<FileNode>& b) {
+                return lessThan(criteria, a, b);
+            };
+            if (m_gitStatus) {
+                m_gitStatus->annotate(*this, node, incoming);
+            }
+            std::sort(incoming.begin(), incoming.end(), compare);
+            // Counted before the merge, afterwards the batch is spread over the whole vector
+            addResident(incoming);
+            size_t existing = node->children.size();
+            node->children.reserve(existing + incoming.size());
+            for (auto& child : incoming) {
+                node->children.push_back(std::move(child));
+            }
+            std::inplace_merge(node->children.begin(), node->children.begin() + existing, node->children.end(), compare);
+            node->publishChildren();
+        }
+
+        node->isLoading = !paused && !finished;
+        node->hasMoreEntries = paused;
+        // The listing is complete (or complete for now), only the check for deleted files is left
+        if (finished || paused) {
+            annotateGitStatus(node, node->children.size(), 0);
+        }
+        if (finished) {
+            prefetchChildDirs(node);
+            it = dropExpansion(it);
+        } else {
+            ++it;
+        }
+    }
+    if (m_gitStatus) {
+        m_gitStatus->pump(*this);
+    }
+    // Once a frame, between the renderer's read guards
+    Mir::Epoch::collect();
+}
+
+bool FileTree::loadMore(FileNode* node) {
+    std::lock_guard lock(m_writeMutex);
+    auto it = m_expansions.find(node);
+    if (it == m_expansions.end()) {
+        return false;
+    }
+    auto& job = it->second;
+    {
+        std::lock_guard lock(job->mutex);
+        if (!job->paused || !job->pending.empty()) {
+            return false;
+        }
+        job->paused = false;
+        job->limit += m_expansionLimit == 0 ? job->limit : m_expansionLimit;
+    }
+    node->isLoading = true;
+    node->hasMoreEntries = false;
+    submitExpansionJob(job);
+    return true;
+}
+
+size_t FileTree::getScannedCount(const FileNode* node) const {
+    const std::atomic<size_t>* scanned = node->scanProgress.load(std::memory_order_acquire);
+    return scanned ? scanned->load(std::memory_order_relaxed) : node->readChildren().size();
+}
+
+void FileTree::cancelExpansions() {
+    for (auto it = m_expansions.begin(); it != m_expansions.end();) {
+        it = dropExpansion(it);
+    }
+}
+
+FileTree::ExpansionMap::iterator FileTree::dropExpansion(ExpansionMap::iterator it) {
+    auto& [node, job] = *it;
+    job->cancelled.store(true, std::memory_order_relaxed);
+    node->scanProgress.store(nullptr, std::memory_order_release);
+    // The renderer may be reading the counter through the node right now
+    Mir::Epoch::retire(std::move(job));
+    return m_expansions.erase(it);
+}
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Streaming expansion END
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Prefetching START
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+void FileTree::prefetch(FileNode* node) {
+    // The prefetcher has its own lock, the renderer calls this for every hovered folder
+    if (node && !node->isDetached && node->type == FileType::DIR && node->hasUnexpandedChildren && !node->isVirtual) {
+        m_prefetcher.request(node->fullPath);
+    }
+}
+
+bool FileTree::takePrefetched(FileNode* node) {
+    std::vector<std::unique_ptr<FileNode>> children;
+    if (!m_prefetcher.take(node->fullPath, children)) {
+        return false;
+    }
+    retireChildren(node);
+    node->children = std::move(children);
+    node->hasUnexpandedChildren = false;
+    node->isLoading = false;
+    node->hasMoreEntries = false;
+    markExpanded(node);
+    sortChildren(node);
+    node->publishChildren();
+    addResident(node->children);
+    annotateGitStatus(node);
+    prefetchChildDirs(node);
+    return true;
+}
+
+void FileTree::prefetchChildDirs(FileNode* node) {
+    // After opening a folder the next click is usually one of its first subfolders
+    size_t requested = 0;
+    for (const auto& child : node->children) {
+        if (requested >= kPrefetchChildDirs) {
+            break;
+        }
+        if (child->type == FileType::DIR && child->hasUnexpandedChildren) {
+            m_prefetcher.request(child->fullPath);
+            requested++;
+        }
+    }
+}
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Prefetching END
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Patching START
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+FileNode* FileTree::findNode(const fs::path& _path) const {
+    std::lock_guard lock(m_writeMutex);
+    if (!m_rootNode) {
+        return nullptr;
+    }
+    fs::path relative = _path.lexically_normal().lexically_relative(m_rootNode->fullPath.lexically_normal());
+    if (relative.empty() || *relative.begin() == "..") {
+        return nullptr;
+    }
+    FileNode* node = m_rootNode.get();
+    for (const fs::path& part : relative) {
+        if (part == "." || part.empty()) {
+            continue;
+        }
+        auto it = std::find_if(node->children.begin(), node->children.end(),
+            [&](const std::unique_ptr<FileNode>& child) { return child->fullPath.filename() == part; });
+        if (it == node->children.end()) {
+            return nullptr;
+        }
+        node = it->get();
+    }
+    return node;
+}
+
+bool FileTree::insertPath(const fs::path& _path) {
+    std::lock_guard lock(m_writeMutex);
+    // Only loaded folders are patched, the others read the change when they are opened
+    FileNode* parent = findNode(_path.parent_path());
+    if (!parent || parent->type != FileType::DIR || parent->hasUnexpandedChildren || parent->isLoading) {
+        return false;
+    }
+    std::error_code ec;
+    std::unique_ptr<FileNode> node = makeNode(fs::directory_entry(_path, ec));
+    if (ec || !node) {
+        return false;
+    }
+    // Overwritten entries are replaced so size and time are fresh
+    removePath(_path);
+
+    m_residentNodes++;
+    m_residentBytes += node->getMemoryFootprint();
+    auto criteria = m_sortCriteria;
+    auto position = std::lower_bound(parent->children.begin(), parent->children.end(), node,
+        [criteria](const auto& a, const auto& b) { return lessThan(criteria, a, b); });
+    position = parent->children.insert(position, std::move(node));
+    parent->publishChildren();
+    annotateGitStatus(parent, static_cast<size_t>(position - parent->children.begin()), 1);
+    // A cached listing of the parent is out of date now
+    m_prefetcher.clear();
+    return true;
+}
+
+bool FileTree::removePath(const fs::path& _path) {
+    std::lock_guard lock(m_writeMutex);
+    FileNode* node = findNode(_path);
+    if (!node || node == m_rootNode.get()) {
+        return false;
+    }
+    FileNode* parent = findNode(_path.parent_path());
+    if (!parent) {
+        return false;
+    }
+    releaseChildren(node);
+    removeResident(node);
+    if (auto expansion = m_expansions.find(node); expansion != m_expansions.end()) {
+        dropExpansion(expansion);
+    }
+    m_expandedDirs.erase(node);
+    if (m_currentNode == node) {
+        m_currentNode = parent;
+    }
+    auto owner = std::find_if(parent->children.begin(), parent->children.end(),
+        [node](const std::unique_ptr<FileNode>& child) { return child.get() == node; });
+    std::unique_ptr<FileNode> removed = std::move(*owner);
+    parent->children.erase(owner);
+    parent->publishChildren();
+    // A renderer may be drawing it right now
+    removed->isDetached = true;
+    Mir::Epoch::retire(std::move(removed));
+    // Only the check for deleted files, a removed tracked file marks the parent
+    annotateGitStatus(parent, parent->children.size(), 0);
+    m_prefetcher.clear();
+    return true;
+}
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Patching END
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Archives START
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+std::shared_ptr<TarArchive> FileTree::openArchive(const fs::path& _archivePath) {
+    auto it = m_archives.find(_archivePath.native());
+    if (it != m_archives.end()) {
+        return it->second;
+    }
+    // The user clicked it open, other scans on the same disk wait for the headers
+    Mir::IoScheduler::Foreground foreground(_archivePath);
+    auto archive = std::make_shared<TarArchive>();
+    if (!archive->open(_archivePath)) {
+        std::cout << "[FileTree::openArchive] " << archive->getError() << "\n";
+        return nullptr;
+    }
+    foreground.setOperations(archive->getEntryCount() + 1); // a header read per member
+    m_archives.emplace(_archivePath.native(), archive);
+    return archive;
+}
+
+std::shared_ptr<TarArchive> FileTree::findArchive(const fs::path& _path, std::string& _memberPath) const {
+    for (fs::path archivePath = _path; archivePath.has_relative_path(); archivePath = archivePath.parent_path()) {
+        auto it = m_archives.find(archivePath.native());
+        if (it == m_archives.end()) {
+            continue;
+        }
+        // Members are stored with forward slashes on every platform
+        _memberPath = Mir::Utils::File::toUtf8(_path.lexically_relative(archivePath));
+        std::replace(_memberPath.begin(), _memberPath.end(), '\\', '/');
+        if (_memberPath == ".") {
+            _memberPath.clear();
+        }
+        return it->second;
+    }
+    return nullptr;
+}
+
+bool FileTree::expandArchive(FileNode* node) {
+    MIR_PROFILE_SCOPE("FileTree::expandArchive");
+    if (!node->hasUnexpandedChildren) {
+        return false;
+    }
+    std::string memberPath;
+    std::shared_ptr<TarArchive> archive = node->isArchive ? openArchive(node->fullPath) : findArchive(node->fullPath, memberPath);
+    const TarArchive::Entry* folder = archive ? archive->find(memberPath) : nullptr;
+    retireChildren(node);
+    node->hasUnexpandedChildren = false;
+    if (!folder) {
+        return false;
+    }
+    markExpanded(node);
+
+    node->children.reserve(folder->children.size());
+    for (uint32_t index : folder->children) {
+        const TarArchive::Entry& entry = archive->getEntry(index);
+        std::string name = Mir::Utils::Text::isValidUtf8(entry.name) ? entry.name : Mir::Utils::Text::sanitizeUtf8(entry.name);
+        auto child = std::make_unique<FileNode>(std::move(name), entry.type);
+        child->fullPath = node->fullPath / fs::path(std::u8string(entry.name.begin(), entry.name.end()));
+        child->size = static_cast<size_t>(entry.size);
+        // Tar keeps Unix seconds, nodes file clock ticks like everything listed from disk
+        std::chrono::sys_seconds seconds{std::chrono::seconds(entry.modifiedTime)};
+#ifdef _MSC_VER
+        child->modifiedTime = std::chrono::clock_cast<std::chrono::file_clock>(seconds).time_since_epoch().count();
+#else
+        child->modifiedTime = std::chrono::file_clock::from_sys(seconds).time_since_epoch().count();
+#endif
+        child->isSymlink = entry.isSymlink;
+        child->isVirtual = true;
+        child->hasUnexpandedChildren = entry.type == FileType::DIR;
+        node->addChild(std::move(child));
+    }
+    sortChildren(node);
+    node->publishChildren();
+    addResident(node->children);
+    return true;
+}
+
+std::string_view FileTree::readArchiveMember(const fs::path& _path) {
+    std::lock_guard lock(m_writeMutex);
+    std::string memberPath;
+    std::shared_ptr<TarArchive> archive = findArchive(_path, memberPath);
+    const TarArchive::Entry* entry = archive ? archive->find(memberPath) : nullptr;
+    return entry ? archive->read(*entry) : std::string_view();
+}
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Archives END
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Memory budget START
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+void FileTree::markExpanded(FileNode* node) {
+    m_expandedDirs.insert(node);
+    node->lastShown.store(m_frame.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void FileTree::addResident(const std::vector<std::unique_ptr<FileNode>>& children) {
+    for (const auto& child : children) {
+        m_residentNodes++;
+        m_residentBytes += child->getMemoryFootprint();
+    }
+}
+
+void FileTree::removeResident(const FileNode* node) {
+    // Every node is counted once when it is added, going below zero means a batch was counted wrong
+    size_t bytes = node->getMemoryFootprint();
+    assert(m_residentNodes > 0 && m_residentBytes >= bytes);
+    m_residentNodes--;
+    m_residentBytes -= bytes;
+}
+
+void FileTree::resetResident() {
+    m_expandedDirs.clear();
+    m_residentNodes = 0;
+    m_residentBytes = 0;
+    // Trees set from outside (diff results) may be deep already. Their directories are not
+    // registered as expanded, so they are never evicted and keep their annotations
+    std::function<void(FileNode*)> count = [&](FileNode* node) {
+        addResident(node->children);
+        for (const auto& child : node->children) {
+            count(child.get());
+        }
+    };
+    if (m_rootNode) {
+        count(m_rootNode.get());
+    }
+}
+
+void FileTree::enforceMemoryBudget() {
+    MIR_PROFILE_SCOPE("FileTree::enforceMemoryBudget");
+    std::lock_guard lock(m_writeMutex);
+    uint64_t frame = m_frame.fetch_add(1, std::memory_order_relaxed);
+    if (m_memoryBudget == 0 || m_residentBytes <= m_memoryBudget) {
+        return;
+    }
+
+    // Anything touched this frame is on screen, everything else is collapsed or inside a collapsed parent
+    std::vector<std::pair<uint64_t, FileNode*>> candidates;
+    for (FileNode* node : m_expandedDirs) {
+        uint64_t lastUsed = node->lastShown.load(std::memory_order_relaxed);
+        if (lastUsed < frame && node != m_rootNode.get() && !node->isLoading) {
+            candidates.emplace_back(lastUsed, node);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    for (const auto& [lastUsed, node] : candidates) {
+        if (m_residentBytes <= m_memoryBudget) {
             break;
+        }
+        // An earlier eviction may already have freed this node together with its parent
+        if (m_expandedDirs.contains(node)) {
+            evict(node);
+        }
+    }
+}
+
+void FileTree::evict(FileNode* node) {
+    // A paused (capped) expansion starts over from the first page after a reload
+    if (auto expansion = m_expansions.find(node); expansion != m_expansions.end()) {
+        dropExpansion(expansion);
+    }
+    releaseChildren(node);
+    retireChildren(node);
+    node->hasUnexpandedChildren = true;
+    node->hasMoreEntries = false;
+    m_expandedDirs.erase(node);
+    m_evictedDirs++;
+}
 
+void FileTree::releaseChildren(FileNode* node) {
+    for (const auto& child : node->children) {
+        removeResident(child.get());
+        child->isDetached = true;
+        if (child->type != FileType::DIR) {
+            continue;
+        }
+        if (child.get() == m_currentNode) {
+            m_currentNode = node;
+        }
+        auto expansion = m_expansions.find(child.get());
+        if (expansion != m_expansions.end()) {
+            dropExpansion(expansion);
+        }
+        m_expandedDirs.erase(child.get());
+        releaseChildren(child.get());
+    }
+}
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Memory budget END
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Snapshots START
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+void FileTree::publishRoot(std::unique_ptr<FileNode> _root) {
+    publishAll(_root.get());
+    std::unique_ptr<FileNode> previous = std::move(m_rootNode);
+    m_rootNode = std::move(_root);
+    m_currentNode = m_rootNode.get();
+    m_publishedRoot.store(m_rootNode.get(), std::memory_order_release);
+    if (previous) {
+        detach(previous.get());
+        Mir::Epoch::retire(std::move(previous));
+    }
+}
+
+void FileTree::publishAll(FileNode* node) {
+    // Trees built elsewhere (diff results) come in unpublished at any depth
+    node->publishChildren();
+    for (const auto& child : node->children) {
+        if (!child->children.empty()) {
+            publishAll(child.get());
+        }
     }
 }
 
+void FileTree::retireChildren(FileNode* node) {
+    // The published list always matches children, nothing to do for an empty one
+    if (node->children.empty()) {
+        return;
+    }
+    std::vector<std::unique_ptr<FileNode>> children = std::move(node->children);
+    node->children.clear();
+    node->publishChildren();
+    if (!children.empty()) {
+        Mir::Epoch::retire(std::move(children));
+    }
+}
+
+void FileTree::detach(FileNode* node) {
+    node->isDetached = true;
+    for (const auto& child : node->children) {
+        detach(child.get());
+    }
+}
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Snapshots END
+//--------------------------------------------------------------------------------------------------------------------------------------------------
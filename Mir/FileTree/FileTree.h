@@ -4,8 +4,20 @@
 #include <filesystem>
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <limits>
 
 #include "FileNode.h"
+#include "DirectoryPrefetcher.h"
+#include "DirectoryWalker.h"
+#include "FileSystemProvider.h"
+#include "GitStatusOverlay.h"
+#include "IgnoringFileSystem.h"
+#include "TarArchive.h"
+#include "utils/IoScheduler.h"
 
 namespace fs = std::filesystem;
 
@@ -22,29 +34,190 @@ class FileTree
 private:
     std::unique_ptr<FileNode> m_rootNode;
     FileNode* m_currentNode = nullptr; 
+    std::shared_ptr<FileSystemProvider> m_provider = FileSystemProvider::native();
+    std::shared_ptr<IgnoringFileSystem> m_ignoring; // wraps the provider while ignore rules are on
+    std::unique_ptr<GitStatusOverlay> m_gitStatus;  // while git markers are on
 
     int m_maxDepth = -1;
     SortCriteria m_sortCriteria = SortCriteria::TypeThenName;
     std::unique_ptr<FileNode> buildFileTree(const fs::path& folder);
-    void printFileTree(FileNode* _node, int depth = 0);
+    // Lists folder through provider with size and time, no bookkeeping, any thread
+    static void listDirectory(const fs::path& folder, FileSystemProvider& provider, std::vector<std::unique_ptr<FileNode>>& children);
+    static std::string makeNodeName(const fs::path& filename);
     void sortChildren(FileNode* node);
+    static bool lessThan(SortCriteria criteria, const std::unique_ptr<FileNode>& a, const std::unique_ptr<FileNode>& b);
+
+    // Streaming expansion: a worker reads the directory in batches, the UI thread merges
+    // them into the node in pumpExpansions so nodes are only ever mutated on one thread
+    struct ExpansionJob {
+        fs::path path;
+        std::shared_ptr<FileSystemProvider> provider;
+        std::unique_ptr<FileSystemProvider::DirectoryReader> reader; // worker only
+        bool started = false;                       // worker only
+        size_t delivered = 0;                       // worker only
+        Mir::IoScheduler::DeviceId device = 0;
+        std::atomic<size_t> scanned{0};
+        std::atomic<bool> cancelled{false};
+        std::atomic<Mir::IoPriority> priority{Mir::IoPriority::Visible}; // updated every frame by pumpExpansions
+        std::mutex mutex;                           // guards everything below
+        std::vector<std::unique_ptr<FileNode>> pending;
+        size_t limit = 0;                           // 0 = no cap
+        bool paused = false;
+        bool finished = false;
+    };
+    static constexpr size_t kFirstBatchSize = 256;
+    static constexpr size_t kBatchSize = 4096;
+
+    bool m_streamingExpansion = true;
+    size_t m_expansionLimit = 0;
+    using ExpansionMap = std::unordered_map<FileNode*, std::shared_ptr<ExpansionJob>>;
+    ExpansionMap m_expansions;
+    DirectoryPrefetcher m_prefetcher;
+    static constexpr size_t kPrefetchChildDirs = 4;
+
+    bool takePrefetched(FileNode* node);
+    void prefetchChildDirs(FileNode* node);
+
+    // Memory budget: expanded directories are stamped with the frame they were last shown in
+    // (FileNode::lastShown), the least recently shown ones lose their children first when over budget.
+    // The counters are written under m_writeMutex and read by the status bar without it.
+    size_t m_memoryBudget = 512 * 1024 * 1024; // 0 = unlimited
+    std::atomic<size_t> m_residentNodes{0};
+    std::atomic<size_t> m_residentBytes{0};
+    std::atomic<size_t> m_evictedDirs{0};
+    std::atomic<uint64_t> m_frame{1};
+    std::unordered_set<FileNode*> m_expandedDirs;
+
+    // Opened archives by path, indexed once and kept until the root changes
+    std::unordered_map<fs::path::string_type, std::shared_ptr<TarArchive>> m_archives;
+    bool expandArchive(FileNode* node);
+    std::shared_ptr<TarArchive> openArchive(const fs::path& archivePath);
+    // Opened archive that path is in, memberPath is set relative to it
+    std::shared_ptr<TarArchive> findArchive(const fs::path& path, std::string& memberPath) const;
+
+    void markExpanded(FileNode* node);
+    void addResident(const std::vector<std::unique_ptr<FileNode>>& children);
+    void removeResident(const FileNode* node);
+    void evict(FileNode* node);
+    void releaseChildren(FileNode* node);
+    void resetResident();
+
+    // Git markers for children[first, first + count) of a node that was just listed
+    void annotateGitStatus(FileNode* node, size_t first = 0, size_t count = std::numeric_limits<size_t>::max());
+    void annotateLoaded(FileNode* node);
+    void openGitStatus();
+
+    // Entries read this turn, for the scheduler
+    static size_t runExpansionJob(const std::shared_ptr<ExpansionJob>& job);
+    void submitExpansionJob(const std::shared_ptr<ExpansionJob>& job);
+    void cancelExpansions();
+    // Cancels the job and retires it, readers may still be reading its counter
+    ExpansionMap::iterator dropExpansion(ExpansionMap::iterator it);
+
+    // Snapshots: every public call that changes nodes or the bookkeeping above holds
+    // m_writeMutex and republishes what it changed (FileNode::publishChildren). Unlinked nodes
+    // are marked detached and retired through Mir::Epoch instead of deleted, so readers walking
+    // getRootNode()/readChildren() inside a Mir::Epoch::ReadGuard never need the lock.
+    mutable std::recursive_mutex m_writeMutex;
+    std::atomic<FileNode*> m_publishedRoot{nullptr};
+    void publishRoot(std::unique_ptr<FileNode> root);
+    static void publishAll(FileNode* node);
+    // Moves node's children out of reach of new readers and retires them, call releaseChildren first
+    void retireChildren(FileNode* node);
+    static void detach(FileNode* node);
 public:
     FileTree();
     explicit FileTree(const fs::path& folder);
+    FileTree(const fs::path& folder, std::shared_ptr<FileSystemProvider> provider);
     ~FileTree();
+
+    // nullptr for anything that is not a file or directory. Without metadata, file size and time
+    // are left for loadMetadata, except on Windows where the listing already has them.
+    static std::unique_ptr<FileNode> makeNode(const fs::directory_entry& entry, bool withMetadata = true);
+    static std::unique_ptr<FileNode> makeNode(FileSystemProvider::Entry&& entry);
+    // Size and time for the files in nodes[first..] in one BatchIo round, one stat per file otherwise
+    static void loadMetadata(std::vector<std::unique_ptr<FileNode>>& nodes, size_t first = 0);
+    // Lists a directory into node without any bookkeeping, safe on worker threads as long as
+    // nobody else touches node. Hand the node to adoptLoadedChildren afterwards, which publishes it.
+    static bool loadChildren(FileNode* node, FileSystemProvider& provider);
+    void adoptLoadedChildren(FileNode* node);
     
     void setRootFolder(const fs::path& _folder);
+    // Shows a tree built elsewhere, e.g. a TreeDiff result
+    void setRootNode(std::unique_ptr<FileNode> root);
     void setSortCriteria(SortCriteria criteria);
+    // Lists and reads through provider from now on, starting over at rootFolder
+    void setProvider(std::shared_ptr<FileSystemProvider> provider, const fs::path& rootFolder);
+    FileSystemProvider& getProvider() const { return *m_provider; }
+    // Hides entries matched by .gitignore files and options.patterns while listing, ignored
+    // folders are never opened. Starts over at the current root.
+    void setIgnoreRules(bool enabled, IgnoringFileSystem::Options options = {});
+    bool isIgnoringRules() const { return m_ignoring != nullptr; }
+    IgnoringFileSystem::Stats getIgnoreStats() const { return m_ignoring ? m_ignoring->getStats() : IgnoringFileSystem::Stats(); }
+    // Marks nodes with their git status (GitStatusOverlay) as folders are listed, on disk trees
+    // inside a repository only. Stays on across root changes, false if the root is not in one.
+    bool setGitStatus(bool enabled, GitStatusOverlay::Options options = {});
+    bool isShowingGitStatus() const { return m_gitStatus != nullptr; }
+    // nullptr while git markers are off
+    const GitStatusOverlay* getGitStatus() const { return m_gitStatus.get(); }
     
     void print();
     void refreshRootNode();
+    // Lists without holding the tree's lock, only the result is spliced in under it
     bool expandNode(FileNode* node);
+    // Starts a background expansion when streaming is enabled, otherwise same as expandNode
+    bool expandNodeAsync(FileNode* node);
+    // UI thread, once per frame: merges finished batches into their nodes
+    void pumpExpansions();
+    // Continues a capped expansion for another page of entries
+    bool loadMore(FileNode* node);
+    // Entries found so far while node is loading, any thread inside a Mir::Epoch::ReadGuard
+    size_t getScannedCount(const FileNode* node) const;
+    // Hint that node is likely to be expanded soon (hovered, just opened)
+    void prefetch(FileNode* node);
+    DirectoryPrefetcher& getPrefetcher() { return m_prefetcher; }
+    // Contents of a node with isVirtual set, valid until the root changes. Empty if unknown.
+    std::string_view readArchiveMember(const fs::path& path);
+
+    // Renderer: node is open and visible this frame. Only a stamp on the node, no lock.
+    void touch(FileNode* node) { if (node) node->lastShown.store(m_frame.load(std::memory_order_relaxed), std::memory_order_relaxed); }
+    // Renderer, end of frame: collapses directories that were not touched until under budget
+    void enforceMemoryBudget();
+    void setMemoryBudget(size_t bytes) { m_memoryBudget = bytes; }
+    size_t getMemoryBudget() const { return m_memoryBudget; }
+    size_t getResidentNodeCount() const { return m_residentNodes.load(std::memory_order_relaxed); }
+    size_t getResidentBytes() const { return m_residentBytes.load(std::memory_order_relaxed); }
+    size_t getEvictedCount() const { return m_evictedDirs.load(std::memory_order_relaxed); }
+
+    void setStreamingExpansion(bool enabled) { m_streamingExpansion = enabled; }
+    bool isStreamingExpansion() const { return m_streamingExpansion; }
+    // Entries shown per page of a streamed directory, 0 = load everything
+    void setExpansionLimit(size_t limit) { m_expansionLimit = limit; }
+    size_t getExpansionLimit() const { return m_expansionLimit; }
+    
+    // Patching after file operations, so open folders keep their state instead of a full refresh.
+    // Paths outside the tree or under folders that are not loaded are ignored (false).
+    FileNode* findNode(const fs::path& path) const;
+    bool insertPath(const fs::path& path);
+    bool removePath(const fs::path& path);
     
     fs::path getCurrentPath() const;
     std::vector<FileNode*> getCurrentChildren() const;
     SortCriteria getSortCriteria() const { return m_sortCriteria; }
-    fs::path getRootFolder() { return m_rootNode.get()->fullPath; }
-    FileNode* getRootNode() const { return m_rootNode.get(); }
+    // Empty until a root is set
+    fs::path getRootFolder() const;
+    // Safe from any thread, read below it with readChildren() inside a Mir::Epoch::ReadGuard.
+    // node->children and FileNodeVisitor walks are for the thread that holds lockForWrite().
+    FileNode* getRootNode() const { return m_publishedRoot.load(std::memory_order_acquire); }
+    // For code that changes nodes itself or walks node->children while other threads write
+    std::unique_lock<std::recursive_mutex> lockForWrite() const { return std::unique_lock(m_writeMutex); }
     
-    bool isInitialized() const {return m_rootNode != nullptr;}
+    bool isInitialized() const {return getRootNode() != nullptr;}
+
+    // Depth limit for walk(), -1 = unlimited
+    void setMaxDepth(int depth) { m_maxDepth = depth; }
+    int getMaxDepth() const { return m_maxDepth; }
+    // Lazy walk of the root folder on disk, loaded nodes are not touched. options.maxDepth
+    // overrides the tree's max depth when set.
+    Mir::Generator<const WalkEntry&> walk(WalkOptions options = {}) const;
 };
\ No newline at end of file
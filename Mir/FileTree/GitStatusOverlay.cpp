@@ -0,0 +1,530 @@
+#include "GitStatusOverlay.h"
+#include "FileTree.h"
+#include "utils/MappedFile.h"
+#include "utils/Profiler.h"
+#include "utils/Redraw.h"
+#include "utils/Utils.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+    constexpr uint32_t kTypeMask = 0170000;
+    constexpr uint32_t kSymlink = 0120000;
+    constexpr uint32_t kGitlink = 0160000;  // submodule
+
+    uint32_t readBigEndian32(const unsigned char* data) {
+        return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) | uint32_t(data[3]);
+    }
+
+    uint16_t readBigEndian16(const unsigned char* data) {
+        return static_cast<uint16_t>((data[0] << 8) | data[1]);
+    }
+
+    // The index keeps 32 bit seconds, compared the same way git does
+    uint32_t toIndexSeconds(std::filesystem::file_time_type time) {
+#ifdef _MSC_VER
+        auto system = std::chrono::clock_cast<std::chrono::system_clock>(time);
+#else
+        auto system = std::chrono::file_clock::to_sys(time);
+#endif
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(system.time_since_epoch()).count());
+    }
+
+    // Small text files under .git, "" when missing
+    std::string readSmallFile(const std::filesystem::path& path) {
+        std::error_code ec;
+        if (!std::filesystem::is_regular_file(path, ec)) {
+            return {};
+        }
+        return Mir::Utils::File::readFile(path);
+    }
+
+    std::string_view trimmed(std::string_view text) {
+        while (!text.empty() && (text.back() == '\n' || text.back() == '\r' || text.back() == ' ')) {
+            text.remove_suffix(1);
+        }
+        return text;
+    }
+}
+
+GitStatusOverlay::GitStatusOverlay() : GitStatusOverlay(Options{}) {}
+
+GitStatusOverlay::GitStatusOverlay(Options options) : m_options(options) {}
+
+GitStatusOverlay::~GitStatusOverlay() {
+    close();
+    m_pool.reset();
+}
+
+bool GitStatusOverlay::open(const std::filesystem::path& _root) {
+    MIR_PROFILE_SCOPE("GitStatusOverlay::open");
+    auto start = std::chrono::steady_clock::now();
+    close();
+    if (!findRepository(_root)) {
+        return false;
+    }
+    std::filesystem::path index = m_gitDirectory / "index";
+    std::error_code ec;
+    auto indexTime = std::filesystem::last_write_time(index, ec);
+    if (ec) {
+        // A fresh repository has no index until the first add, everything is untracked
+        m_indexSeconds = 0;
+    } else {
+        m_indexSeconds = toIndexSeconds(indexTime);
+        if (!readIndex(index)) {
+            m_entries.clear();
+            m_paths.clear();
+            return false;
+        }
+    }
+
+    // Untracked entries are checked against the same rules a listing with ignore rules uses
+    m_ignore = std::make_unique<IgnoringFileSystem>(FileSystemProvider::native(), IgnoringFileSystem::Options{});
+    m_ignore->setRoot(m_top);
+
+    if (!m_pool) {
+        m_pool = std::make_unique<Mir::ThreadPool>(m_options.threadCount);
+    }
+    m_stats.indexEntries = m_entries.size();
+    m_stats.indexLoadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    m_isOpen = true;
+    return true;
+}
+
+void GitStatusOverlay::close() {
+    m_generation.fetch_add(1, std::memory_order_relaxed);
+    m_isOpen = false;
+    m_error.clear();
+    m_entries.clear();
+    m_paths.clear();
+    m_ignore.reset();
+    m_stats = Stats();
+    m_hashed = 0;
+    m_hashedBytes = 0;
+    std::lock_guard lock(m_resultMutex);
+    m_results.clear();
+}
+
+GitStatusOverlay::Stats GitStatusOverlay::getStats() const {
+    Stats stats = m_stats;
+    stats.hashed = m_hashed.load(std::memory_order_relaxed);
+    stats.hashedBytes = m_hashedBytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Index START
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+bool GitStatusOverlay::findRepository(const std::filesystem::path& _root) {
+    std::error_code ec;
+    std::filesystem::path root = std::filesystem::absolute(_root, ec).lexically_normal();
+    for (std::filesystem::path folder = root;; folder = folder.parent_path()) {
+        std::filesystem::path dotGit = folder / ".git";
+        if (std::filesystem::is_directory(dotGit, ec)) {
+            m_top = folder;
+            m_gitDirectory = dotGit;
+            break;
+        }
+        // Worktrees and submodules have a "gitdir: <path>" file instead
+        std::string link = readSmallFile(dotGit);
+        if (link.starts_with("gitdir:")) {
+            std::string_view target = trimmed(std::string_view(link).substr(7));
+            while (!target.empty() && target.front() == ' ') {
+                target.remove_prefix(1);
+            }
+            m_top = folder;
+            m_gitDirectory = (folder / std::filesystem::path(std::u8string(target.begin(), target.end()))).lexically_normal();
+            break;
+        }
+        if (!folder.has_relative_path()) {
+            m_error = "Not inside a git repository";
+            return false;
+        }
+    }
+
+    // Worktrees share the config of the main repository
+    std::filesystem::path common = m_gitDirectory;
+    std::string commonLink = readSmallFile(m_gitDirectory / "commondir");
+    if (!commonLink.empty()) {
+        std::string_view target = trimmed(commonLink);
+        common = (m_gitDirectory / std::filesystem::path(std::u8string(target.begin(), target.end()))).lexically_normal();
+    }
+    std::string config = Mir::Utils::Text::toLowerCase(readSmallFile(common / "config"));
+    size_t format = config.find("objectformat");
+    if (format != std::string::npos && config.substr(format, config.find('\n', format) - format).find("sha256") != std::string::npos) {
+        m_error = "SHA-256 repositories are not supported";
+        return false;
+    }
+    return true;
+}
+
+bool GitStatusOverlay::readIndex(const std::filesystem::path& _file) {
+    MIR_PROFILE_SCOPE("GitStatusOverlay::readIndex");
+    Mir::Utils::File::MappedFile file;
+    if (!file.open(_file)) {
+        m_error = "Can't read " + Mir::Utils::File::toUtf8(_file);
+        return false;
+    }
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(file.data());
+    // Header, entries, extensions, then a SHA-1 of everything before it (not verified)
+    if (file.size() < 12 + 20 || std::memcmp(data, "DIRC", 4) != 0) {
+        m_error = "Not a git index: " + Mir::Utils::File::toUtf8(_file);
+        return false;
+    }
+    uint32_t version = readBigEndian32(data + 4);
+    if (version < 2 || version > 4) {
+        m_error = "Unsupported index version " + std::to_string(version);
+        return false;
+    }
+    uint32_t count = readBigEndian32(data + 8);
+    size_t end = file.size() - 20;
+    size_t offset = 12;
+    m_entries.reserve(count);
+    m_paths.reserve(file.size());
+
+    constexpr size_t kStatSize = 62; // times, dev, ino, mode, uid, gid, size, id, flags
+    std::string previous;            // version 4 paths are stored as a change of the previous one
+    for (uint32_t i = 0; i < count; i++) {
+        if (offset + kStatSize > end) {
+            m_error = "Truncated git index";
+            return false;
+        }
+        const unsigned char* entryData = data + offset;
+        IndexEntry entry;
+        entry.mtimeSeconds = readBigEndian32(entryData + 8);
+        entry.mode = readBigEndian32(entryData + 24);
+        entry.size = readBigEndian32(entryData + 36);
+        std::memcpy(entry.id.data(), entryData + 40, entry.id.size());
+        uint16_t flags = readBigEndian16(entryData + 60);
+        entry.stage = static_cast<uint8_t>((flags >> 12) & 3);
+        size_t pathStart = offset + kStatSize;
+        if (flags & 0x4000) {
+            if (version < 3 || pathStart + 2 > end) {
+                m_error = "Corrupt git index entry";
+                return false;
+            }
+            entry.skipWorktree = (readBigEndian16(data + pathStart) & 0x4000) != 0;
+            pathStart += 2;
+        }
+
+        std::string_view path;
+        if (version == 4) {
+            // Bytes to drop from the end of the previous path, then the new suffix
+            size_t position = pathStart;
+            if (position >= end) {
+                m_error = "Truncated git index";
+                return false;
+            }
+            uint64_t strip = data[position] & 127;
+            while (data[position++] & 128) {
+                if (position >= end) {
+                    m_error = "Truncated git index";
+                    return false;
+                }
+                strip = ((strip + 1) << 7) | (data[position] & 127);
+            }
+            const void* terminator = std::memchr(data + position, 0, end - position);
+            if (!terminator || strip > previous.size()) {
+                m_error = "Corrupt git index entry";
+                return false;
+            }
+            size_t suffixLength = static_cast<const unsigned char*>(terminator) - (data + position);
+            previous.resize(previous.size() - strip);
+            previous.append(reinterpret_cast<const char*>(data + position), suffixLength);
+            path = previous;
+            offset = position + suffixLength + 1;
+        } else {
+            const void* terminator = std::memchr(data + pathStart, 0, end - pathStart);
+            if (!terminator) {
+                m_error = "Corrupt git index entry";
+                return false;
+            }
+            size_t pathLength = static_cast<const unsigned char*>(terminator) - (data + pathStart);
+            path = std::string_view(reinterpret_cast<const char*>(data + pathStart), pathLength);
+            // NUL padded to a multiple of 8 bytes, at least one NUL
+            offset += ((pathStart - offset) + pathLength + 8) & ~size_t(7);
+        }
+        entry.pathOffset = static_cast<uint32_t>(m_paths.size());
+        entry.pathLength = static_cast<uint32_t>(path.size());
+        m_paths.append(path);
+        m_entries.push_back(entry);
+    }
+
+    for (; offset + 8 <= end; offset += 8 + readBigEndian32(data + offset + 4)) {
+        if (std::memcmp(data + offset, "link", 4) == 0) {
+            m_error = "Split index is not supported";
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t GitStatusOverlay::lowerBound(std::string_view _path) const {
+    auto it = std::lower_bound(m_entries.begin(), m_entries.end(), _path,
+        [this](const IndexEntry& entry, std::string_view path) { return pathOf(entry) < path; });
+    return static_cast<size_t>(it - m_entries.begin());
+}
+
+bool GitStatusOverlay::hasEntriesBelow(std::string_view _folder) const {
+    std::string prefix(_folder);
+    prefix += '/';
+    size_t index = lowerBound(prefix);
+    return index < m_entries.size() && pathOf(m_entries[index]).starts_with(prefix);
+}
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Index END
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Markers START
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+void GitStatusOverlay::annotate(FileTree& tree, FileNode* _directory, size_t _first, size_t _count) {
+    if (!_directory) {
+        return;
+    }
+    const std::unique_ptr<FileNode>* children = _directory->children.data();
+    size_t first = std::min(_first, _directory->children.size());
+    size_t last = first + std::min(_count, _directory->children.size() - first);
+    annotateEntries(tree, _directory, children + first, children + last, !_directory->isLoading && !_directory->hasMoreEntries);
+}
+
+void GitStatusOverlay::annotate(FileTree& tree, FileNode* _directory, const std::vector<std::unique_ptr<FileNode>>& _batch) {
+    annotateEntries(tree, _directory, _batch.data(), _batch.data() + _batch.size(), false);
+}
+
+void GitStatusOverlay::annotateEntries(FileTree& tree, FileNode* _directory, const std::unique_ptr<FileNode>* _first,
+    const std::unique_ptr<FileNode>* _last, bool _checkDeleted) {
+    MIR_PROFILE_SCOPE("GitStatusOverlay::annotate");
+    std::string folder;
+    if (!m_isOpen || !_directory || _directory->isVirtual || !IgnoringFileSystem::relativeTo(m_top, _directory->fullPath, folder)) {
+        return;
+    }
+    // Everything below an untracked or ignored folder is the same, only the rules are checked
+    GitStatus parent = _directory->gitStatus;
+    GitStatus inherited = parent == GitStatus::Untracked || parent == GitStatus::Ignored ? parent : GitStatus::None;
+
+    std::vector<HashRequest> hashes;
+    bool changed = false;
+    std::string path = folder;
+    for (const std::unique_ptr<FileNode>* entry = _first; entry != _last; ++entry) {
+        FileNode& child = **entry;
+        path.resize(folder.size());
+        if (!folder.empty()) {
+            path += '/';
+        }
+        path += Mir::Utils::File::toUtf8(child.fullPath.filename());
+        child.gitStatus = classify(child, path, inherited, hashes);
+        changed |= isChange(child.gitStatus);
+    }
+    if (inherited == GitStatus::None && _checkDeleted) {
+        changed |= countDeleted(*_directory, folder) > 0;
+    }
+    submitHashes(hashes);
+    if (changed && inherited == GitStatus::None) {
+        markChanged(tree, _directory);
+    }
+}
+
+GitStatus GitStatusOverlay::classify(FileNode& _node, std::string_view _path, GitStatus _inherited, std::vector<HashRequest>& _hashes) {
+    if (_inherited == GitStatus::Ignored) {
+        m_stats.ignored++;
+        return GitStatus::Ignored;
+    }
+    if (_inherited == GitStatus::Untracked) {
+        return untrackedStatus(_node);
+    }
+    size_t index = lowerBound(_path);
+    bool listed = index < m_entries.size() && pathOf(m_entries[index]) == _path;
+
+    if (_node.type == FileType::DIR) {
+        if (listed && (m_entries[index].mode & kTypeMask) == kGitlink) {
+            return GitStatus::Clean; // submodules have their own index
+        }
+        // Tracked folders get their marker from their children once expanded
+        return hasEntriesBelow(_path) ? GitStatus::None : untrackedStatus(_node);
+    }
+    if (!listed) {
+        return untrackedStatus(_node);
+    }
+    const IndexEntry& entry = m_entries[index];
+    if (entry.stage != 0) {
+        m_stats.conflicted++;
+        return GitStatus::Conflicted;
+    }
+    if (entry.skipWorktree) {
+        return GitStatus::Clean;
+    }
+    uint32_t type = entry.mode & kTypeMask;
+    if (type == kGitlink || _node.isSymlink != (type == kSymlink)) {
+        m_stats.modified++;
+        return GitStatus::Modified;
+    }
+    if (_node.isSymlink) {
+        return GitStatus::Clean; // listings keep the target's stat data, not the link's
+    }
+
+    // Same checks as git: a different size is a change, the same size and second is clean
+    // unless the file could have changed after the index was written in that second
+    bool hasMetadata = _node.modifiedTime != 0;
+    uint32_t size = static_cast<uint32_t>(_node.size);
+    if (hasMetadata && entry.size != 0 && size != entry.size) {
+        m_stats.modified++;
+        return GitStatus::Modified;
+    }
+    bool racy = entry.mtimeSeconds >= m_indexSeconds;
+    if (hasMetadata && size == entry.size && !racy &&
+        toIndexSeconds(std::filesystem::file_time_type(std::filesystem::file_time_type::duration(_node.modifiedTime))) == entry.mtimeSeconds) {
+        m_stats.statMatched++;
+        return GitStatus::Clean;
+    }
+    _hashes.push_back({_node.fullPath, entry.id});
+    return GitStatus::Checking;
+}
+
+GitStatus GitStatusOverlay::untrackedStatus(const FileNode& _node) {
+    if (m_ignore && m_ignore->isIgnored(_node.fullPath, _node.type == FileType::DIR)) {
+        m_stats.ignored++;
+        return GitStatus::Ignored;
+    }
+    m_stats.untracked++;
+    return GitStatus::Untracked;
+}
+
+size_t GitStatusOverlay::countDeleted(const FileNode& _directory, std::string_view _folder) {
+    std::vector<std::string> names;
+    names.reserve(_directory.children.size());
+    for (const auto& child : _directory.children) {
+        names.push_back(Mir::Utils::File::toUtf8(child->fullPath.filename()));
+    }
+    std::sort(names.begin(), names.end());
+
+    std::string prefix(_folder);
+    if (!prefix.empty()) {
+        prefix += '/';
+    }
+    size_t deleted = 0;
+    for (size_t index = lowerBound(prefix); index < m_entries.size();) {
+        std::string_view path = pathOf(m_entries[index]);
+        if (!path.starts_with(prefix)) {
+            break;
+        }
+        std::string_view rest = path.substr(prefix.size());
+        size_t slash = rest.find('/');
+        std::string_view name = rest.substr(0, slash);
+        if (!m_entries[index].skipWorktree && !std::binary_search(names.begin(), names.end(), name)) {
+            deleted++;
+        }
+        if (slash == std::string_view::npos) {
+            // Other stages of the same path
+            while (++index < m_entries.size() && pathOf(m_entries[index]) == path) {}
+        } else {
+            // Everything below a subfolder sorts right after it, '0' follows '/'
+            index = lowerBound(prefix + std::string(name) + '0');
+        }
+    }
+    m_stats.deleted += deleted;
+    return deleted;
+}
+
+bool GitStatusOverlay::pump(FileTree& tree) {
+    MIR_PROFILE_SCOPE("GitStatusOverlay::pump");
+    std::vector<HashResult> results;
+    {
+        std::lock_guard lock(m_resultMutex);
+        results.swap(m_results);
+    }
+    uint64_t generation = m_generation.load(std::memory_order_relaxed);
+    bool changed = false;
+    for (const HashResult& result : results) {
+        // Nodes may have been evicted or replaced in the meantime, a relisted one hashes again
+        FileNode* node = result.generation == generation ? tree.findNode(result.path) : nullptr;
+        if (!node || node->gitStatus != GitStatus::Checking) {
+            continue;
+        }
+        changed = true;
+        if (!result.modified) {
+            node->gitStatus = GitStatus::Clean;
+            continue;
+        }
+        node->gitStatus = GitStatus::Modified;
+        m_stats.modified++;
+        if (FileNode* parent = tree.findNode(result.path.parent_path())) {
+            markChanged(tree, parent);
+        }
+    }
+    return changed;
+}
+
+void GitStatusOverlay::markChanged(FileTree& tree, FileNode* _directory) {
+    // Bottom up, a folder that is marked already has its parents marked as well
+    FileNode* node = _directory;
+    std::filesystem::path folder = _directory->fullPath;
+    while (node && node->gitStatus != GitStatus::ChildrenChanged && node->gitStatus != GitStatus::Untracked && node->gitStatus != GitStatus::Ignored) {
+        node->gitStatus = GitStatus::ChildrenChanged;
+        if (node == tree.getRootNode() || !folder.has_relative_path()) {
+            break;
+        }
+        folder = folder.parent_path();
+        node = tree.findNode(folder);
+    }
+}
+
+bool GitStatusOverlay::isChange(GitStatus status) {
+    return status == GitStatus::Modified || status == GitStatus::Untracked || status == GitStatus::Conflicted;
+}
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Markers END
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Hashing START
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+void GitStatusOverlay::submitHashes(std::vector<HashRequest>& _hashes) {
+    if (_hashes.empty() || !m_pool) {
+        return;
+    }
+    uint64_t generation = m_generation.load(std::memory_order_relaxed);
+    size_t perTask = std::max<size_t>(m_options.filesPerTask, 1);
+    for (size_t first = 0; first < _hashes.size(); first += perTask) {
+        size_t last = std::min(first + perTask, _hashes.size());
+        std::vector<HashRequest> task(std::make_move_iterator(_hashes.begin() + first), std::make_move_iterator(_hashes.begin() + last));
+        m_pool->submit([this, task = std::move(task), generation]() { hashFiles(task, generation); });
+    }
+    _hashes.clear();
+}
+
+void GitStatusOverlay::hashFiles(const std::vector<HashRequest>& _hashes, uint64_t _generation) {
+    MIR_PROFILE_SCOPE("GitStatusOverlay::hashFiles");
+    std::vector<HashResult> results;
+    results.reserve(_hashes.size());
+    Mir::Utils::Sha1 sha;
+    for (const HashRequest& request : _hashes) {
+        if (m_generation.load(std::memory_order_relaxed) != _generation) {
+            return;
+        }
+        // Object id of a blob: SHA-1 of "blob <size>\0" and the content
+        Mir::Utils::File::MappedFile file;
+        bool modified = true;
+        if (file.open(request.path)) {
+            std::string header = "blob " + std::to_string(file.size());
+            sha.reset();
+            sha.update(header.c_str(), header.size() + 1);
+            sha.update(file.view());
+            modified = sha.finish() != request.id;
+            m_hashed.fetch_add(1, std::memory_order_relaxed);
+            m_hashedBytes.fetch_add(file.size(), std::memory_order_relaxed);
+        }
+        results.push_back({request.path, modified, _generation});
+    }
+    {
+        std::lock_guard lock(m_resultMutex);
+        for (HashResult& result : results) {
+            m_results.push_back(std::move(result));
+        }
+    }
+    Mir::Redraw::request();
+}
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Hashing END
+//--------------------------------------------------------------------------------------------------------------------------------------------------
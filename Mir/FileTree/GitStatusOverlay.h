@@ -0,0 +1,137 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "FileNode.h"
+#include "IgnoringFileSystem.h"
+#include "utils/Sha1.h"
+#include "utils/ThreadPool.h"
+
+class FileTree;
+
+// Git status markers for the nodes of a FileTree without running git. open() maps .git/index and
+// keeps its entries sorted by path, every listed file is then checked against the size and time
+// the index recorded for it. Only files whose stat data differs, or that were written in the same
+// second as the index ("racily clean"), are read and hashed, on a worker pool. Folders are
+// marked as they are expanded, a change marks every loaded folder above it.
+//
+//   GitStatusOverlay overlay;
+//   if (overlay.open(root)) {
+//       overlay.annotate(tree, node);   // after node's children were listed
+//       overlay.pump(tree);             // once per frame, hands hash results to the nodes
+//   }
+//
+// Like the second column of `git status --short` the working tree is compared against the index,
+// staged changes show as clean. Content filters (autocrlf, LFS) are not applied. SHA-1
+// repositories and index versions 2 to 4, a split index is refused.
+class GitStatusOverlay
+{
+public:
+    struct Options {
+        size_t threadCount = 0;     // hashing threads, 0 = hardware concurrency
+        size_t filesPerTask = 32;
+    };
+
+    struct Stats {
+        size_t indexEntries = 0;
+        double indexLoadMs = 0;
+        size_t statMatched = 0;     // clean without reading the file
+        size_t hashed = 0;
+        uint64_t hashedBytes = 0;
+        size_t modified = 0;
+        size_t untracked = 0;
+        size_t ignored = 0;
+        size_t conflicted = 0;
+        size_t deleted = 0;         // in the index, missing from a fully listed folder
+    };
+
+    GitStatusOverlay();
+    explicit GitStatusOverlay(Options options);
+    ~GitStatusOverlay();
+
+    GitStatusOverlay(const GitStatusOverlay&) = delete;
+    GitStatusOverlay& operator=(const GitStatusOverlay&) = delete;
+
+    // Reads the index of the repository root is in, false when there is none or it can't be
+    // read (see getError). Hashes still running for the previous one are dropped.
+    bool open(const std::filesystem::path& root);
+    void close();
+    bool isOpen() const { return m_isOpen; }
+    // Working tree root, the folder that holds .git
+    const std::filesystem::path& getTop() const { return m_top; }
+    const std::string& getError() const { return m_error; }
+
+    // UI thread: markers for directory->children[first, first + count), just listed. Once the
+    // listing is complete the index entries missing from it mark the folder changed.
+    void annotate(FileTree& tree, FileNode* directory, size_t first = 0, size_t count = std::numeric_limits<size_t>::max());
+    // Same for a streamed batch before it is merged into directory, so markers show while a big
+    // folder is still loading
+    void annotate(FileTree& tree, FileNode* directory, const std::vector<std::unique_ptr<FileNode>>& batch);
+    // UI thread, once per frame: hands finished hashes to their nodes, true if a marker changed
+    bool pump(FileTree& tree);
+    Stats getStats() const;
+
+private:
+    struct IndexEntry {
+        uint32_t pathOffset = 0;    // into m_paths
+        uint32_t pathLength = 0;
+        uint32_t mtimeSeconds = 0;
+        uint32_t size = 0;          // low 32 bits, like git
+        uint32_t mode = 0;
+        uint8_t stage = 0;
+        bool skipWorktree = false;
+        Mir::Utils::Sha1::Digest id{};
+    };
+
+    struct HashRequest {
+        std::filesystem::path path;
+        Mir::Utils::Sha1::Digest id;
+    };
+
+    struct HashResult {
+        std::filesystem::path path;
+        bool modified = false;
+        uint64_t generation = 0;
+    };
+
+    Options m_options;
+    bool m_isOpen = false;
+    std::string m_error;
+    std::filesystem::path m_top;
+    std::filesystem::path m_gitDirectory;
+    std::vector<IndexEntry> m_entries;  // sorted by path, stages of one path next to each other
+    std::string m_paths;
+    uint32_t m_indexSeconds = 0;        // entries written in this second or later are racy
+    std::unique_ptr<IgnoringFileSystem> m_ignore;
+    Stats m_stats;
+
+    std::atomic<uint64_t> m_generation{0};  // bumped by open and close, stale hashes are dropped
+    std::atomic<size_t> m_hashed{0};
+    std::atomic<uint64_t> m_hashedBytes{0};
+    std::mutex m_resultMutex;
+    std::vector<HashResult> m_results;
+    std::unique_ptr<Mir::ThreadPool> m_pool; // last, its workers use everything above
+
+    bool findRepository(const std::filesystem::path& root);
+    bool readIndex(const std::filesystem::path& file);
+    std::string_view pathOf(const IndexEntry& entry) const { return std::string_view(m_paths).substr(entry.pathOffset, entry.pathLength); }
+    // First entry whose path is not less than path
+    size_t lowerBound(std::string_view path) const;
+    bool hasEntriesBelow(std::string_view folder) const;
+    void annotateEntries(FileTree& tree, FileNode* directory, const std::unique_ptr<FileNode>* first, const std::unique_ptr<FileNode>* last, bool checkDeleted);
+    GitStatus classify(FileNode& node, std::string_view path, GitStatus inherited, std::vector<HashRequest>& hashes);
+    GitStatus untrackedStatus(const FileNode& node);
+    size_t countDeleted(const FileNode& directory, std::string_view folder);
+    void submitHashes(std::vector<HashRequest>& hashes);
+    void hashFiles(const std::vector<HashRequest>& hashes, uint64_t generation);
+    // directory and the loaded folders above it get ChildrenChanged
+    static void markChanged(FileTree& tree, FileNode* directory);
+    static bool isChange(GitStatus status);
+};
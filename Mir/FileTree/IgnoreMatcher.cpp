@@ -0,0 +1,321 @@
+#include "IgnoreMatcher.h"
+
+namespace {
+    constexpr std::string_view kSpecial = "*?[\\";
+}
+
+void IgnoreMatcher::addTo(Table& _table, std::string _key, uint32_t _rule) {
+    _table[std::move(_key)].push_back(_rule);
+}
+
+size_t IgnoreMatcher::addRules(std::string_view _text) {
+    size_t added = 0;
+    while (!_text.empty()) {
+        size_t end = _text.find('\n');
+        added += addRule(_text.substr(0, end));
+        _text = end == std::string_view::npos ? std::string_view() : _text.substr(end + 1);
+    }
+    return added;
+}
+
+bool IgnoreMatcher::addRule(std::string_view _line) {
+    if (!_line.empty() && _line.back() == '\r') {
+        _line.remove_suffix(1);
+    }
+    // Trailing spaces go unless escaped
+    while (!_line.empty() && _line.back() == ' ' && !(_line.size() >= 2 && _line[_line.size() - 2] == '\\')) {
+        _line.remove_suffix(1);
+    }
+    if (_line.empty() || _line[0] == '#') {
+        return false;
+    }
+    Rule rule;
+    if (_line[0] == '!') {
+        rule.negated = true;
+        _line.remove_prefix(1);
+    } else if (_line.starts_with("\\!") || _line.starts_with("\\#")) {
+        _line.remove_prefix(1);
+    }
+    if (!_line.empty() && _line.back() == '/') {
+        rule.directoryOnly = true;
+        _line.remove_suffix(1);
+    }
+    // A slash anywhere but at the end ties the rule to the folder of the rule file
+    bool anchored = _line.find('/') != std::string_view::npos;
+    if (_line.starts_with('/')) {
+        _line.remove_prefix(1);
+    }
+    // "**/name" is a name at any depth, like "name"
+    if (_line.starts_with("**/") && _line.find('/', 3) == std::string_view::npos) {
+        _line.remove_prefix(3);
+        anchored = false;
+    }
+    if (_line.empty()) {
+        return false;
+    }
+
+    uint32_t index = static_cast<uint32_t>(m_rules.size());
+    if (_line.find_first_of(kSpecial) == std::string_view::npos) {
+        addTo(anchored ? m_paths : m_names, std::string(_line), index);
+    } else if (!anchored && _line.size() > 1 && _line[0] == '*' && _line.find_first_of(kSpecial, 1) == std::string_view::npos) {
+        std::string suffix(_line.substr(1));
+        size_t dot = suffix.rfind('.');
+        if (dot != std::string::npos) {
+            m_extensions[suffix.substr(dot)].emplace_back(index, std::move(suffix));
+        } else {
+            m_suffixes.emplace_back(index, std::move(suffix));
+        }
+    } else if (!compileGlob(_line, index, anchored)) {
+        return false;
+    }
+    m_rules.push_back(rule);
+    return true;
+}
+
+bool IgnoreMatcher::compileGlob(std::string_view _pattern, uint32_t _rule, bool _anchored) {
+    std::vector<Token> tokens;
+    for (size_t i = 0; i < _pattern.size(); i++) {
+        char c = _pattern[i];
+        Token token;
+        if (c == '\\' && i + 1 < _pattern.size()) {
+            token.value = static_cast<uint8_t>(_pattern[++i]);
+        } else if (c == '?') {
+            token.kind = TokenKind::AnyChar;
+        } else if (c == '*') {
+            size_t first = i;
+            while (i + 1 < _pattern.size() && _pattern[i + 1] == '*') {
+                i++;
+            }
+            // "**" is only special as a whole path component, otherwise it is a '*'
+            bool wholeComponent = i > first && (first == 0 || _pattern[first - 1] == '/');
+            if (wholeComponent && i + 1 == _pattern.size()) {
+                token.kind = TokenKind::AnyPath;
+            } else if (wholeComponent && _pattern[i + 1] == '/') {
+                token.kind = TokenKind::AnyFolders;
+                i++;
+            } else {
+                token.kind = TokenKind::Star;
+            }
+        } else if (c == '[') {
+            std::bitset<256> set;
+            size_t j = i + 1;
+            bool negated = j < _pattern.size() && (_pattern[j] == '!' || _pattern[j] == '^');
+            if (negated) {
+                j++;
+            }
+            bool closed = false;
+            for (size_t start = j; j < _pattern.size(); j++) {
+                unsigned char low = static_cast<unsigned char>(_pattern[j]);
+                if (low == ']' && j > start) {
+                    closed = true;
+                    break;
+                }
+                if (low == '\\' && j + 1 < _pattern.size()) {
+                    low = static_cast<unsigned char>(_pattern[++j]);
+                }
+                unsigned char high = low;
+                if (j + 2 < _pattern.size() && _pattern[j + 1] == '-' && _pattern[j + 2] != ']') {
+                    high = static_cast<unsigned char>(_pattern[j + 2]);
+                    j += 2;
+                }
+                for (unsigned value = low; value <= high; value++) {
+                    set.set(value);
+                }
+            }
+            if (closed) {
+                if (negated) {
+                    set.flip();
+                }
+                set.reset('/');
+                token.kind = TokenKind::Class;
+                token.classIndex = static_cast<uint32_t>(m_classes.size());
+                m_classes.push_back(set);
+                i = j;
+            } else {
+                token.value = '['; // no closing bracket, a plain character
+            }
+        } else {
+            token.value = static_cast<uint8_t>(c);
+        }
+        // "a**b" and the like, one star is enough
+        if (token.kind == TokenKind::Star && !tokens.empty() && tokens.back().kind == TokenKind::Star) {
+            continue;
+        }
+        tokens.push_back(token);
+    }
+
+    Glob glob;
+    glob.rule = _rule;
+    glob.anchored = _anchored;
+    glob.length = static_cast<uint32_t>(tokens.size());
+    if (glob.length >= kMaxStates) {
+        glob.tokens = std::move(tokens);
+        m_globs.push_back(std::move(glob));
+        return true;
+    }
+    // State i means the first i tokens matched, token i takes the automaton to state i + 1
+    for (uint32_t state = 0; state < glob.length; state++) {
+        const Token& token = tokens[state];
+        uint64_t bit = uint64_t(1) << state;
+        switch (token.kind) {
+            case TokenKind::Star:
+                glob.stayNotSlash |= bit;
+                glob.skip |= bit;
+                break;
+            case TokenKind::AnyPath:
+                glob.stayAny |= bit;
+                glob.skip |= bit;
+                break;
+            case TokenKind::AnyFolders:
+                // Entered at a component start, so "a/**/b" is not "a/xb". Once it took a
+                // byte it can only be left through the next '/'.
+                glob.stayAny |= bit;
+                glob.skipOnEntry |= bit;
+                glob.advance['/'] |= bit;
+                break;
+            default:
+                for (unsigned c = 0; c < 256; c++) {
+                    if (accepts(token, static_cast<unsigned char>(c))) {
+                        glob.advance[c] |= bit;
+                    }
+                }
+                break;
+        }
+    }
+    glob.stayNotSlash |= glob.stayAny;
+    m_globs.push_back(std::move(glob));
+    return true;
+}
+
+bool IgnoreMatcher::accepts(const Token& _token, unsigned char c) const {
+    switch (_token.kind) {
+        case TokenKind::Char:
+            return c == _token.value;
+        case TokenKind::AnyChar:
+            return c != '/';
+        case TokenKind::Class:
+            return m_classes[_token.classIndex].test(c);
+        default:
+            return false;
+    }
+}
+
+bool IgnoreMatcher::runAutomaton(const Glob& _glob, std::string_view _text) const {
+    auto closure = [&](uint64_t entered, uint64_t stayed) {
+        // Tokens that may match nothing pass the state on, repeated for runs like "*/**/". A
+        // state that only looped on the last byte may not skip a "**/", it is mid component.
+        uint64_t reached = 0;
+        uint64_t fresh = entered | ((stayed & _glob.skip) << 1);
+        while ((fresh &= ~reached) != 0) {
+            reached |= fresh;
+            fresh = (fresh & (_glob.skip | _glob.skipOnEntry)) << 1;
+        }
+        return reached | stayed;
+    };
+    uint64_t states = closure(1, 0);
+    for (char c : _text) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        uint64_t entered = (states & _glob.advance[byte]) << 1;
+        uint64_t stayed = states & (byte == '/' ? _glob.stayAny : _glob.stayNotSlash);
+        if ((entered | stayed) == 0) {
+            return false;
+        }
+        states = closure(entered, stayed);
+    }
+    return (states >> _glob.length) & 1;
+}
+
+bool IgnoreMatcher::backtrack(const std::vector<Token>& _tokens, size_t _token, std::string_view _text, size_t _position) const {
+    for (; _token < _tokens.size(); _token++) {
+        const Token& token = _tokens[_token];
+        switch (token.kind) {
+            case TokenKind::Star:
+                for (size_t end = _position;; end++) {
+                    if (backtrack(_tokens, _token + 1, _text, end)) {
+                        return true;
+                    }
+                    if (end >= _text.size() || _text[end] == '/') {
+                        return false;
+                    }
+                }
+            case TokenKind::AnyPath:
+                for (size_t end = _position; end <= _text.size(); end++) {
+                    if (backtrack(_tokens, _token + 1, _text, end)) {
+                        return true;
+                    }
+                }
+                return false;
+            case TokenKind::AnyFolders:
+                if (backtrack(_tokens, _token + 1, _text, _position)) {
+                    return true;
+                }
+                for (size_t end = _position; end < _text.size(); end++) {
+                    if (_text[end] == '/' && backtrack(_tokens, _token + 1, _text, end + 1)) {
+                        return true;
+                    }
+                }
+                return false;
+            default:
+                if (_position >= _text.size() || !accepts(token, static_cast<unsigned char>(_text[_position]))) {
+                    return false;
+                }
+                _position++;
+                break;
+        }
+    }
+    return _position == _text.size();
+}
+
+IgnoreMatcher::Result IgnoreMatcher::match(std::string_view _path, bool _isDirectory) const {
+    size_t slash = _path.rfind('/');
+    std::string_view name = slash == std::string_view::npos ? _path : _path.substr(slash + 1);
+    int64_t best = -1;
+    auto applies = [&](uint32_t rule) { return static_cast<int64_t>(rule) > best && (_isDirectory || !m_rules[rule].directoryOnly); };
+    // Rule lists are in rule order, the last one that applies is the only candidate
+    auto lookup = [&](const Table& table, std::string_view key) {
+        auto it = table.find(key);
+        if (it == table.end()) {
+            return;
+        }
+        for (auto rule = it->second.rbegin(); rule != it->second.rend(); ++rule) {
+            if (applies(*rule)) {
+                best = *rule;
+                return;
+            }
+        }
+    };
+    lookup(m_names, name);
+    lookup(m_paths, _path);
+
+    auto checkSuffixes = [&](const std::vector<std::pair<uint32_t, std::string>>& suffixes) {
+        for (auto it = suffixes.rbegin(); it != suffixes.rend(); ++it) {
+            if (applies(it->first) && name.ends_with(it->second)) {
+                best = it->first;
+                return;
+            }
+        }
+    };
+    if (size_t dot = name.rfind('.'); dot != std::string_view::npos) {
+        if (auto it = m_extensions.find(name.substr(dot)); it != m_extensions.end()) {
+            checkSuffixes(it->second);
+        }
+    }
+    checkSuffixes(m_suffixes);
+
+    for (auto it = m_globs.rbegin(); it != m_globs.rend() && static_cast<int64_t>(it->rule) > best; ++it) {
+        if (!applies(it->rule)) {
+            continue;
+        }
+        std::string_view text = it->anchored ? _path : name;
+        bool matched = it->tokens.empty() ? runAutomaton(*it, text) : backtrack(it->tokens, 0, text, 0);
+        if (matched) {
+            best = it->rule;
+            break;
+        }
+    }
+
+    if (best < 0) {
+        return Result::None;
+    }
+    return m_rules[static_cast<size_t>(best)].negated ? Result::Included : Result::Ignored;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Rules of one .gitignore style file, compiled for matching every listed entry. Plain names
+// ("node_modules", "build/") and paths ("/out") are hash lookups, "*.ext" rules a lookup by the
+// extension. Everything else is a glob run as a bit-parallel automaton: one 64 bit state word,
+// two table lookups and a shift per character.
+//
+//   IgnoreMatcher matcher;
+//   matcher.addRules("node_modules/\n*.o\n!keep.o\n/docs/**/*.tmp\n");
+//   matcher.match("src/lib/x.o", false);     // Ignored
+//   matcher.match("src/keep.o", false);      // Included, a negated rule matched last
+//
+// Paths are relative to the folder of the rule file, '/' separated, without a leading slash.
+// Same rules as git: the last matching rule wins, rules without a '/' (a trailing one aside)
+// match the name at any depth, the others the whole path, a trailing '/' only matches folders.
+class IgnoreMatcher
+{
+public:
+    enum class Result {
+        None,       // no rule matched, ask the rules of the parent folder
+        Ignored,
+        Included    // a negated rule matched last
+    };
+
+    // One line, false for blank lines, comments and patterns that can never match
+    bool addRule(std::string_view line);
+    // Lines of a rule file, returns the number of rules added
+    size_t addRules(std::string_view text);
+
+    Result match(std::string_view path, bool isDirectory) const;
+    size_t size() const { return m_rules.size(); }
+    bool empty() const { return m_rules.empty(); }
+
+private:
+    struct Rule {
+        bool negated = false;
+        bool directoryOnly = false;
+    };
+
+    enum class TokenKind : uint8_t {
+        Char,
+        AnyChar,        // '?'
+        Class,          // "[a-z]", index into m_classes
+        Star,           // '*', never crosses a '/'
+        AnyPath,        // trailing "**", anything
+        AnyFolders      // "**/", nothing or anything that ends with '/'
+    };
+
+    struct Token {
+        TokenKind kind = TokenKind::Char;
+        uint8_t value = 0;      // Char
+        uint32_t classIndex = 0;
+    };
+
+    struct Glob {
+        uint32_t rule = 0;
+        bool anchored = false;  // matches the path, otherwise the name
+        uint32_t length = 0;    // tokens, the accepting state
+        // Automaton, only for globs of up to kMaxStates - 1 tokens
+        std::array<uint64_t, 256> advance{};    // states whose token takes the character
+        uint64_t stayAny = 0;                   // states looping on any character
+        uint64_t stayNotSlash = 0;              // ...on anything but '/'
+        uint64_t skip = 0;                      // states whose token may match nothing
+        uint64_t skipOnEntry = 0;               // ...but only right where they are entered ("**/")
+        // Longer globs are matched by backtracking over the tokens
+        std::vector<Token> tokens;
+    };
+    static constexpr uint32_t kMaxStates = 64;
+
+    // Lookups by string_view without building a std::string per entry
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view text) const { return std::hash<std::string_view>{}(text); }
+    };
+    using Table = std::unordered_map<std::string, std::vector<uint32_t>, Hash, std::equal_to<>>;
+
+    std::vector<Rule> m_rules;
+    Table m_names;                                      // name at any depth
+    Table m_paths;                                      // whole path
+    // "*<suffix>" by the suffix from its last '.', suffixes without one are checked one by one
+    std::unordered_map<std::string, std::vector<std::pair<uint32_t, std::string>>, Hash, std::equal_to<>> m_extensions;
+    std::vector<std::pair<uint32_t, std::string>> m_suffixes;
+    std::vector<Glob> m_globs;                          // in rule order
+    std::vector<std::bitset<256>> m_classes;
+
+    bool compileGlob(std::string_view pattern, uint32_t rule, bool anchored);
+    bool accepts(const Token& token, unsigned char c) const;
+    bool runAutomaton(const Glob& glob, std::string_view text) const;
+    bool backtrack(const std::vector<Token>& tokens, size_t token, std::string_view text, size_t position) const;
+    static void addTo(Table& table, std::string key, uint32_t rule);
+};
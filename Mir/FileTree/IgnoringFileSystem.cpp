@@ -0,0 +1,274 @@
+#include "IgnoringFileSystem.h"
+#include "utils/Profiler.h"
+#include "utils/Utils.h"
+#include <algorithm>
+
+namespace {
+    // "/a/b/" and "/a/./b" are the same folder as "/a/b"
+    std::filesystem::path normalized(const std::filesystem::path& path) {
+        std::filesystem::path result = path.lexically_normal();
+        if (!result.has_filename() && result.has_relative_path()) {
+            result = result.parent_path();
+        }
+        return result;
+    }
+
+    // Sizes of skipped files are read in batches like the listed ones
+    constexpr size_t kSizeBatch = 256;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Reader START
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+class IgnoringFileSystem::Reader : public FileSystemProvider::DirectoryReader {
+public:
+    Reader(IgnoringFileSystem& owner, std::unique_ptr<DirectoryReader> source, std::shared_ptr<const Level> level, std::string directory)
+        : m_owner(owner), m_source(std::move(source)), m_level(std::move(level)), m_path(std::move(directory)) {
+        m_directoryLength = m_path.size();
+    }
+
+    bool next(FileSystemProvider::Entry& entry) override {
+        while (m_source->next(entry)) {
+            m_path.resize(m_directoryLength);
+            if (m_directoryLength != 0) {
+                m_path += '/';
+            }
+            m_path += Mir::Utils::File::toUtf8(entry.path.filename());
+            bool isDirectory = entry.type == FileType::DIR;
+            if (!isIgnored(m_level.get(), m_path, isDirectory)) {
+                return true;
+            }
+            if (isDirectory) {
+                m_owner.m_skippedFolders.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            m_owner.m_skippedFiles.fetch_add(1, std::memory_order_relaxed);
+            if (entry.hasMetadata) {
+                m_owner.m_skippedBytes.fetch_add(entry.size, std::memory_order_relaxed);
+                continue;
+            }
+            auto node = std::make_unique<FileNode>(std::string(), FileType::FILE);
+            node->fullPath = std::move(entry.path);
+            m_unsized.push_back(std::move(node));
+            if (m_unsized.size() >= kSizeBatch) {
+                countSizes();
+            }
+        }
+        countSizes();
+        return false;
+    }
+
+private:
+    IgnoringFileSystem& m_owner;
+    std::unique_ptr<DirectoryReader> m_source;
+    std::shared_ptr<const Level> m_level;
+    std::string m_path;         // folder relative to the top, then the current entry
+    size_t m_directoryLength = 0;
+    std::vector<std::unique_ptr<FileNode>> m_unsized;
+
+    void countSizes() {
+        if (m_unsized.empty()) {
+            return;
+        }
+        m_owner.m_source->loadMetadata(m_unsized);
+        uint64_t bytes = 0;
+        for (const auto& node : m_unsized) {
+            bytes += node->size;
+        }
+        m_owner.m_skippedBytes.fetch_add(bytes, std::memory_order_relaxed);
+        m_unsized.clear();
+    }
+};
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Reader END
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+IgnoringFileSystem::IgnoringFileSystem(std::shared_ptr<FileSystemProvider> _source, Options _options)
+    : m_source(std::move(_source)), m_options(std::move(_options)) {}
+
+void IgnoringFileSystem::setRoot(const std::filesystem::path& _root) {
+    MIR_PROFILE_SCOPE("IgnoringFileSystem::setRoot");
+    std::filesystem::path root = normalized(_root);
+    m_skippedFolders = 0;
+    m_skippedFiles = 0;
+    m_skippedBytes = 0;
+    m_ruleFiles = 0;
+    m_rules = 0;
+
+    // Rule files above the root count too when the root is somewhere inside a repository
+    std::filesystem::path top = root;
+    bool inRepository = false;
+    if (m_options.readRuleFiles) {
+        for (std::filesystem::path folder = root;; folder = folder.parent_path()) {
+            if (m_source->exists(folder / ".git")) {
+                top = folder;
+                inRepository = true;
+                break;
+            }
+            if (!folder.has_relative_path()) {
+                break;
+            }
+        }
+    }
+
+    // Lowest precedence first: the user list, the repository excludes, then every rule file
+    // from the repository down to the root
+    std::shared_ptr<const Level> chain;
+    std::string rootBase;
+    if (relativeTo(top, root, rootBase) && !m_options.patterns.empty()) {
+        auto level = std::make_shared<Level>();
+        level->base = rootBase;
+        for (const std::string& pattern : m_options.patterns) {
+            level->matcher.addRule(pattern);
+        }
+        m_rules += level->matcher.size();
+        if (!level->matcher.empty()) {
+            chain = std::move(level);
+        }
+    }
+    if (m_options.readRuleFiles) {
+        if (inRepository) {
+            chain = addRuleFile(top / ".git" / "info" / "exclude", top, top, chain);
+        }
+        std::filesystem::path folder = top;
+        chain = addRuleFile(folder / m_options.ruleFileName, top, folder, chain);
+        for (const auto& part : root.lexically_relative(top)) {
+            if (part == ".") {
+                continue;
+            }
+            folder /= part;
+            chain = addRuleFile(folder / m_options.ruleFileName, top, folder, chain);
+        }
+    }
+
+    std::lock_guard lock(m_mutex);
+    m_root = root;
+    m_top = top;
+    m_levels.clear();
+    m_levels.emplace(root.native(), std::move(chain));
+}
+
+IgnoringFileSystem::Stats IgnoringFileSystem::getStats() const {
+    Stats stats;
+    stats.skippedFolders = m_skippedFolders.load(std::memory_order_relaxed);
+    stats.skippedFiles = m_skippedFiles.load(std::memory_order_relaxed);
+    stats.skippedBytes = m_skippedBytes.load(std::memory_order_relaxed);
+    stats.ruleFiles = m_ruleFiles.load(std::memory_order_relaxed);
+    stats.rules = m_rules.load(std::memory_order_relaxed);
+    return stats;
+}
+
+bool IgnoringFileSystem::isIgnored(const std::filesystem::path& _path, bool _isDirectory) {
+    std::filesystem::path path = normalized(_path);
+    std::shared_ptr<const Level> level = levelFor(path.parent_path());
+    std::filesystem::path top;
+    {
+        std::lock_guard lock(m_mutex);
+        top = m_top;
+    }
+    std::string relative;
+    return level && relativeTo(top, path, relative) && isIgnored(level.get(), relative, _isDirectory);
+}
+
+std::unique_ptr<FileSystemProvider::DirectoryReader> IgnoringFileSystem::openDirectory(const std::filesystem::path& _directory) {
+    std::filesystem::path directory = normalized(_directory);
+    std::shared_ptr<const Level> level = levelFor(directory);
+    std::string relative;
+    std::filesystem::path top;
+    {
+        std::lock_guard lock(m_mutex);
+        top = m_top;
+    }
+    auto source = m_source->openDirectory(_directory);
+    if (!source || !level || !relativeTo(top, directory, relative)) {
+        return source;
+    }
+    return std::make_unique<Reader>(*this, std::move(source), std::move(level), std::move(relative));
+}
+
+std::shared_ptr<const IgnoringFileSystem::Level> IgnoringFileSystem::levelFor(const std::filesystem::path& _directory) {
+    std::filesystem::path root;
+    std::filesystem::path top;
+    {
+        std::lock_guard lock(m_mutex);
+        auto it = m_levels.find(_directory.native());
+        if (it != m_levels.end()) {
+            return it->second;
+        }
+        root = m_root;
+        top = m_top;
+    }
+    // Only folders below the root inherit rules, anything else is listed as is
+    std::string relative;
+    if (root.empty() || _directory == root || !relativeTo(root, _directory, relative) || relative.empty()) {
+        return nullptr;
+    }
+    // Folders are opened from the top down, so the parent is normally known already
+    std::shared_ptr<const Level> level = levelFor(_directory.parent_path());
+    if (m_options.readRuleFiles) {
+        level = addRuleFile(_directory / m_options.ruleFileName, top, _directory, std::move(level));
+    }
+
+    std::lock_guard lock(m_mutex);
+    // A setRoot in the meantime made these rules stale, they still answer this one listing
+    if (m_root == root) {
+        m_levels.emplace(_directory.native(), level);
+    }
+    return level;
+}
+
+std::shared_ptr<const IgnoringFileSystem::Level> IgnoringFileSystem::addRuleFile(const std::filesystem::path& _file, const std::filesystem::path& _top,
+    const std::filesystem::path& _folder, std::shared_ptr<const Level> _parent) {
+    std::string text;
+    std::string base;
+    if (!m_source->readFile(_file, text) || !relativeTo(_top, _folder, base)) {
+        return _parent;
+    }
+    auto level = std::make_shared<Level>();
+    level->base = std::move(base);
+    level->matcher.addRules(text);
+    m_ruleFiles.fetch_add(1, std::memory_order_relaxed);
+    m_rules.fetch_add(level->matcher.size(), std::memory_order_relaxed);
+    if (level->matcher.empty()) {
+        return _parent;
+    }
+    level->parent = std::move(_parent);
+    return level;
+}
+
+bool IgnoringFileSystem::relativeTo(const std::filesystem::path& _top, const std::filesystem::path& _path, std::string& _relative) {
+    std::filesystem::path relative = _path.lexically_relative(_top);
+    if (relative.empty()) {
+        return false; // different roots
+    }
+    _relative = Mir::Utils::File::toUtf8(relative);
+#ifdef _WIN32
+    std::replace(_relative.begin(), _relative.end(), '\\', '/');
+#endif
+    if (_relative == ".") {
+        _relative.clear();
+    }
+    return !(_relative == ".." || _relative.starts_with("../"));
+}
+
+bool IgnoringFileSystem::isIgnored(const Level* _level, std::string_view _path, bool _isDirectory) {
+    // Deepest rule file first, the first one with an opinion decides
+    for (; _level; _level = _level->parent.get()) {
+        std::string_view relative = _path;
+        if (!_level->base.empty()) {
+            if (relative.size() <= _level->base.size()) {
+                continue;
+            }
+            relative.remove_prefix(_level->base.size() + 1);
+        }
+        switch (_level->matcher.match(relative, _isDirectory)) {
+            case IgnoreMatcher::Result::Ignored:
+                return true;
+            case IgnoreMatcher::Result::Included:
+                return false;
+            case IgnoreMatcher::Result::None:
+                break;
+        }
+    }
+    return false;
+}
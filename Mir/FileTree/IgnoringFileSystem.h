@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "FileSystemProvider.h"
+#include "IgnoreMatcher.h"
+
+// Wraps the provider a FileTree lists through and drops ignored entries while listing, so an
+// ignored folder is never opened at all. Rules come from .gitignore files (of the opened
+// folders, and of the folders above the root up to the enclosing repository) and a user list
+// that every rule file can override. FileTree installs it with setIgnoreRules.
+class IgnoringFileSystem : public FileSystemProvider
+{
+public:
+    struct Options {
+        bool readRuleFiles = true;
+        std::string ruleFileName = ".gitignore";
+        std::vector<std::string> patterns = {".git/"}; // gitignore syntax, relative to the root
+    };
+
+    struct Stats {
+        size_t skippedFolders = 0;  // not opened, their contents are not counted
+        size_t skippedFiles = 0;
+        uint64_t skippedBytes = 0;  // of the skipped files
+        size_t ruleFiles = 0;       // read so far
+        size_t rules = 0;
+    };
+
+    IgnoringFileSystem(std::shared_ptr<FileSystemProvider> source, Options options);
+
+    // Call before listing anything below root, drops the rules read for the previous one
+    void setRoot(const std::filesystem::path& root);
+    const std::shared_ptr<FileSystemProvider>& getSource() const { return m_source; }
+    const Options& getOptions() const { return m_options; }
+    Stats getStats() const;
+    // What a listing of its folder would decide for path, false outside the root
+    bool isIgnored(const std::filesystem::path& path, bool isDirectory);
+    // '/' separated UTF-8, "" for top itself. false if path is not below top.
+    static bool relativeTo(const std::filesystem::path& top, const std::filesystem::path& path, std::string& relative);
+
+    std::unique_ptr<DirectoryReader> openDirectory(const std::filesystem::path& directory) override;
+    bool exists(const std::filesystem::path& path) override { return m_source->exists(path); }
+    void loadMetadata(std::vector<std::unique_ptr<FileNode>>& nodes, size_t first = 0) override { m_source->loadMetadata(nodes, first); }
+    bool readFile(const std::filesystem::path& path, std::string& out) override { return m_source->readFile(path, out); }
+    Mir::IoScheduler::DeviceId deviceOf(const std::filesystem::path& path) override { return m_source->deviceOf(path); }
+    bool isNative() const override { return m_source->isNative(); }
+
+private:
+    class Reader;
+
+    // Rules of one file, the parent chain holds the ones it overrides
+    struct Level {
+        std::string base;       // folder of the rule file, relative to m_top, "" for m_top itself
+        IgnoreMatcher matcher;
+        std::shared_ptr<const Level> parent;
+    };
+
+    std::shared_ptr<FileSystemProvider> m_source;
+    Options m_options;
+
+    mutable std::mutex m_mutex;     // guards everything up to the stats
+    std::filesystem::path m_root;
+    std::filesystem::path m_top;    // enclosing repository, or the root when there is none
+    std::unordered_map<std::filesystem::path::string_type, std::shared_ptr<const Level>> m_levels; // by folder
+
+    std::atomic<size_t> m_skippedFolders{0};
+    std::atomic<size_t> m_skippedFiles{0};
+    std::atomic<uint64_t> m_skippedBytes{0};
+    std::atomic<size_t> m_ruleFiles{0};
+    std::atomic<size_t> m_rules{0};
+
+    // Rules that apply to the entries of directory, nullptr outside the root
+    std::shared_ptr<const Level> levelFor(const std::filesystem::path& directory);
+    // parent with the rules of file on top, or parent alone when there is no such file
+    std::shared_ptr<const Level> addRuleFile(const std::filesystem::path& file, const std::filesystem::path& top,
+        const std::filesystem::path& folder, std::shared_ptr<const Level> parent);
+    static bool isIgnored(const Level* level, std::string_view path, bool isDirectory);
+};
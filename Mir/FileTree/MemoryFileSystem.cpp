@@ -0,0 +1,395 @@
+#include "MemoryFileSystem.h"
+#include "utils/Profiler.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <string_view>
+#include <thread>
+
+namespace {
+    constexpr const char* kExtensions[] = {".txt", ".cpp", ".h", ".md", ".log", ".csv"};
+    // Shorter sleeps oversleep by more than they last, per entry delays are paid in steps
+    constexpr std::chrono::microseconds kMinSleep{1000};
+    // 2023-11-14, every file is up to a year older
+    constexpr int64_t kNewestTime = 1700000000;
+    constexpr int64_t kTimeSpread = 365 * 24 * 3600;
+
+    uint64_t mix(uint64_t value) {
+        // splitmix64 finalizer
+        value += 0x9e3779b97f4a7c15ull;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        return value ^ (value >> 31);
+    }
+
+    uint64_t childSeed(uint64_t parentSeed, size_t index) {
+        return mix(parentSeed * 31 + index + 1);
+    }
+
+    int digitsOf(size_t count) {
+        int digits = 1;
+        for (size_t value = count > 0 ? count - 1 : 0; value >= 10; value /= 10) {
+            digits++;
+        }
+        return digits;
+    }
+
+    // "<prefix><digits>", exactly width digits, below count
+    bool parseIndex(std::string_view name, std::string_view prefix, int width, size_t count, size_t& index) {
+        if (name.size() < prefix.size() + static_cast<size_t>(width) || name.substr(0, prefix.size()) != prefix) {
+            return false;
+        }
+        index = 0;
+        for (int i = 0; i < width; i++) {
+            char c = name[prefix.size() + i];
+            if (c < '0' || c > '9') {
+                return false;
+            }
+            index = index * 10 + static_cast<size_t>(c - '0');
+        }
+        return index < count;
+    }
+
+    bool isSeparator(std::filesystem::path::value_type c) {
+        return c == '/' || c == std::filesystem::path::preferred_separator;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Reader START
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+class MemoryFileSystem::Reader : public FileSystemProvider::DirectoryReader {
+public:
+    Reader(MemoryFileSystem& owner, std::filesystem::path directory, const Location& location)
+        : m_owner(owner), m_directory(std::move(directory)), m_seed(location.seed) {
+        m_dirCount = location.level < owner.m_shape.depth ? owner.m_shape.dirsPerDir : 0;
+        m_total = m_dirCount + owner.m_shape.filesPerDir;
+    }
+
+    ~Reader() override {
+        m_owner.m_entriesListed.fetch_add(m_index, std::memory_order_relaxed);
+    }
+
+    bool next(FileSystemProvider::Entry& entry) override {
+        std::chrono::microseconds perEntry;
+        bool withMetadata;
+        {
+            std::lock_guard lock(m_owner.m_latencyMutex);
+            perEntry = m_owner.m_latency.perEntry;
+            withMetadata = m_owner.m_latency.perStat.count() == 0;
+        }
+        if (m_index >= m_total) {
+            m_owner.delay(m_debt);
+            m_debt = {};
+            return false;
+        }
+        m_debt += perEntry;
+        if (m_debt >= kMinSleep) {
+            m_owner.delay(m_debt);
+            m_debt = {};
+        }
+
+        size_t index = m_index++;
+        entry.isSymlink = false;
+        if (index < m_dirCount) {
+            entry.path = m_directory / m_owner.dirName(index);
+            entry.type = FileType::DIR;
+            entry.hasMetadata = false;
+            entry.size = 0;
+            entry.modifiedTime = 0;
+            return true;
+        }
+        size_t fileIndex = index - m_dirCount;
+        entry.path = m_directory / m_owner.fileName(m_seed, fileIndex);
+        entry.type = FileType::FILE;
+        entry.hasMetadata = withMetadata;
+        if (withMetadata) {
+            FileInfo info = m_owner.fileInfo(m_seed, fileIndex);
+            entry.size = info.size;
+            entry.modifiedTime = info.modifiedTime;
+        }
+        return true;
+    }
+
+private:
+    MemoryFileSystem& m_owner;
+    std::filesystem::path m_directory;
+    uint64_t m_seed;
+    size_t m_dirCount = 0;
+    size_t m_total = 0;
+    size_t m_index = 0;
+    std::chrono::microseconds m_debt{0};
+};
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Reader END
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+MemoryFileSystem::MemoryFileSystem(std::filesystem::path _root, const Shape& _shape)
+    : MemoryFileSystem(std::move(_root), _shape, Latency()) {}
+
+MemoryFileSystem::MemoryFileSystem(std::filesystem::path _root, const Shape& _shape, const Latency& _latency)
+    : m_root(std::move(_root)), m_shape(_shape), m_latency(_latency) {
+    m_shape.maxFileSize = std::max(m_shape.maxFileSize, m_shape.minFileSize);
+    m_dirDigits = digitsOf(m_shape.dirsPerDir);
+    m_fileDigits = digitsOf(m_shape.filesPerDir);
+}
+
+std::unique_ptr<FileSystemProvider::DirectoryReader> MemoryFileSystem::openDirectory(const std::filesystem::path& _directory) {
+    MIR_PROFILE_SCOPE("MemoryFileSystem::openDirectory");
+    delay(getLatency().perCall);
+    Location location;
+    if (!locate(_directory, location) || location.isFile) {
+        return nullptr;
+    }
+    m_directoriesListed.fetch_add(1, std::memory_order_relaxed);
+    return std::make_unique<Reader>(*this, _directory, location);
+}
+
+bool MemoryFileSystem::exists(const std::filesystem::path& _path) {
+    delay(getLatency().perCall);
+    Location location;
+    return locate(_path, location);
+}
+
+void MemoryFileSystem::loadMetadata(std::vector<std::unique_ptr<FileNode>>& _nodes, size_t _first) {
+    std::chrono::microseconds perStat = getLatency().perStat;
+    if (perStat.count() == 0) {
+        return; // listed with the entries
+    }
+    size_t files = 0;
+    for (size_t i = _first; i < _nodes.size(); i++) {
+        FileNode& node = *_nodes[i];
+        Location location;
+        if (node.type != FileType::FILE || !locate(node.fullPath, location) || !location.isFile) {
+            continue;
+        }
+        FileInfo info = fileInfo(location.seed, location.fileIndex);
+        node.size = static_cast<size_t>(info.size);
+        node.modifiedTime = info.modifiedTime;
+        files++;
+    }
+    m_stats.fetch_add(files, std::memory_order_relaxed);
+    delay(perStat * static_cast<int64_t>(files));
+}
+
+bool MemoryFileSystem::readFile(const std::filesystem::path& _path, std::string& _out) {
+    delay(getLatency().perCall);
+    Location location;
+    if (!locate(_path, location) || !location.isFile) {
+        return false;
+    }
+    FileInfo info = fileInfo(location.seed, location.fileIndex);
+    std::string name = fileName(location.seed, location.fileIndex);
+    size_t size = static_cast<size_t>(info.size);
+    _out.clear();
+    _out.reserve(size + 64);
+    for (size_t line = 1; _out.size() < size; line++) {
+        _out += name;
+        _out += " line ";
+        _out += std::to_string(line);
+        _out += '\n';
+    }
+    _out.resize(size);
+    m_filesRead.fetch_add(1, std::memory_order_relaxed);
+    m_bytesRead.fetch_add(size, std::memory_order_relaxed);
+    return true;
+}
+
+void MemoryFileSystem::setLatency(const Latency& _latency) {
+    {
+        std::lock_guard lock(m_latencyMutex);
+        m_latency = _latency;
+    }
+    m_slotFree.notify_all();
+}
+
+MemoryFileSystem::Latency MemoryFileSystem::getLatency() const {
+    std::lock_guard lock(m_latencyMutex);
+    return m_latency;
+}
+
+MemoryFileSystem::Stats MemoryFileSystem::getStats() const {
+    Stats stats;
+    stats.directoriesListed = m_directoriesListed.load(std::memory_order_relaxed);
+    stats.entriesListed = m_entriesListed.load(std::memory_order_relaxed);
+    stats.stats = m_stats.load(std::memory_order_relaxed);
+    stats.filesRead = m_filesRead.load(std::memory_order_relaxed);
+    stats.bytesRead = m_bytesRead.load(std::memory_order_relaxed);
+    stats.injected = std::chrono::microseconds(m_injectedUs.load(std::memory_order_relaxed));
+    return stats;
+}
+
+void MemoryFileSystem::resetStats() {
+    m_directoriesListed = 0;
+    m_entriesListed = 0;
+    m_stats = 0;
+    m_filesRead = 0;
+    m_bytesRead = 0;
+    m_injectedUs = 0;
+}
+
+bool MemoryFileSystem::parseSpec(std::string_view _spec, Shape& _shape, Latency& _latency) {
+    while (!_spec.empty()) {
+        size_t comma = _spec.find(',');
+        std::string_view item = _spec.substr(0, comma);
+        _spec = comma == std::string_view::npos ? std::string_view() : _spec.substr(comma + 1);
+        if (item.empty()) {
+            continue;
+        }
+        size_t equals = item.find('=');
+        if (equals == std::string_view::npos) {
+            return false;
+        }
+        std::string_view key = item.substr(0, equals);
+        uint64_t value = 0;
+        auto [end, error] = std::from_chars(item.data() + equals + 1, item.data() + item.size(), value);
+        if (error != std::errc() || end != item.data() + item.size()) {
+            return false;
+        }
+        if (key == "depth") {
+            _shape.depth = static_cast<size_t>(value);
+        } else if (key == "dirs") {
+            _shape.dirsPerDir = static_cast<size_t>(value);
+        } else if (key == "files") {
+            _shape.filesPerDir = static_cast<size_t>(value);
+        } else if (key == "min_size") {
+            _shape.minFileSize = value;
+        } else if (key == "max_size") {
+            _shape.maxFileSize = value;
+        } else if (key == "seed") {
+            _shape.seed = value;
+        } else if (key == "call_us") {
+            _latency.perCall = std::chrono::microseconds(value);
+        } else if (key == "entry_us") {
+            _latency.perEntry = std::chrono::microseconds(value);
+        } else if (key == "stat_us") {
+            _latency.perStat = std::chrono::microseconds(value);
+        } else if (key == "concurrency") {
+            _latency.maxConcurrentCalls = static_cast<size_t>(value);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t MemoryFileSystem::countDirectories(const Shape& _shape) {
+    uint64_t total = 0;
+    uint64_t level = 1;
+    for (size_t depth = 0; depth <= _shape.depth; depth++) {
+        total += level;
+        level *= _shape.dirsPerDir;
+    }
+    return total;
+}
+
+uint64_t MemoryFileSystem::countFiles(const Shape& _shape) {
+    return countDirectories(_shape) * _shape.filesPerDir;
+}
+
+bool MemoryFileSystem::locate(const std::filesystem::path& _path, Location& _location) const {
+    // Plain string walk, lexically_relative would cost more than the listing itself
+    const std::filesystem::path::string_type& full = _path.native();
+    const std::filesystem::path::string_type& root = m_root.native();
+    if (full.size() < root.size() || full.compare(0, root.size(), root) != 0) {
+        return false;
+    }
+    _location = Location();
+    _location.seed = mix(m_shape.seed);
+    size_t position = root.size();
+    std::string part;
+    while (position < full.size()) {
+        if (isSeparator(full[position])) {
+            position++;
+            continue;
+        }
+        // A separator has to follow the root, "/mem2" is not in "/mem"
+        if (position == root.size() && !root.empty() && !isSeparator(root.back())) {
+            return false;
+        }
+        size_t end = position;
+        while (end < full.size() && !isSeparator(full[end])) {
+            end++;
+        }
+        // Made up names are ASCII, anything else is not in the tree
+        part.clear();
+        for (size_t i = position; i < end; i++) {
+            if (static_cast<uint32_t>(full[i]) > 0x7f) {
+                return false;
+            }
+            part += static_cast<char>(full[i]);
+        }
+        position = end;
+        if (_location.isFile) {
+            return false; // nothing below a file
+        }
+
+        size_t index;
+        if (_location.level < m_shape.depth && part.size() == 4 + static_cast<size_t>(m_dirDigits)
+            && parseIndex(part, "dir_", m_dirDigits, m_shape.dirsPerDir, index)) {
+            _location.level++;
+            _location.seed = childSeed(_location.seed, index);
+            continue;
+        }
+        if (parseIndex(part, "file_", m_fileDigits, m_shape.filesPerDir, index)
+            && part.substr(5 + m_fileDigits) == fileInfo(_location.seed, index).extension) {
+            _location.isFile = true;
+            _location.fileIndex = index;
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+MemoryFileSystem::FileInfo MemoryFileSystem::fileInfo(uint64_t _folderSeed, size_t _index) const {
+    uint64_t hash = childSeed(_folderSeed ^ 0x5bd1e995u, _index);
+    FileInfo info;
+    info.size = m_shape.minFileSize + hash % (m_shape.maxFileSize - m_shape.minFileSize + 1);
+    hash = mix(hash);
+    auto seconds = std::chrono::sys_seconds(std::chrono::seconds(kNewestTime - static_cast<int64_t>(hash % kTimeSpread)));
+    // File clock ticks like the disk listings, so sorting by date compares like with like
+#ifdef _MSC_VER
+    info.modifiedTime = std::chrono::clock_cast<std::filesystem::file_time_type::clock>(seconds).time_since_epoch().count();
+#else
+    info.modifiedTime = std::filesystem::file_time_type::clock::from_sys(seconds).time_since_epoch().count();
+#endif
+    info.extension = kExtensions[(hash >> 32) % std::size(kExtensions)];
+    return info;
+}
+
+std::string MemoryFileSystem::dirName(size_t _index) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "dir_%0*zu", m_dirDigits, _index);
+    return name;
+}
+
+std::string MemoryFileSystem::fileName(uint64_t _folderSeed, size_t _index) const {
+    char name[48];
+    std::snprintf(name, sizeof(name), "file_%0*zu%s", m_fileDigits, _index, fileInfo(_folderSeed, _index).extension);
+    return name;
+}
+
+void MemoryFileSystem::delay(std::chrono::microseconds _amount) {
+    if (_amount.count() <= 0) {
+        return;
+    }
+    m_injectedUs.fetch_add(_amount.count(), std::memory_order_relaxed);
+    bool limited;
+    {
+        std::unique_lock lock(m_latencyMutex);
+        m_slotFree.wait(lock, [this] { return m_latency.maxConcurrentCalls == 0 || m_busy < m_latency.maxConcurrentCalls; });
+        limited = m_latency.maxConcurrentCalls != 0;
+        if (limited) {
+            m_busy++;
+        }
+    }
+    std::this_thread::sleep_for(_amount);
+    if (limited) {
+        {
+            std::lock_guard lock(m_latencyMutex);
+            m_busy--;
+        }
+        m_slotFree.notify_one();
+    }
+}
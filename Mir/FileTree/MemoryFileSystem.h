@@ -0,0 +1,119 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "FileSystemProvider.h"
+
+// Made up tree for benchmarks: nothing is stored, every listing is computed from the path, so
+// millions of entries cost no memory until FileTree loads them and every run sees the same names,
+// sizes and times. Latency is injected per call to reproduce slow network shares on demand.
+//
+//   MemoryFileSystem::Shape shape;
+//   shape.depth = 2;                  // root, 10 folders, 100 subfolders
+//   shape.filesPerDir = 1000;         // 111000 files
+//   auto memory = std::make_shared<MemoryFileSystem>("/mem", shape);
+//   memory->setLatency({.perCall = std::chrono::milliseconds(20)});
+//   FileTree tree("/mem", memory);
+//
+// Folders are "dir_<n>", files "file_<n>.<ext>", padded to the same width within a folder.
+class MemoryFileSystem : public FileSystemProvider
+{
+public:
+    struct Shape {
+        size_t depth = 2;               // folder levels below the root
+        size_t dirsPerDir = 10;
+        size_t filesPerDir = 100;       // in every folder, the root included
+        uint64_t minFileSize = 0;
+        uint64_t maxFileSize = 64 * 1024;
+        uint64_t seed = 1;              // different seeds give different sizes, times and extensions
+    };
+
+    struct Latency {
+        std::chrono::microseconds perCall{0};   // openDirectory, exists, readFile
+        std::chrono::microseconds perEntry{0};  // every listed entry, paid in 1 ms steps
+        // When set, listings come without size and time and loadMetadata pays this for every
+        // file, like a stat round trip each
+        std::chrono::microseconds perStat{0};
+        size_t maxConcurrentCalls = 0;          // calls delayed at once, the rest queue. 0 = no limit
+    };
+
+    struct Stats {
+        size_t directoriesListed = 0;
+        size_t entriesListed = 0;
+        size_t stats = 0;
+        size_t filesRead = 0;
+        size_t bytesRead = 0;
+        std::chrono::microseconds injected{0};  // total delay, summed over all threads
+    };
+
+    MemoryFileSystem(std::filesystem::path root, const Shape& shape);
+    MemoryFileSystem(std::filesystem::path root, const Shape& shape, const Latency& latency);
+
+    std::unique_ptr<DirectoryReader> openDirectory(const std::filesystem::path& directory) override;
+    bool exists(const std::filesystem::path& path) override;
+    void loadMetadata(std::vector<std::unique_ptr<FileNode>>& nodes, size_t first = 0) override;
+    bool readFile(const std::filesystem::path& path, std::string& out) override;
+    // One queue for the whole tree, like a single server
+    Mir::IoScheduler::DeviceId deviceOf(const std::filesystem::path&) override { return reinterpret_cast<uintptr_t>(this); }
+
+    const std::filesystem::path& getRoot() const { return m_root; }
+    const Shape& getShape() const { return m_shape; }
+    // Safe while listings run, they pick it up with their next call
+    void setLatency(const Latency& latency);
+    Latency getLatency() const;
+    Stats getStats() const;
+    void resetStats();
+
+    // "depth=3,dirs=10,files=1000,call_us=20000" into shape and latency, keys left out keep their
+    // value. Other keys: min_size, max_size, seed, entry_us, stat_us, concurrency. false on a typo.
+    static bool parseSpec(std::string_view spec, Shape& shape, Latency& latency);
+    // Folders (root included) and files in a tree of that shape
+    static uint64_t countDirectories(const Shape& shape);
+    static uint64_t countFiles(const Shape& shape);
+
+private:
+    class Reader;
+
+    // What a path names in the made up tree
+    struct Location {
+        size_t level = 0;       // 0 = root
+        uint64_t seed = 0;      // of the folder, or of the folder the file is in
+        bool isFile = false;
+        size_t fileIndex = 0;
+    };
+
+    struct FileInfo {
+        uint64_t size = 0;
+        int64_t modifiedTime = 0;
+        const char* extension = "";
+    };
+
+    std::filesystem::path m_root;
+    Shape m_shape;
+    int m_dirDigits = 1;
+    int m_fileDigits = 1;
+
+    mutable std::mutex m_latencyMutex;
+    Latency m_latency;
+    std::condition_variable m_slotFree;
+    size_t m_busy = 0;
+
+    std::atomic<size_t> m_directoriesListed{0};
+    std::atomic<size_t> m_entriesListed{0};
+    std::atomic<size_t> m_stats{0};
+    std::atomic<size_t> m_filesRead{0};
+    std::atomic<size_t> m_bytesRead{0};
+    std::atomic<int64_t> m_injectedUs{0};
+
+    bool locate(const std::filesystem::path& path, Location& location) const;
+    FileInfo fileInfo(uint64_t folderSeed, size_t index) const;
+    std::string dirName(size_t index) const;
+    std::string fileName(uint64_t folderSeed, size_t index) const;
+    void delay(std::chrono::microseconds amount);
+};
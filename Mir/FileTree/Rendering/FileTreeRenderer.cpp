@@ -3,14 +3,33 @@
 #include "imgui_stdlib.h"
 #include "utils/Utils.h"
 #include "ImguiUtils.h"
+#include "utils/Profiler.h"
+#include "utils/Redraw.h"
+#include "utils/IoScheduler.h"
+#include "utils/Epoch.h"
 FileTreeRenderer::FileTreeRenderer(const std::shared_ptr<FileTree>& _fileTree)
     : m_FileTree{_fileTree}, m_fileDialog{Mir::IFileDialogManager::Create()} {}
 
+FileTreeRenderer::~FileTreeRenderer() {
+    // The future blocks in its destructor, make the comparison stop early
+    if (m_activeDiff) {
+        m_activeDiff->cancel();
+    }
+    if (m_activeOperation) {
+        m_activeOperation->cancel();
+    }
+}
+
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 // Rendering START
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 void FileTreeRenderer::Render(){
-    auto rootFolder = m_FileTree->getRootFolder().string();
+    MIR_PROFILE_SCOPE("FileTreeRenderer::Render");
+    DrainCallbackResults();
+    m_FileTree->pumpExpansions();
+    PollDiff();
+    PollFileOperation();
+    auto rootFolder = Mir::Utils::File::toUtf8(m_FileTree->getRootFolder());
     ImGui::Begin("File Tree");
     
     ImGui::PushItemWidth(-1.0f);
@@ -21,15 +40,22 @@ void FileTreeRenderer::Render(){
     
     ImGui::Separator();
     
-    // Render each node in file tree
+    // Render each node in file tree. Nodes come from the published snapshots, the guard keeps
+    // whatever this frame saw alive even if a worker or a click below unlinks it.
     if (m_FileTree && m_FileTree->isInitialized()) {
+        Mir::Epoch::ReadGuard guard;
         RenderFileNode(m_FileTree->getRootNode());
     } else{
         ImGui::Text("File tree not initialized. Click 'Update File Tree' to load.");
     }
+    RenderDeleteConfirmation();
+    RenderStatusBar();
     ImGui::End();
+    if (m_FileTree) {
+        m_FileTree->enforceMemoryBudget();
+    }
     
-    if (!m_CurrentOpenFile.content.empty() && !m_CurrentOpenFile.path.empty())
+    if (!m_CurrentOpenFile.path.empty())
     {
         RenderOpenFile();
     }
@@ -37,9 +63,10 @@ void FileTreeRenderer::Render(){
 }
 
 void FileTreeRenderer::RenderFileNode(FileNode* _node) {
+    MIR_PROFILE_SCOPE("FileTreeRenderer::RenderFileNode");
     ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_OpenOnDoubleClick;
     
-    if (_node->type == FileType::FILE || _node->type == FileType::UNKNOWN) {
+    if ((_node->type == FileType::FILE && !_node->isArchive) || _node->type == FileType::UNKNOWN) {
         flags |= ImGuiTreeNodeFlags_Leaf;       
         flags |= ImGuiTreeNodeFlags_NoTreePushOnOpen;  
     }
@@ -48,39 +75,194 @@ void FileTreeRenderer::RenderFileNode(FileNode* _node) {
         flags |= ImGuiTreeNodeFlags_DefaultOpen;
     }
     
-    std::string icon;
-    std::string nodeName = std::string(_node->name.begin(), _node->name.end());
-    std::string displayName;
-    
-    if (_node->type == FileType::DIR) {
-        icon = "[DIR] ";
-        displayName = icon + nodeName;
+    // Name is already UTF-8 and the node pointer is the ID, so the label is formatted
+    // straight into ImGui's buffer without building strings every frame
+    bool hasDiffColor = _node->diffStatus != DiffStatus::None && _node->diffStatus != DiffStatus::Unchanged;
+    bool isIgnored = !hasDiffColor && _node->gitStatus == GitStatus::Ignored;
+    if (hasDiffColor) {
+        ImGui::PushStyleColor(ImGuiCol_Text, GetDiffColor(_node->diffStatus));
+    } else if (isIgnored) {
+        ImGui::PushStyleColor(ImGuiCol_Text, ImGui::GetStyle().Colors[ImGuiCol_TextDisabled]);
+    }
+    bool nodeOpen;
+    if (_node->isArchive) {
+        char sizeStr[32];
+        formatFileSize(_node->size, sizeStr, sizeof(sizeStr));
+        nodeOpen = ImGui::TreeNodeEx(_node, flags, "[TAR] %s (%s)", _node->name.c_str(), sizeStr);
     } else if (_node->type == FileType::FILE) {
-        icon = "[FILE] ";
-        std::string sizeStr = formatFileSize(_node->size);
-        displayName = icon + nodeName + " (" + sizeStr + ")";
+        char sizeStr[32];
+        formatFileSize(_node->size, sizeStr, sizeof(sizeStr));
+        nodeOpen = ImGui::TreeNodeEx(_node, flags, "[FILE] %s (%s)", _node->name.c_str(), sizeStr);
+    } else if (_node->type == FileType::DIR) {
+        nodeOpen = ImGui::TreeNodeEx(_node, flags, "[DIR] %s", _node->name.c_str());
+    } else {
+        nodeOpen = ImGui::TreeNodeEx(_node, flags, "%s", _node->name.c_str());
+    }
+    if (hasDiffColor) {
+        ImGui::PopStyleColor();
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("%s", GetDiffLabel(_node->diffStatus));
+        }
+    } else if (isIgnored) {
+        ImGui::PopStyleColor();
+    }
+    if (_node->hasUnexpandedChildren && ImGui::IsItemHovered()) {
+        m_FileTree->prefetch(_node);
     }
-    
-    
-    std::string id = "##" + displayName + std::to_string(reinterpret_cast<uintptr_t>(_node));
-    bool nodeOpen = ImGui::TreeNodeEx((displayName + id).c_str(), flags);
     RenderFileTreeContextMenu(_node);
     HandleDoubleClickNode(_node);
     HandleSingleClickNode(_node);
+    // After everything that asks about the tree item, the marker is an item of its own
+    if (const char* marker = hasDiffColor ? nullptr : GetGitMarker(_node->gitStatus)) {
+        ImGui::SameLine();
+        ImGui::TextColored(GetGitColor(_node->gitStatus), "%s", marker);
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("%s", GetGitLabel(_node->gitStatus));
+        }
+    }
     
     // Lazy loading: when a directory node is expanded for the first time
-    if (nodeOpen && _node->type == FileType::DIR) {
+    if (nodeOpen && (_node->type == FileType::DIR || _node->isArchive)) {
         if (_node->hasUnexpandedChildren) {
-            m_FileTree->expandNode(_node);
+            m_FileTree->expandNodeAsync(_node);
         }
+        m_FileTree->touch(_node);
         
-        for (const auto& child : _node->children) {
-            RenderFileNode(child.get());
+        RenderChildren(_node);
+        if (_node->isLoading) {
+            ImGui::TextDisabled("Loading... (%zu entries)", m_FileTree->getScannedCount(_node));
+        } else if (_node->hasMoreEntries) {
+            ImGui::PushID(_node);
+            if (ImGui::SmallButton("Load more")) {
+                m_FileTree->loadMore(_node);
+            }
+            ImGui::PopID();
+            ImGui::SameLine();
+            ImGui::TextDisabled("(%zu shown)", _node->readChildren().size());
         }
         ImGui::TreePop();
     }
 }
 
+void FileTreeRenderer::RenderChildren(FileNode* _node) {
+    std::span<FileNode* const> children = _node->readChildren();
+    size_t i = 0;
+    while (i < children.size()) {
+        if (children[i]->type != FileType::FILE || children[i]->isArchive) {
+            RenderFileNode(children[i]);
+            i++;
+            continue;
+        }
+        // Files are single line leaves, so long runs of them can be clipped and a directory
+        // with a million entries costs only the visible rows
+        size_t runEnd = i;
+        while (runEnd < children.size() && children[runEnd]->type == FileType::FILE && !children[runEnd]->isArchive) {
+            runEnd++;
+        }
+        if (runEnd - i < kClipThreshold) {
+            for (; i < runEnd; i++) {
+                RenderFileNode(children[i]);
+            }
+            continue;
+        }
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(runEnd - i));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                RenderFileNode(children[i + row]);
+            }
+        }
+        i = runEnd;
+    }
+}
+
+void FileTreeRenderer::RenderStatusBar() {
+    if (!m_FileTree) {
+        return;
+    }
+    ImGui::Separator();
+    char residentStr[32];
+    formatFileSize(m_FileTree->getResidentBytes(), residentStr, sizeof(residentStr));
+    ImGui::TextDisabled("Resident: %zu nodes (%s), %zu folders evicted",
+        m_FileTree->getResidentNodeCount(), residentStr, m_FileTree->getEvictedCount());
+
+    bool hideIgnored = m_FileTree->isIgnoringRules();
+    if (ImGui::Checkbox("Hide ignored", &hideIgnored)) {
+        m_FileTree->setIgnoreRules(hideIgnored);
+    }
+    if (hideIgnored) {
+        IgnoringFileSystem::Stats ignored = m_FileTree->getIgnoreStats();
+        char skippedStr[32];
+        formatFileSize(ignored.skippedBytes, skippedStr, sizeof(skippedStr));
+        ImGui::SameLine();
+        ImGui::TextDisabled("%zu folders, %zu files (%s) skipped, %zu rules from %zu files",
+            ignored.skippedFolders, ignored.skippedFiles, skippedStr, ignored.rules, ignored.ruleFiles);
+    }
+
+    bool showGit = m_FileTree->isShowingGitStatus();
+    if (ImGui::Checkbox("Git status", &showGit)) {
+        m_FileTree->setGitStatus(showGit);
+    }
+    if (const GitStatusOverlay* git = m_FileTree->getGitStatus()) {
+        ImGui::SameLine();
+        if (git->isOpen()) {
+            GitStatusOverlay::Stats stats = git->getStats();
+            char hashedStr[32];
+            formatFileSize(stats.hashedBytes, hashedStr, sizeof(hashedStr));
+            ImGui::TextDisabled("%zu modified, %zu untracked, %zu deleted, %zu ignored. %zu index entries in %.1f ms, %zu clean by stat, %zu hashed (%s)",
+                stats.modified, stats.untracked, stats.deleted, stats.ignored, stats.indexEntries, stats.indexLoadMs,
+                stats.statMatched, stats.hashed, hashedStr);
+        } else {
+            ImGui::TextDisabled("%s", git->getError().empty() ? "Not available for this folder" : git->getError().c_str());
+        }
+    }
+
+    if (m_diffTask.valid()) {
+        TreeDiff::Stats progress = m_activeDiff->getStats();
+        ImGui::TextDisabled("Comparing... %zu entries scanned", progress.scanned);
+        ImGui::SameLine();
+        if (ImGui::SmallButton("Cancel")) {
+            m_activeDiff->cancel();
+        }
+    } else if (m_showDiffStats) {
+        ImGui::TextDisabled("Diff: %zu added, %zu removed, %zu size, %zu content, %zu time only, %zu unchanged",
+            m_diffStats.added, m_diffStats.removed, m_diffStats.sizeChanged, m_diffStats.contentChanged,
+            m_diffStats.timeChanged, m_diffStats.unchanged);
+    }
+    if (m_operationTask.valid()) {
+        FileOperation::Progress progress = m_activeOperation->getProgress();
+        const char* verb = m_activeOperation->getKind() == FileOperation::Kind::Copy ? "Copying"
+                         : m_activeOperation->getKind() == FileOperation::Kind::Move ? "Moving" : "Deleting";
+        char doneStr[32];
+        char totalStr[32];
+        formatFileSize(progress.doneBytes, doneStr, sizeof(doneStr));
+        formatFileSize(progress.totalBytes, totalStr, sizeof(totalStr));
+        ImGui::TextDisabled("%s... %zu/%zu%s files, %s/%s", verb, progress.doneFiles, progress.totalFiles,
+            progress.listing ? "+" : "", doneStr, totalStr);
+        ImGui::SameLine();
+        if (ImGui::SmallButton("Cancel##operation")) {
+            m_activeOperation->cancel();
+        }
+        // Progress only moves on worker threads, keep frames coming while it runs
+        Mir::Redraw::request();
+    } else if (!m_operationSummary.empty()) {
+        ImGui::TextDisabled("%s", m_operationSummary.c_str());
+    }
+
+    DirectoryPrefetcher::Stats stats = m_FileTree->getPrefetcher().getStats();
+    size_t lookups = stats.hits + stats.misses;
+    char cachedStr[32];
+    formatFileSize(stats.cachedBytes, cachedStr, sizeof(cachedStr));
+    ImGui::TextDisabled("Prefetch: %zu/%zu hits (%.0f%%), %zu wasted, %zu entries (%s) cached",
+        stats.hits, lookups, lookups ? 100.0 * stats.hits / lookups : 0.0, stats.wasted, stats.cachedEntries, cachedStr);
+
+    for (const auto& device : Mir::IoScheduler::shared().getStats()) {
+        ImGui::TextDisabled("Disk %llx: %zu/%zu running, %zu queued, %.3f ms/op avg (best %.3f ms)",
+            static_cast<unsigned long long>(device.device), device.running, device.limit, device.queued,
+            device.latencyMs, device.baselineMs);
+    }
+}
+
 void FileTreeRenderer::RenderOpenFile() 
 {
     ImGui::SetNextWindowSize(ImVec2(800, 600), ImGuiCond_FirstUseEver);
@@ -91,14 +273,52 @@ void FileTreeRenderer::RenderOpenFile()
     
     ImGui::SameLine();
     if (ImGui::Button("Close")) {
-        m_CurrentOpenFile.content.clear();
-        m_CurrentOpenFile.path.clear();
+        CloseOpenFile();
         ImGui::End();
         return;
     }
     
+    if (m_CurrentOpenFile.mode == FileOpenMode::Structured && m_CurrentOpenFile.jsonViewer) {
+        ImGui::SameLine();
+        if (ImGui::Button("Open as text")) {
+            const std::filesystem::path& path = m_CurrentOpenFile.filePath;
+            m_CurrentOpenFile.jsonViewer.reset();
+            m_CurrentOpenFile.mode = FileOpenMode::Text;
+            m_CurrentOpenFile.content = Mir::Utils::File::readFile(path);
+        }
+    }
+    
+    if ((m_CurrentOpenFile.mode == FileOpenMode::Text || m_CurrentOpenFile.mode == FileOpenMode::Code) && !m_CurrentOpenFile.isVirtual) {
+        ImGui::SameLine();
+        bool follow = m_CurrentOpenFile.tail != nullptr;
+        if (ImGui::Checkbox("Follow", &follow)) {
+            SetFollow(follow);
+        }
+    }
+    
     ImGui::Separator();
     
+    if (m_CurrentOpenFile.tail) {
+        RenderFollowView();
+        ImGui::End();
+        return;
+    }
+    if (m_CurrentOpenFile.mode == FileOpenMode::Structured && m_CurrentOpenFile.jsonViewer) {
+        m_CurrentOpenFile.jsonViewer->Render();
+        ImGui::End();
+        return;
+    }
+    if (m_CurrentOpenFile.mode == FileOpenMode::Binary) {
+        RenderHexView();
+        ImGui::End();
+        return;
+    }
+    if (m_CurrentOpenFile.mode == FileOpenMode::Image || m_CurrentOpenFile.mode == FileOpenMode::Unsupported) {
+        ImGui::TextDisabled("No preview available for this file type.");
+        ImGui::End();
+        return;
+    }
+    
     ImVec2 availSize = ImGui::GetContentRegionAvail();
     
     ImGui::InputTextMultiline("##FileContent", 
@@ -109,40 +329,127 @@ void FileTreeRenderer::RenderOpenFile()
         ImGui::End();
 }
 
+void FileTreeRenderer::RenderFollowView() {
+    Mir::Utils::File::TailFile& tail = *m_CurrentOpenFile.tail;
+    tail.poll();
+    char bufferedStr[32];
+    formatFileSize(tail.getBufferedBytes(), bufferedStr, sizeof(bufferedStr));
+    ImGui::TextDisabled("%zu lines (%s)%s, %zu rotated, %zu truncated", tail.getLineCount(), bufferedStr,
+        tail.getDroppedLines() > 0 || tail.isHeadSkipped() ? ", older lines not shown" : "",
+        tail.getRotations(), tail.getTruncations());
+
+    ImGui::BeginChild("##FollowView", ImVec2(0, 0), 0, ImGuiWindowFlags_HorizontalScrollbar);
+    // Scrolled to the end keeps following, scrolling up stops it until the end is reached again
+    bool atBottom = ImGui::GetScrollY() >= ImGui::GetScrollMaxY();
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(tail.getLineCount()));
+    while (clipper.Step()) {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+            std::string_view line = tail.getLine(static_cast<size_t>(row));
+            ImGui::TextUnformatted(line.data(), line.data() + line.size());
+        }
+    }
+    clipper.End();
+    if (atBottom) {
+        ImGui::SetScrollHereY(1.0f);
+    }
+    ImGui::EndChild();
+}
+
+void FileTreeRenderer::RenderHexView() {
+    const std::string& bytes = m_CurrentOpenFile.content;
+    constexpr size_t bytesPerRow = 16;
+    ImGui::TextDisabled("Showing first %zu bytes", bytes.size());
+
+    ImGui::BeginChild("##HexView");
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>((bytes.size() + bytesPerRow - 1) / bytesPerRow));
+    while (clipper.Step()) {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+            char line[16 + bytesPerRow * 3 + 2 + bytesPerRow + 1];
+            size_t offset = static_cast<size_t>(row) * bytesPerRow;
+            size_t count = std::min(bytesPerRow, bytes.size() - offset);
+            int pos = snprintf(line, sizeof(line), "%08zx  ", offset);
+            for (size_t i = 0; i < bytesPerRow; i++) {
+                if (i < count) {
+                    pos += snprintf(line + pos, sizeof(line) - pos, "%02x ", static_cast<unsigned char>(bytes[offset + i]));
+                } else {
+                    pos += snprintf(line + pos, sizeof(line) - pos, "   ");
+                }
+            }
+            line[pos++] = ' ';
+            for (size_t i = 0; i < count; i++) {
+                unsigned char c = static_cast<unsigned char>(bytes[offset + i]);
+                line[pos++] = (c >= 0x20 && c < 0x7F) ? static_cast<char>(c) : '.';
+            }
+            line[pos] = '\0';
+            ImGui::TextUnformatted(line);
+        }
+    }
+    clipper.End();
+    ImGui::EndChild();
+}
+
 void FileTreeRenderer::RenderFileTreeContextMenu(FileNode* _node) {
     if (ImGui::BeginPopupContextItem()) {
         if (ImGui::MenuItem("Copy Path")) {
-            fs::path fullPath = m_FileTree->getRootNode()->fullPath / _node->name;
-            std::string pathStr = fullPath.string();
-          
+            std::string pathStr = Mir::Utils::File::toUtf8(_node->fullPath);
             ImGui::SetClipboardText(pathStr.c_str());
         }
         
         if (_node->type == FileType::FILE && ImGui::MenuItem("Open File")) {
-            fs::path fullPath = m_FileTree->getRootNode()->fullPath / _node->name;
-            std::string pathStr = fullPath.string();
-            m_CurrentOpenFile.content = Mir::Utils::File::readFile(fullPath);
-            m_CurrentOpenFile.path = pathStr;
-
+            OpenFileInViewer(_node);
         }
        if (_node->type == FileType::FILE) {
-            std::string ext = _node->fullPath.extension().string();
-            std::string loweredExt = ext;
-            std::transform(loweredExt.begin(), loweredExt.end(), loweredExt.begin(),
-                          [](unsigned char c) { return std::tolower(c); });
-            
-            if (m_callbackRegistry.count(loweredExt) > 0 && 
-                m_callbackRegistry[loweredExt].count(CallbackType::ContextMenu) > 0) {
-                
-                std::string menuLabel = "Process " + ext.substr(1) + " file"; // Remove the dot
+            const CallbackSlot& slot = GetExtensionSlot(_node, CallbackType::ContextMenu);
+            if (slot.callback) {
+                std::string menuLabel = "Process " + std::string(_node->getExtension().substr(1)) + " file"; // Remove the dot
                 if (ImGui::MenuItem(menuLabel.c_str())) {
-                    m_callbackRegistry[loweredExt][CallbackType::ContextMenu](_node->fullPath.string());
+                    Dispatch(slot, CallbackType::ContextMenu, _node->fullPath);
+                }
+            }
+        }
+        // Diffs and file operations work on the disk, not on archives or other providers
+        bool onDisk = !_node->isVirtual && m_FileTree->getProvider().isNative();
+        if (_node->type == FileType::DIR && onDisk && !m_diffTask.valid()) {
+            // Left side is the clicked folder, e.g. the deployed copy, right side the picked one
+            bool compare = ImGui::MenuItem("Compare with...");
+            bool compareContent = ImGui::MenuItem("Compare contents with...");
+            if (compare || compareContent) {
+                std::filesystem::path other = OpenFolderDialog();
+                if (!other.empty()) {
+                    StartDiff(_node->fullPath, other, compareContent);
                 }
             }
         }
+        if (!onDisk) {
+            // Read only, nothing below applies inside an archive
+            ImGui::EndPopup();
+            return;
+        }
         if (_node->type == FileType::DIR && ImGui::MenuItem("New File"))
         {
-            std::cout << "[Not implemented!]" << "\n";
+            CreateNewFile(_node->fullPath);
+        }
+
+        ImGui::Separator();
+        bool busy = m_operationTask.valid();
+        if (ImGui::MenuItem("Copy", nullptr, false, !busy)) {
+            m_clipboardPaths = {_node->fullPath};
+            m_clipboardCut = false;
+        }
+        if (ImGui::MenuItem("Cut", nullptr, false, !busy)) {
+            m_clipboardPaths = {_node->fullPath};
+            m_clipboardCut = true;
+        }
+        if (_node->type == FileType::DIR && ImGui::MenuItem("Paste", nullptr, false, !busy && !m_clipboardPaths.empty())) {
+            StartFileOperation(m_clipboardCut ? FileOperation::Kind::Move : FileOperation::Kind::Copy, m_clipboardPaths, _node->fullPath);
+            if (m_clipboardCut) {
+                m_clipboardPaths.clear();
+            }
+        }
+        if (_node != m_FileTree->getRootNode() && ImGui::MenuItem("Delete", nullptr, false, !busy)) {
+            m_pendingDelete = {_node->fullPath};
         }
         
         ImGui::EndPopup();
@@ -155,7 +462,7 @@ void FileTreeRenderer::RenderFileTreeContextMenu(FileNode* _node) {
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 // Helpers START
 //--------------------------------------------------------------------------------------------------------------------------------------------------
-std::string FileTreeRenderer::formatFileSize(size_t sizeInBytes) {
+void FileTreeRenderer::formatFileSize(size_t sizeInBytes, char* buffer, size_t bufferSize) {
     const char* units[] = {"B", "KB", "MB", "GB", "TB"};
     int unitIndex = 0;
     double size = static_cast<double>(sizeInBytes);
@@ -165,18 +472,75 @@ std::string FileTreeRenderer::formatFileSize(size_t sizeInBytes) {
         unitIndex++;
     }
     
-    char buffer[32];
     if (unitIndex == 0) {
-        snprintf(buffer, sizeof(buffer), "%zu %s", sizeInBytes, units[unitIndex]);
+        snprintf(buffer, bufferSize, "%zu %s", sizeInBytes, units[unitIndex]);
     } else if (size < 10) {
-        snprintf(buffer, sizeof(buffer), "%.2f %s", size, units[unitIndex]);
+        snprintf(buffer, bufferSize, "%.2f %s", size, units[unitIndex]);
     } else if (size < 100) {
-        snprintf(buffer, sizeof(buffer), "%.1f %s", size, units[unitIndex]);
+        snprintf(buffer, bufferSize, "%.1f %s", size, units[unitIndex]);
     } else {
-        snprintf(buffer, sizeof(buffer), "%.0f %s", size, units[unitIndex]);
+        snprintf(buffer, bufferSize, "%.0f %s", size, units[unitIndex]);
+    }
+
+}
+
+ImVec4 FileTreeRenderer::GetDiffColor(DiffStatus status) {
+    switch (status) {
+        case DiffStatus::Added:           return ImVec4(0.4f, 0.9f, 0.4f, 1.0f);
+        case DiffStatus::Removed:         return ImVec4(0.95f, 0.4f, 0.4f, 1.0f);
+        case DiffStatus::SizeChanged:
+        case DiffStatus::ContentChanged:  return ImVec4(0.95f, 0.8f, 0.3f, 1.0f);
+        case DiffStatus::TimeChanged:     return ImVec4(0.5f, 0.7f, 0.95f, 1.0f);
+        case DiffStatus::ChildrenChanged: return ImVec4(0.9f, 0.6f, 0.3f, 1.0f);
+        default:                          return ImGui::GetStyle().Colors[ImGuiCol_Text];
+    }
+}
+
+const char* FileTreeRenderer::GetDiffLabel(DiffStatus status) {
+    switch (status) {
+        case DiffStatus::Added:           return "Only in right";
+        case DiffStatus::Removed:         return "Only in left";
+        case DiffStatus::SizeChanged:     return "Size differs";
+        case DiffStatus::ContentChanged:  return "Content differs";
+        case DiffStatus::TimeChanged:     return "Modified time differs";
+        case DiffStatus::ChildrenChanged: return "Contains differences";
+        case DiffStatus::Unchanged:       return "Unchanged";
+        default:                          return "";
+    }
+}
+
+const char* FileTreeRenderer::GetGitMarker(GitStatus status) {
+    switch (status) {
+        case GitStatus::Checking:        return "?";
+        case GitStatus::Modified:        return "M";
+        case GitStatus::Untracked:       return "U";
+        case GitStatus::Conflicted:      return "C";
+        case GitStatus::ChildrenChanged: return "*";
+        default:                         return nullptr;
+    }
+}
+
+ImVec4 FileTreeRenderer::GetGitColor(GitStatus status) {
+    switch (status) {
+        case GitStatus::Modified:        return ImVec4(0.95f, 0.8f, 0.3f, 1.0f);
+        case GitStatus::Untracked:       return ImVec4(0.4f, 0.9f, 0.4f, 1.0f);
+        case GitStatus::Conflicted:      return ImVec4(0.95f, 0.4f, 0.4f, 1.0f);
+        case GitStatus::ChildrenChanged: return ImVec4(0.9f, 0.6f, 0.3f, 1.0f);
+        default:                         return ImGui::GetStyle().Colors[ImGuiCol_TextDisabled];
+    }
+}
+
+const char* FileTreeRenderer::GetGitLabel(GitStatus status) {
+    switch (status) {
+        case GitStatus::Checking:        return "Checking against the git index";
+        case GitStatus::Modified:        return "Modified";
+        case GitStatus::Untracked:       return "Untracked";
+        case GitStatus::Ignored:         return "Ignored";
+        case GitStatus::Conflicted:      return "Merge conflict";
+        case GitStatus::ChildrenChanged: return "Contains changes";
+        case GitStatus::Clean:           return "Unmodified";
+        default:                         return "";
     }
-    
-    return buffer;
 }
 
 std::filesystem::path FileTreeRenderer::OpenFileDialog()  {
@@ -199,44 +563,239 @@ std::filesystem::path FileTreeRenderer::OpenFolderDialog() {
 }
 void FileTreeRenderer::HandleDoubleClickNode(FileNode* _node) {
     if (ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left)) {
-        fs::path fullPath = m_FileTree->getRootNode()->fullPath / _node->name;
-        std::string pathStr = fullPath.string();
-
        if (_node->type == FileType::FILE) {
-            TriggerFileCallback(CallbackType::ContextMenu, _node->fullPath.string());
+            TriggerFileCallback(CallbackType::ContextMenu, _node->fullPath);
         } 
         else if (_node->type == FileType::DIR) {
-            TriggerDirectoryCallback(CallbackType::ContextMenu, _node->fullPath.string());
+            TriggerDirectoryCallback(CallbackType::ContextMenu, _node->fullPath);
         }
         
 
         if (_node->type == FileType::FILE) {
-            m_CurrentOpenFile.content = Mir::Utils::File::readFile(fullPath);
-            m_CurrentOpenFile.path = pathStr;
+            if (!_node->isArchive) {
+                OpenFileInViewer(_node);
+            }
 
-            TriggerFileCallback(CallbackType::DoubleClick, pathStr);
-            std::string ext = _node->fullPath.extension().string();
-            TriggerExtensionCallback(ext, CallbackType::DoubleClick, pathStr);
+            TriggerFileCallback(CallbackType::DoubleClick, _node->fullPath);
+            TriggerExtensionCallback(_node, CallbackType::DoubleClick);
         } else if (_node->type == FileType::DIR) {
-            TriggerDirectoryCallback(CallbackType::DoubleClick, pathStr);
+            TriggerDirectoryCallback(CallbackType::DoubleClick, _node->fullPath);
         }
     }
 }
 
 void FileTreeRenderer::HandleSingleClickNode(FileNode* _node) {
     if (ImGui::IsItemClicked() && !ImGui::IsItemToggledOpen()) {
-        auto path = _node->fullPath.string();
+        const auto& path = _node->fullPath;
         if (_node->type == FileType::FILE) {
             TriggerFileCallback(CallbackType::Click, path);
-            
-            std::string ext = _node->fullPath.extension().string();
-            TriggerExtensionCallback(ext, CallbackType::Click, path);
+            TriggerExtensionCallback(_node, CallbackType::Click);
         }
         else if (_node->type == FileType::DIR) {
             TriggerDirectoryCallback(CallbackType::Click, path);
         }
     }
 }
+
+void FileTreeRenderer::OpenFileInViewer(FileNode* _node) {
+    CloseOpenFile();
+    m_CurrentOpenFile.path = Mir::Utils::File::toUtf8(_node->fullPath);
+    m_CurrentOpenFile.filePath = _node->fullPath;
+    if (_node->isVirtual || !m_FileTree->getProvider().isNative()) {
+        OpenDetachedFile(_node);
+        return;
+    }
+    // The user is waiting on this one, prefetching on the same disk holds off until it is read
+    Mir::IoScheduler::Foreground foreground(_node->fullPath);
+    m_CurrentOpenFile.mode = m_contentSniffer.detect(*_node);
+
+    if (m_CurrentOpenFile.mode == FileOpenMode::Structured) {
+        // Structured view maps the file itself, no need to read it into memory
+        m_CurrentOpenFile.jsonViewer = std::make_unique<JsonViewer>();
+        if (m_CurrentOpenFile.jsonViewer->Open(_node->fullPath)) {
+            return;
+        }
+        std::cout << "[FileTreeRenderer::OpenFileInViewer] " << m_CurrentOpenFile.jsonViewer->GetError() << "\n";
+        m_CurrentOpenFile.jsonViewer.reset();
+        m_CurrentOpenFile.mode = FileOpenMode::Text;
+    }
+
+    if (m_CurrentOpenFile.mode == FileOpenMode::Binary) {
+        // Never pull a whole binary into memory, the hex view only shows the head
+        std::ifstream file(_node->fullPath, std::ios::binary);
+        m_CurrentOpenFile.content.resize(kHexViewBytes);
+        file.read(m_CurrentOpenFile.content.data(), kHexViewBytes);
+        m_CurrentOpenFile.content.resize(static_cast<size_t>(file.gcount()));
+        return;
+    }
+    if (m_CurrentOpenFile.mode == FileOpenMode::Text || m_CurrentOpenFile.mode == FileOpenMode::Code) {
+        // Logs are what the preview is mostly used for, they open following
+        if (_node->getExtension() == ".log") {
+            SetFollow(true);
+            return;
+        }
+        m_CurrentOpenFile.content = Mir::Utils::File::readFile(_node->fullPath);
+    }
+}
+
+void FileTreeRenderer::OpenDetachedFile(FileNode* _node) {
+    // Straight from the archive mapping (the member is never extracted) or from the provider
+    m_CurrentOpenFile.isVirtual = true;
+    std::string owned;
+    std::string_view data;
+    if (_node->isVirtual) {
+        data = m_FileTree->readArchiveMember(_node->fullPath);
+    } else if (m_FileTree->getProvider().readFile(_node->fullPath, owned)) {
+        data = owned;
+    }
+    m_CurrentOpenFile.mode = ContentSniffer::detect(data.substr(0, ContentSniffer::kSniffSize), _node->fullPath);
+    if (m_CurrentOpenFile.mode == FileOpenMode::Structured) {
+        m_CurrentOpenFile.mode = FileOpenMode::Text; // the structured viewer maps files by path
+    }
+    if (m_CurrentOpenFile.mode == FileOpenMode::Binary) {
+        data = data.substr(0, kHexViewBytes);
+    }
+    if (m_CurrentOpenFile.mode != FileOpenMode::Image && m_CurrentOpenFile.mode != FileOpenMode::Unsupported) {
+        m_CurrentOpenFile.content.assign(data);
+    }
+}
+
+void FileTreeRenderer::SetFollow(bool follow) {
+    if (!follow) {
+        m_CurrentOpenFile.tail.reset();
+        m_CurrentOpenFile.content = Mir::Utils::File::readFile(m_CurrentOpenFile.filePath);
+        return;
+    }
+    auto tail = std::make_unique<Mir::Utils::File::TailFile>();
+    if (!tail->open(m_CurrentOpenFile.filePath)) {
+        std::cout << "[FileTreeRenderer::SetFollow] Could not open " << m_CurrentOpenFile.path << "\n";
+        return;
+    }
+    // Only the watcher wakes an idle UI, new lines are read on the render thread
+    tail->watch([]() { Mir::Redraw::request(); });
+    m_CurrentOpenFile.tail = std::move(tail);
+    m_CurrentOpenFile.content.clear();
+    m_CurrentOpenFile.content.shrink_to_fit();
+}
+
+void FileTreeRenderer::StartDiff(const std::filesystem::path& left, const std::filesystem::path& right, bool compareContent) {
+    TreeDiff::Options options;
+    options.compareContent = compareContent;
+    m_activeDiff = std::make_shared<TreeDiff>(options);
+    m_showDiffStats = false;
+    m_diffTask = std::async(std::launch::async, [diff = m_activeDiff, left, right]() {
+        auto root = diff->compare(left, right);
+        Mir::Redraw::request();
+        return root;
+    });
+}
+
+void FileTreeRenderer::PollDiff() {
+    if (!m_diffTask.valid() || m_diffTask.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
+    }
+    // Cancelled, the tree that was shown before stays
+    if (std::unique_ptr<FileNode> root = m_diffTask.get()) {
+        m_FileTree->setRootNode(std::move(root));
+        m_diffStats = m_activeDiff->getStats();
+        m_showDiffStats = true;
+    }
+    m_activeDiff.reset();
+}
+
+void FileTreeRenderer::StartFileOperation(FileOperation::Kind kind, std::vector<std::filesystem::path> sources, const std::filesystem::path& destination) {
+    m_activeOperation = std::make_shared<FileOperation>(kind, std::move(sources), destination);
+    m_operationSummary.clear();
+    m_operationTask = std::async(std::launch::async, [operation = m_activeOperation]() {
+        bool ok = operation->run();
+        Mir::Redraw::request();
+        return ok;
+    });
+}
+
+void FileTreeRenderer::PollFileOperation() {
+    // Runs before the tree is drawn, nodes must not change while RenderChildren walks them
+    for (const auto& path : m_pendingInserts) {
+        m_FileTree->insertPath(path);
+    }
+    m_pendingInserts.clear();
+
+    if (!m_operationTask.valid() || m_operationTask.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
+    }
+    bool ok = m_operationTask.get();
+    for (const auto& path : m_activeOperation->getRemoved()) {
+        if (path == m_CurrentOpenFile.filePath) {
+            CloseOpenFile();
+        }
+        m_FileTree->removePath(path);
+    }
+    for (const auto& path : m_activeOperation->getCreated()) {
+        m_FileTree->insertPath(path);
+    }
+
+    FileOperation::Progress progress = m_activeOperation->getProgress();
+    char sizeStr[32];
+    formatFileSize(progress.doneBytes, sizeStr, sizeof(sizeStr));
+    m_operationSummary = std::to_string(progress.doneFiles) + " files (" + sizeStr + ")";
+    if (progress.clonedFiles > 0) {
+        m_operationSummary += ", " + std::to_string(progress.clonedFiles) + " cloned";
+    }
+    if (m_activeOperation->isCancelled()) {
+        m_operationSummary += ", cancelled";
+    } else if (!ok) {
+        m_operationSummary += ", " + std::to_string(progress.errors) + " failed";
+        for (const auto& error : m_activeOperation->getErrors()) {
+            std::cout << "[FileTreeRenderer::PollFileOperation] " << error << "\n";
+        }
+    }
+    m_activeOperation.reset();
+}
+
+void FileTreeRenderer::CreateNewFile(const std::filesystem::path& directory) {
+    std::filesystem::path path = FileOperation::uniquePath(directory, "New File.txt");
+    std::ofstream file(path);
+    if (!file) {
+        std::cout << "[FileTreeRenderer::CreateNewFile] Could not create " << Mir::Utils::File::toUtf8(path) << "\n";
+        return;
+    }
+    m_pendingInserts.push_back(path);
+}
+
+void FileTreeRenderer::RenderDeleteConfirmation() {
+    if (!m_pendingDelete.empty() && !ImGui::IsPopupOpen("Delete?")) {
+        ImGui::OpenPopup("Delete?");
+    }
+    if (!ImGui::BeginPopupModal("Delete?", nullptr, ImGuiWindowFlags_AlwaysAutoResize)) {
+        return;
+    }
+    for (const auto& path : m_pendingDelete) {
+        ImGui::TextUnformatted(Mir::Utils::File::toUtf8(path).c_str());
+    }
+    ImGui::TextDisabled("Folders are deleted with everything in them. This cannot be undone.");
+    if (ImGui::Button("Delete") && !m_operationTask.valid()) {
+        StartFileOperation(FileOperation::Kind::Delete, std::move(m_pendingDelete), {});
+        m_pendingDelete.clear();
+        ImGui::CloseCurrentPopup();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Cancel")) {
+        m_pendingDelete.clear();
+        ImGui::CloseCurrentPopup();
+    }
+    ImGui::EndPopup();
+}
+
+void FileTreeRenderer::CloseOpenFile() {
+    m_CurrentOpenFile.content.clear();
+    m_CurrentOpenFile.path.clear();
+    m_CurrentOpenFile.filePath.clear();
+    m_CurrentOpenFile.jsonViewer.reset();
+    m_CurrentOpenFile.tail.reset();
+    m_CurrentOpenFile.isVirtual = false;
+    m_CurrentOpenFile.mode = FileOpenMode::Text;
+}
+
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 // Helpers END
 //--------------------------------------------------------------------------------------------------------------------------------------------------
@@ -244,45 +803,110 @@ void FileTreeRenderer::HandleSingleClickNode(FileNode* _node) {
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 // Callback START
 //--------------------------------------------------------------------------------------------------------------------------------------------------
-void FileTreeRenderer::RegisterFileCallback(CallbackType type, NodeCallback callback) {
-        m_fileCallbacks[type] = callback;
+void FileTreeRenderer::RegisterFileCallback(CallbackType type, NodeCallback callback, CallbackExecution execution) {
+        m_fileCallbacks[static_cast<size_t>(type)] = CallbackSlot{std::move(callback), execution};
 }
 
-void FileTreeRenderer::RegisterDirectoryCallback(CallbackType type, NodeCallback callback) {
-        m_dirCallbacks[type] = callback;
+void FileTreeRenderer::RegisterDirectoryCallback(CallbackType type, NodeCallback callback, CallbackExecution execution) {
+        m_dirCallbacks[static_cast<size_t>(type)] = CallbackSlot{std::move(callback), execution};
 }
 
 void FileTreeRenderer::RegisterExtensionCallback(const std::string& extension, CallbackType type,
-                                                 NodeCallback callback) {
-        std::string ext = extension;
-        std::transform(ext.begin(), ext.end(), ext.begin(),
-                      [](unsigned char c) { return std::tolower(c); });
-        m_callbackRegistry[ext][type] = callback;
+                                                 NodeCallback callback, CallbackExecution execution) {
+        uint32_t id = InternExtension(Mir::Utils::Text::toLowerCase(extension));
+        m_extensionCallbacks[id][static_cast<size_t>(type)] = CallbackSlot{std::move(callback), execution};
 }
 
-void FileTreeRenderer::TriggerFileCallback(CallbackType type, const std::filesystem::path& path) {
-        if (m_fileCallbacks.count(type) > 0) {
-            m_fileCallbacks[type](path);
+uint32_t FileTreeRenderer::InternExtension(const std::string& extension) {
+        auto [it, inserted] = m_extensionIds.try_emplace(extension, static_cast<uint32_t>(m_extensionCallbacks.size()));
+        if (inserted) {
+            m_extensionCallbacks.emplace_back();
         }
+        return it->second;
 }
 
-void FileTreeRenderer::TriggerDirectoryCallback(CallbackType type, const std::filesystem::path& path) {
-        if (m_dirCallbacks.count(type) > 0) {
-            m_dirCallbacks[type](path);
+uint32_t FileTreeRenderer::ResolveExtension(FileNode* _node) {
+        // Every extension seen gets an id, so registering later still reaches already resolved nodes
+        if (_node->extensionId == kUnresolvedExtension) {
+            _node->extensionId = InternExtension(Mir::Utils::Text::toLowerCase(std::string(_node->getExtension())));
         }
+        return _node->extensionId;
 }
 
-void FileTreeRenderer::TriggerExtensionCallback(const std::string& extension, CallbackType type,
-                                                const std::filesystem::path& path) {
-        std::string ext = extension;
-        std::transform(ext.begin(), ext.end(), ext.begin(),
-                      [](unsigned char c) { return std::tolower(c); });
-                      
-        if (m_callbackRegistry.count(ext) > 0 && m_callbackRegistry[ext].count(type) > 0) {
-            m_callbackRegistry[ext][type](path);
+const FileTreeRenderer::CallbackSlot& FileTreeRenderer::GetExtensionSlot(FileNode* _node, CallbackType type) {
+        return m_extensionCallbacks[ResolveExtension(_node)][static_cast<size_t>(type)];
+}
+
+void FileTreeRenderer::Dispatch(const CallbackSlot& slot, CallbackType type, const std::filesystem::path& path) {
+        if (!slot.callback) {
+            return;
+        }
+        if (slot.execution == CallbackExecution::Inline) {
+            slot.callback(path);
+            return;
+        }
+
+        if (!m_callbackPool) {
+            m_callbackPool = std::make_unique<Mir::ThreadPool>(m_callbackWorkers, m_callbackQueueLimit);
+        }
+        // Copy of the callback so re-registering while it runs is safe
+        bool queued = m_callbackPool->trySubmit([this, callback = slot.callback, type, path]() {
+            CallbackResult result{type, path, true, {}};
+            auto start = std::chrono::steady_clock::now();
+            try {
+                callback(path);
+            } catch (const std::exception& e) {
+                result.succeeded = false;
+                result.error = e.what();
+            } catch (...) {
+                result.succeeded = false;
+                result.error = "unknown exception";
+            }
+            result.duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+            {
+                std::lock_guard lock(m_callbackResultMutex);
+                m_callbackResults.push_back(std::move(result));
+            }
+            Mir::Redraw::request();
+        });
+
+        if (!queued) {
+            std::lock_guard lock(m_callbackResultMutex);
+            m_callbackResults.push_back(CallbackResult{type, path, false, "callback queue full, dropped"});
+        }
+}
+
+void FileTreeRenderer::DrainCallbackResults() {
+        std::vector<CallbackResult> results;
+        {
+            std::lock_guard lock(m_callbackResultMutex);
+            if (m_callbackResults.empty()) {
+                return;
+            }
+            results.swap(m_callbackResults);
+        }
+        for (const auto& result : results) {
+            if (m_callbackResultHandler) {
+                m_callbackResultHandler(result);
+            } else if (!result.succeeded) {
+                std::cout << "[FileTreeRenderer::Callback] " << Mir::Utils::File::toUtf8(result.path) << " failed: " << result.error << "\n";
+            }
         }
 }
 
+void FileTreeRenderer::TriggerFileCallback(CallbackType type, const std::filesystem::path& path) {
+        Dispatch(m_fileCallbacks[static_cast<size_t>(type)], type, path);
+}
+
+void FileTreeRenderer::TriggerDirectoryCallback(CallbackType type, const std::filesystem::path& path) {
+        Dispatch(m_dirCallbacks[static_cast<size_t>(type)], type, path);
+}
+
+void FileTreeRenderer::TriggerExtensionCallback(FileNode* _node, CallbackType type) {
+        Dispatch(GetExtensionSlot(_node, type), type, _node->fullPath);
+}
+
 
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 // Callback END
@@ -1,23 +1,26 @@
 #pragma once
 #include "FileTree.h"
 #include "IFileDialogManager.h"
+#include "JsonViewer.h"
+#include "ContentSniffer.h"
+#include "TreeDiff.h"
+#include "FileOperation.h"
+#include "imgui.h"
+#include "utils/ThreadPool.h"
+#include "utils/TailFile.h"
+#include <array>
+#include <chrono>
 #include <functional>
-#include <map>
-enum class FileOpenMode {
-    Text,           // Plain text editor
-    Binary,         // Hex/binary viewer
-    Image,          // Image viewer
-    Code,           // Syntax-highlighted code editor
-    Structured,     // JSON, XML, YAML viewer with formatting
-    Unsupported     // Cannot be opened
-};
+#include <future>
+#include <mutex>
+#include <unordered_map>
 
 class FileTreeRenderer
 {
     public:
     void Render();
     FileTreeRenderer(const std::shared_ptr<FileTree>& _fileTree);
-    ~FileTreeRenderer() {}      
+    ~FileTreeRenderer();
     enum class CallbackType {
         Click,
         DoubleClick,
@@ -27,17 +30,50 @@ class FileTreeRenderer
     private:
     std::shared_ptr<FileTree> m_FileTree;
     std::unique_ptr<Mir::IFileDialogManager> m_fileDialog;
+    ContentSniffer m_contentSniffer;
+    static constexpr size_t kHexViewBytes = 64 * 1024;
+    static constexpr size_t kClipThreshold = 64; // file runs longer than this use a list clipper
     struct OpenFile{
         std::string content;
-        std::string path;
+        std::string path; // UTF-8, used as window title
+        std::filesystem::path filePath;
+        FileOpenMode mode = FileOpenMode::Text;
+        std::unique_ptr<JsonViewer> jsonViewer;
+        std::unique_ptr<Mir::Utils::File::TailFile> tail; // follow mode, replaces content while set
+        bool isVirtual = false; // member of an archive or of a non-disk provider, filePath is not on disk
     }m_CurrentOpenFile;
+
+    // Tree diff runs on its own thread, the result replaces the shown tree when ready
+    std::shared_ptr<TreeDiff> m_activeDiff;
+    std::future<std::unique_ptr<FileNode>> m_diffTask;
+    TreeDiff::Stats m_diffStats;
+    bool m_showDiffStats = false;
+
+    // Copy/move/delete run the same way, the tree is patched when the operation finishes
+    std::shared_ptr<FileOperation> m_activeOperation;
+    std::future<bool> m_operationTask;
+    std::string m_operationSummary;
+    std::vector<std::filesystem::path> m_clipboardPaths;
+    bool m_clipboardCut = false;
+    std::vector<std::filesystem::path> m_pendingDelete;     // waiting for the confirmation dialog
+    std::vector<std::filesystem::path> m_pendingInserts;    // applied before the next frame's tree walk
     
 private:
     void RenderOpenFile();
+    void RenderHexView();
+    void RenderFollowView();
     void RenderFileNode(FileNode* _fileNode);
+    void RenderChildren(FileNode* _node);
+    void RenderStatusBar();
     void RenderFileTreeContextMenu(FileNode* _node);
     
-    std::string formatFileSize(size_t sizeInBytes);
+    void formatFileSize(size_t sizeInBytes, char* buffer, size_t bufferSize);
+    static ImVec4 GetDiffColor(DiffStatus status);
+    static const char* GetDiffLabel(DiffStatus status);
+    // Letter after the name, nullptr for statuses without one
+    static const char* GetGitMarker(GitStatus status);
+    static ImVec4 GetGitColor(GitStatus status);
+    static const char* GetGitLabel(GitStatus status);
     
     std::filesystem::path OpenFileDialog();
     std::filesystem::path OpenFolderDialog();
@@ -45,19 +81,77 @@ private:
     void HandleMappingCsvFile();
     void HandleDoubleClickNode(FileNode* _node);
     void HandleSingleClickNode(FileNode* _node);
+    void OpenFileInViewer(FileNode* _node);
+    void OpenDetachedFile(FileNode* _node);
+    void CloseOpenFile();
+    void SetFollow(bool follow);
+    void StartDiff(const std::filesystem::path& left, const std::filesystem::path& right, bool compareContent);
+    void PollDiff();
+    void StartFileOperation(FileOperation::Kind kind, std::vector<std::filesystem::path> sources, const std::filesystem::path& destination);
+    void PollFileOperation();
+    void CreateNewFile(const std::filesystem::path& directory);
+    void RenderDeleteConfirmation();
 
-private: 
+public:
     using NodeCallback = std::function<void(const std::filesystem::path& path)>;
-    std::map<std::string, std::map<CallbackType, NodeCallback>> m_callbackRegistry;
-    
-    std::map<CallbackType, NodeCallback> m_fileCallbacks;
-    std::map<CallbackType, NodeCallback> m_dirCallbacks;
+
+    // Inline runs on the render thread, Async hands the callback to a worker pool
+    enum class CallbackExecution {
+        Inline,
+        Async
+    };
+
+    // Reported back on the render thread for callbacks that ran async
+    struct CallbackResult {
+        CallbackType type;
+        std::filesystem::path path;
+        bool succeeded = true;
+        std::string error;
+        std::chrono::microseconds duration{0};
+    };
+    using CallbackResultHandler = std::function<void(const CallbackResult& result)>;
+
+private: 
+    static constexpr size_t kCallbackTypeCount = 3;
+    static constexpr uint32_t kUnresolvedExtension = 0;
+
+    struct CallbackSlot {
+        NodeCallback callback;
+        CallbackExecution execution = CallbackExecution::Inline;
+    };
+    using CallbackRow = std::array<CallbackSlot, kCallbackTypeCount>;
+
+    // Extensions are interned once, nodes cache their id so dispatch is a vector index
+    std::unordered_map<std::string, uint32_t> m_extensionIds;
+    std::vector<CallbackRow> m_extensionCallbacks{CallbackRow{}};
+    CallbackRow m_fileCallbacks;
+    CallbackRow m_dirCallbacks;
+
+    std::mutex m_callbackResultMutex;
+    std::vector<CallbackResult> m_callbackResults;
+    CallbackResultHandler m_callbackResultHandler;
+    // Created at the first async dispatch. Declared after the result queue so the queue outlives
+    // the workers, which still push results while the pool drains on destruction.
+    std::unique_ptr<Mir::ThreadPool> m_callbackPool;
+    size_t m_callbackWorkers = 2;
+    size_t m_callbackQueueLimit = 64;
+
+    uint32_t InternExtension(const std::string& extension);
+    uint32_t ResolveExtension(FileNode* _node);
+    const CallbackSlot& GetExtensionSlot(FileNode* _node, CallbackType type);
+    void Dispatch(const CallbackSlot& slot, CallbackType type, const std::filesystem::path& path);
+    void DrainCallbackResults();
+
     void TriggerFileCallback(CallbackType type, const std::filesystem::path& path); 
     void TriggerDirectoryCallback(CallbackType type, const std::filesystem::path& path); 
-    void TriggerExtensionCallback(const std::string& extension, CallbackType type, const std::filesystem::path& path); 
+    void TriggerExtensionCallback(FileNode* _node, CallbackType type); 
 public:    
-    void RegisterFileCallback(CallbackType type, NodeCallback callback); 
-    void RegisterDirectoryCallback(CallbackType type, NodeCallback callback); 
-    void RegisterExtensionCallback(const std::string& extension, CallbackType type, NodeCallback callback); 
+    void RegisterFileCallback(CallbackType type, NodeCallback callback, CallbackExecution execution = CallbackExecution::Inline); 
+    void RegisterDirectoryCallback(CallbackType type, NodeCallback callback, CallbackExecution execution = CallbackExecution::Inline); 
+    void RegisterExtensionCallback(const std::string& extension, CallbackType type, NodeCallback callback,
+                                   CallbackExecution execution = CallbackExecution::Inline); 
+    void RegisterCallbackResultHandler(CallbackResultHandler handler) { m_callbackResultHandler = std::move(handler); }
+    // Only takes effect before the first async callback is dispatched, that creates the pool
+    void SetCallbackPoolSize(size_t workers, size_t queueLimit) { m_callbackWorkers = workers; m_callbackQueueLimit = queueLimit; }
 
 };
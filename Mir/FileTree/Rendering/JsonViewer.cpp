@@ -0,0 +1,94 @@
+#include "JsonViewer.h"
+#include "imgui.h"
+#include <cstdio>
+
+namespace {
+    const char* kindLabel(JsonKind kind) {
+        switch (kind) {
+            case JsonKind::Object: return "{}";
+            case JsonKind::Array: return "[]";
+            case JsonKind::String: return "string";
+            case JsonKind::Number: return "number";
+            case JsonKind::Bool: return "bool";
+            case JsonKind::Null: return "null";
+            default: return "error";
+        }
+    }
+}
+
+bool JsonViewer::Open(const std::filesystem::path& _path) {
+    return m_document.open(_path);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Rendering START
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+void JsonViewer::Render() {
+    JsonNode* root = m_document.getRoot();
+    if (!root) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", m_document.getError().c_str());
+        return;
+    }
+
+    ImGui::TextDisabled("%zu bytes, %zu indexed containers, %zu nodes loaded",
+        m_document.getByteSize(), m_document.getIndexedContainerCount(), m_document.getMaterializedNodeCount());
+    ImGui::Separator();
+    RenderJsonNode(root);
+}
+
+void JsonViewer::RenderJsonNode(JsonNode* _node) {
+    ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_OpenOnDoubleClick;
+    if (!_node->isContainer()) {
+        flags |= ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen;
+    }
+    if (_node == m_document.getRoot()) {
+        flags |= ImGuiTreeNodeFlags_DefaultOpen;
+    }
+
+    // Formatting straight into ImGui's buffer, no per frame string building
+    const std::string_view key = _node->displayKey.empty() ? _node->key : std::string_view(_node->displayKey);
+    bool nodeOpen = false;
+    if (_node->isContainer()) {
+        if (key.empty()) {
+            nodeOpen = ImGui::TreeNodeEx(_node, flags, "[%zu] %s (%zu bytes)", _node->index, kindLabel(_node->kind), _node->value.size());
+        } else {
+            nodeOpen = ImGui::TreeNodeEx(_node, flags, "%.*s %s (%zu bytes)", static_cast<int>(key.size()), key.data(),
+                kindLabel(_node->kind), _node->value.size());
+        }
+    } else if (key.empty()) {
+        ImGui::TreeNodeEx(_node, flags, "[%zu] %s", _node->index, _node->preview.c_str());
+    } else {
+        ImGui::TreeNodeEx(_node, flags, "%.*s: %s", static_cast<int>(key.size()), key.data(), _node->preview.c_str());
+    }
+    if (!_node->isContainer() && ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("%s", kindLabel(_node->kind));
+    }
+
+    if (nodeOpen) {
+        // Lazy loading: parse the first page when opened for the first time
+        if (!_node->expanded) {
+            m_document.expandNode(_node);
+        }
+        for (const auto& child : _node->children) {
+            RenderJsonNode(child.get());
+        }
+        RenderLoadMore(_node);
+        ImGui::TreePop();
+    }
+}
+
+void JsonViewer::RenderLoadMore(JsonNode* _node) {
+    if (!_node->hasMoreChildren()) {
+        return;
+    }
+    ImGui::PushID(_node);
+    char label[64];
+    snprintf(label, sizeof(label), "Load more (%zu shown)", _node->children.size());
+    if (ImGui::SmallButton(label)) {
+        m_document.expandNode(_node);
+    }
+    ImGui::PopID();
+}
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Rendering END
+//--------------------------------------------------------------------------------------------------------------------------------------------------
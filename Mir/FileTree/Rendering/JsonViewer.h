@@ -0,0 +1,25 @@
+#pragma once
+#include "Structured/JsonDocument.h"
+#include <filesystem>
+#include <memory>
+
+// Collapsible tree view over a JsonDocument. Children are parsed when a node is opened
+// and large containers are shown in pages.
+class JsonViewer
+{
+public:
+    JsonViewer() = default;
+    ~JsonViewer() {}
+
+    bool Open(const std::filesystem::path& _path);
+    void Render();
+
+    bool IsLoaded() const { return m_document.getRoot() != nullptr; }
+    const std::string& GetError() const { return m_document.getError(); }
+
+private:
+    JsonDocument m_document;
+
+    void RenderJsonNode(JsonNode* _node);
+    void RenderLoadMore(JsonNode* _node);
+};
@@ -0,0 +1,406 @@
+#include "JsonDocument.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIR_JSON_SSE2 1
+#endif
+
+namespace {
+    // '"' '{' '}' '[' ']' are the only bytes the index pass has to stop at
+    constexpr auto makeStructuralTable() {
+        std::array<bool, 256> table{};
+        table['"'] = table['{'] = table['}'] = table['['] = table[']'] = true;
+        return table;
+    }
+    constexpr auto kStructural = makeStructuralTable();
+
+    bool isWhitespace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    void appendUtf8(std::string& out, uint32_t cp) {
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    bool parseHex4(std::string_view raw, size_t pos, uint32_t& out) {
+        if (pos + 4 > raw.size()) return false;
+        out = 0;
+        for (size_t i = pos; i < pos + 4; i++) {
+            char c = raw[i];
+            out <<= 4;
+            if (c >= '0' && c <= '9') out |= c - '0';
+            else if (c >= 'a' && c <= 'f') out |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') out |= c - 'A' + 10;
+            else return false;
+        }
+        return true;
+    }
+}
+
+bool JsonDocument::open(const std::filesystem::path& filepath) {
+    if (!m_file.open(filepath)) {
+        m_error = "Failed to map file: " + filepath.string();
+        return false;
+    }
+    return load(m_file.view());
+}
+
+bool JsonDocument::load(std::string_view text) {
+    m_text = text;
+    m_containerStarts.clear();
+    m_containerEnds.clear();
+    m_root.reset();
+    m_error.clear();
+    m_materializedNodes = 0;
+
+    if (!buildIndex()) {
+        return false;
+    }
+
+    m_root = std::make_unique<JsonNode>();
+    size_t pos = skipWhitespace(0);
+    if (pos >= m_text.size()) {
+        m_error = "Document is empty";
+        m_root.reset();
+        return false;
+    }
+    if (!parseValue(pos, *m_root)) {
+        m_root.reset();
+        return false;
+    }
+    pos = skipWhitespace(pos);
+    if (pos < m_text.size()) {
+        m_error = "Unexpected '" + std::string(1, m_text[pos]) + "' after the root value at offset " + std::to_string(pos);
+        m_root.reset();
+        return false;
+    }
+    m_materializedNodes = 1;
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Index START
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+size_t JsonDocument::findStructural(size_t pos) const {
+    const char* data = m_text.data();
+    const size_t size = m_text.size();
+#ifdef MIR_JSON_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i openObj = _mm_set1_epi8('{');
+    const __m128i closeObj = _mm_set1_epi8('}');
+    const __m128i openArr = _mm_set1_epi8('[');
+    const __m128i closeArr = _mm_set1_epi8(']');
+    while (pos + 16 <= size) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        __m128i hits = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, openObj)),
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, closeObj), _mm_cmpeq_epi8(chunk, openArr)),
+                         _mm_cmpeq_epi8(chunk, closeArr)));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+        if (mask != 0) {
+            return pos + std::countr_zero(mask);
+        }
+        pos += 16;
+    }
+#endif
+    while (pos < size && !kStructural[static_cast<unsigned char>(data[pos])]) {
+        pos++;
+    }
+    return pos;
+}
+
+// pos points at the opening quote, returns the position after the closing quote
+size_t JsonDocument::skipString(size_t pos) const {
+    const char* data = m_text.data();
+    const size_t size = m_text.size();
+    pos++;
+    while (pos < size) {
+        const void* found = std::memchr(data + pos, '"', size - pos);
+        if (!found) {
+            return size;
+        }
+        size_t quotePos = static_cast<const char*>(found) - data;
+        size_t backslashes = 0;
+        while (quotePos - backslashes > pos && data[quotePos - backslashes - 1] == '\\') {
+            backslashes++;
+        }
+        if (backslashes % 2 == 0) {
+            return quotePos + 1;
+        }
+        pos = quotePos + 1;
+    }
+    return size;
+}
+
+size_t JsonDocument::skipWhitespace(size_t pos) const {
+    while (pos < m_text.size() && isWhitespace(m_text[pos])) {
+        pos++;
+    }
+    return pos;
+}
+
+bool JsonDocument::buildIndex() {
+    std::vector<uint64_t> stack;
+    std::vector<std::pair<uint64_t, uint64_t>> spans;
+    const size_t size = m_text.size();
+    size_t pos = 0;
+
+    while ((pos = findStructural(pos)) < size) {
+        char c = m_text[pos];
+        if (c == '"') {
+            pos = skipString(pos);
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            stack.push_back(pos);
+        } else {
+            if (stack.empty()) {
+                m_error = "Unexpected '" + std::string(1, c) + "' at offset " + std::to_string(pos);
+                return false;
+            }
+            uint64_t start = stack.back();
+            stack.pop_back();
+            if ((m_text[start] == '{') != (c == '}')) {
+                m_error = "Mismatched bracket at offset " + std::to_string(pos);
+                return false;
+            }
+            if (pos - start >= kIndexThreshold) {
+                spans.emplace_back(start, pos);
+            }
+        }
+        pos++;
+    }
+
+    if (!stack.empty()) {
+        m_error = "Unterminated container starting at offset " + std::to_string(stack.back());
+        return false;
+    }
+
+    // Spans are recorded in closing order, lookups want them by start
+    std::sort(spans.begin(), spans.end());
+    m_containerStarts.reserve(spans.size());
+    m_containerEnds.reserve(spans.size());
+    for (const auto& [start, end] : spans) {
+        m_containerStarts.push_back(start);
+        m_containerEnds.push_back(end);
+    }
+    return true;
+}
+
+// start points at '{' or '[', returns the position of the matching close bracket
+size_t JsonDocument::findContainerEnd(size_t start) const {
+    auto it = std::lower_bound(m_containerStarts.begin(), m_containerStarts.end(), start);
+    if (it != m_containerStarts.end() && *it == start) {
+        return m_containerEnds[it - m_containerStarts.begin()];
+    }
+
+    // Not indexed so it is small, just scan it
+    size_t depth = 0;
+    size_t pos = start;
+    while ((pos = findStructural(pos)) < m_text.size()) {
+        char c = m_text[pos];
+        if (c == '"') {
+            pos = skipString(pos);
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            depth++;
+        } else if (--depth == 0) {
+            return pos;
+        }
+        pos++;
+    }
+    return m_text.size();
+}
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Index END
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Parsing START
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+bool JsonDocument::parseValue(size_t& pos, JsonNode& node) {
+    const size_t size = m_text.size();
+    if (pos >= size) {
+        m_error = "Unexpected end of document";
+        return false;
+    }
+
+    char c = m_text[pos];
+    if (c == '{' || c == '[') {
+        size_t end = findContainerEnd(pos);
+        if (end >= size) {
+            m_error = "Unterminated container at offset " + std::to_string(pos);
+            return false;
+        }
+        node.kind = c == '{' ? JsonKind::Object : JsonKind::Array;
+        node.value = m_text.substr(pos, end - pos + 1);
+        node.resumeOffset = pos + 1;
+        pos = end + 1;
+        return true;
+    }
+
+    if (c == '"') {
+        size_t end = skipString(pos);
+        if (end > size || m_text[end - 1] != '"' || end - pos < 2) {
+            m_error = "Unterminated string at offset " + std::to_string(pos);
+            return false;
+        }
+        node.kind = JsonKind::String;
+        node.value = m_text.substr(pos, end - pos);
+        node.preview = unescape(node.value.substr(1, node.value.size() - 2), kPreviewLength);
+        pos = end;
+        return true;
+    }
+
+    size_t end = pos;
+    while (end < size && m_text[end] != ',' && m_text[end] != '}' && m_text[end] != ']' && !isWhitespace(m_text[end])) {
+        end++;
+    }
+    node.value = m_text.substr(pos, end - pos);
+    if (node.value == "true" || node.value == "false") {
+        node.kind = JsonKind::Bool;
+    } else if (node.value == "null") {
+        node.kind = JsonKind::Null;
+    } else if (c == '-' || (c >= '0' && c <= '9')) {
+        node.kind = JsonKind::Number;
+    } else {
+        m_error = "Invalid value at offset " + std::to_string(pos);
+        return false;
+    }
+    node.preview = std::string(node.value.substr(0, kPreviewLength));
+    pos = end;
+    return true;
+}
+
+bool JsonDocument::expandNode(JsonNode* node, size_t maxChildren) {
+    if (!node || !node->isContainer() || !node->hasMoreChildren()) {
+        return false;
+    }
+    node->expanded = true;
+
+    const bool isObject = node->kind == JsonKind::Object;
+    const char closing = isObject ? '}' : ']';
+    const size_t containerEnd = (node->value.data() - m_text.data()) + node->value.size() - 1;
+    size_t pos = node->resumeOffset;
+    size_t added = 0;
+
+    auto fail = [&](const std::string& message) {
+        auto errorNode = std::make_unique<JsonNode>();
+        errorNode->kind = JsonKind::Invalid;
+        errorNode->index = node->children.size();
+        errorNode->preview = message;
+        node->children.push_back(std::move(errorNode));
+        node->resumeOffset = 0;
+        m_materializedNodes++;
+        return false;
+    };
+
+    while (added < maxChildren) {
+        pos = skipWhitespace(pos);
+        if (pos >= containerEnd || m_text[pos] == closing) {
+            node->resumeOffset = 0;
+            return true;
+        }
+        // Every element after the first needs its comma, "[1 2]" is not an array of two
+        if (!node->children.empty()) {
+            if (m_text[pos] != ',') {
+                return fail("Expected ',' or '" + std::string(1, closing) + "' at offset " + std::to_string(pos));
+            }
+            pos = skipWhitespace(pos + 1);
+        }
+
+        auto child = std::make_unique<JsonNode>();
+        child->index = node->children.size();
+
+        if (isObject) {
+            if (m_text[pos] != '"') {
+                return fail("Expected key at offset " + std::to_string(pos));
+            }
+            size_t keyEnd = skipString(pos);
+            child->key = m_text.substr(pos + 1, keyEnd - pos - 2);
+            if (child->key.find('\\') != std::string_view::npos) {
+                child->displayKey = unescape(child->key, kPreviewLength);
+            }
+            pos = skipWhitespace(keyEnd);
+            if (pos >= containerEnd || m_text[pos] != ':') {
+                return fail("Expected ':' at offset " + std::to_string(pos));
+            }
+            pos = skipWhitespace(pos + 1);
+        }
+
+        if (!parseValue(pos, *child)) {
+            return fail(m_error);
+        }
+        node->children.push_back(std::move(child));
+        m_materializedNodes++;
+        added++;
+    }
+
+    node->resumeOffset = pos;
+    return true;
+}
+
+std::string JsonDocument::unescape(std::string_view raw, size_t maxLength) {
+    std::string out;
+    out.reserve(std::min(raw.size(), maxLength));
+    size_t i = 0;
+    for (; i < raw.size() && out.size() < maxLength; i++) {
+        char c = raw[i];
+        if (c != '\\' || i + 1 >= raw.size()) {
+            out += c;
+            continue;
+        }
+        char esc = raw[++i];
+        switch (esc) {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u': {
+                uint32_t cp = 0;
+                if (!parseHex4(raw, i + 1, cp)) {
+                    out += "\\u";
+                    break;
+                }
+                i += 4;
+                // Surrogate pair
+                uint32_t low = 0;
+                if (cp >= 0xD800 && cp <= 0xDBFF && i + 2 < raw.size() && raw[i + 1] == '\\' && raw[i + 2] == 'u'
+                    && parseHex4(raw, i + 3, low) && low >= 0xDC00 && low <= 0xDFFF) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    i += 6;
+                }
+                appendUtf8(out, cp);
+                break;
+            }
+            default: out += esc; break;
+        }
+    }
+    if (i < raw.size()) {
+        out += "...";
+    }
+    return out;
+}
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+// Parsing END
+//--------------------------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utils/MappedFile.h"
+
+enum class JsonKind : uint8_t {
+    Object,
+    Array,
+    String,
+    Number,
+    Bool,
+    Null,
+    Invalid
+};
+
+// A value of the document that has been materialized. Views point into the mapped file,
+// children are only created when the node is expanded.
+struct JsonNode {
+    std::vector<std::unique_ptr<JsonNode>> children;
+    std::string_view key;       // raw key without quotes, empty for array elements
+    std::string_view value;     // raw token, whole text for objects/arrays
+    std::string displayKey;     // only filled when the raw key has escapes
+    std::string preview;        // decoded and truncated scalar for display
+    JsonKind kind = JsonKind::Invalid;
+    size_t index = 0;           // position inside the parent
+    size_t resumeOffset = 0;    // where the next page of children starts, 0 when done
+    bool expanded = false;
+
+    bool isContainer() const { return kind == JsonKind::Object || kind == JsonKind::Array; }
+    bool hasMoreChildren() const { return resumeOffset != 0; }
+};
+
+// Lazy JSON document. Opening does a single pass over the file that records the matching
+// close bracket of every large container, nodes are parsed only when expanded.
+class JsonDocument {
+public:
+    static constexpr size_t kChildPageSize = 1000;
+    static constexpr size_t kPreviewLength = 256;
+
+    JsonDocument() = default;
+    ~JsonDocument() = default;
+
+    bool open(const std::filesystem::path& filepath);
+    // Text is not copied, it has to outlive the document
+    bool load(std::string_view text);
+
+    JsonNode* getRoot() const { return m_root.get(); }
+    bool expandNode(JsonNode* node, size_t maxChildren = kChildPageSize);
+
+    const std::string& getError() const { return m_error; }
+    size_t getByteSize() const { return m_text.size(); }
+    size_t getIndexedContainerCount() const { return m_containerStarts.size(); }
+    size_t getMaterializedNodeCount() const { return m_materializedNodes; }
+
+    static std::string unescape(std::string_view raw, size_t maxLength = std::string::npos);
+
+private:
+    // Containers smaller than this are skipped by scanning instead of being indexed
+    static constexpr size_t kIndexThreshold = 64 * 1024;
+
+    Mir::Utils::File::MappedFile m_file;
+    std::string_view m_text;
+    std::vector<uint64_t> m_containerStarts;
+    std::vector<uint64_t> m_containerEnds;
+    std::unique_ptr<JsonNode> m_root;
+    std::string m_error;
+    size_t m_materializedNodes = 0;
+
+    bool buildIndex();
+    bool parseValue(size_t& pos, JsonNode& node);
+    size_t findStructural(size_t pos) const;
+    size_t skipString(size_t pos) const;
+    size_t skipWhitespace(size_t pos) const;
+    size_t findContainerEnd(size_t start) const;
+};
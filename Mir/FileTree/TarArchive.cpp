@@ -0,0 +1,324 @@
+#include "TarArchive.h"
+#include "utils/Profiler.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    constexpr size_t kBlock = 512;
+
+    // Octal, space or NUL terminated. GNU stores values that do not fit as big endian base-256
+    // with the high bit of the first byte set.
+    uint64_t parseNumber(const char* field, size_t length) {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(field);
+        uint64_t value = 0;
+        if (bytes[0] & 0x80) {
+            for (size_t i = 1; i < length; i++) {
+                value = (value << 8) | bytes[i];
+            }
+            return value;
+        }
+        size_t i = 0;
+        while (i < length && (field[i] == ' ' || field[i] == '\0')) {
+            i++;
+        }
+        for (; i < length && field[i] >= '0' && field[i] <= '7'; i++) {
+            value = (value << 3) | static_cast<uint64_t>(field[i] - '0');
+        }
+        return value;
+    }
+
+    std::string_view fieldText(const char* field, size_t length) {
+        return std::string_view(field, strnlen(field, length));
+    }
+
+    bool checksumMatches(const char* header) {
+        uint64_t stored = parseNumber(header + 148, 8);
+        uint64_t sum = 0;
+        for (size_t i = 0; i < kBlock; i++) {
+            sum += (i >= 148 && i < 156) ? ' ' : static_cast<unsigned char>(header[i]);
+        }
+        return sum == stored;
+    }
+
+    // "./a//b/" -> "a/b", empty for the root and for paths that climb out of it
+    std::string normalize(std::string_view path) {
+        std::string result;
+        size_t start = 0;
+        while (start <= path.size()) {
+            size_t end = path.find('/', start);
+            if (end == std::string_view::npos) {
+                end = path.size();
+            }
+            std::string_view part = path.substr(start, end - start);
+            if (part == "..") {
+                return {};
+            }
+            if (!part.empty() && part != ".") {
+                if (!result.empty()) {
+                    result += '/';
+                }
+                result += part;
+            }
+            start = end + 1;
+        }
+        return result;
+    }
+
+    // pax records: "<length> <key>=<value>\n"
+    template <typename Callback>
+    void parsePax(std::string_view data, Callback&& callback) {
+        while (!data.empty()) {
+            size_t space = data.find(' ');
+            if (space == std::string_view::npos) {
+                return;
+            }
+            size_t length = 0;
+            for (char c : data.substr(0, space)) {
+                length = length * 10 + static_cast<size_t>(c - '0');
+            }
+            if (length <= space + 1 || length > data.size()) {
+                return;
+            }
+            std::string_view record = data.substr(space + 1, length - space - 2); // without the newline
+            size_t equals = record.find('=');
+            if (equals != std::string_view::npos) {
+                callback(record.substr(0, equals), record.substr(equals + 1));
+            }
+            data.remove_prefix(length);
+        }
+    }
+}
+
+bool TarArchive::isArchiveName(const std::filesystem::path& path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+    return extension == ".tar";
+}
+
+uint32_t TarArchive::ensureFolder(std::string_view memberPath) {
+    if (memberPath.empty()) {
+        return kRoot;
+    }
+    auto it = m_index.find(std::string(memberPath));
+    if (it != m_index.end()) {
+        // A file in the way of a member below it, extracting replaces it with the folder too
+        if (m_entries[it->second].type != FileType::DIR) {
+            replaceEntry(m_entries[it->second], FileType::DIR);
+        }
+        return it->second;
+    }
+    return addEntry(memberPath, FileType::DIR);
+}
+
+uint32_t TarArchive::addEntry(std::string_view memberPath, FileType type) {
+    // A later header for the same path replaces the earlier one, like extracting would. Extracting
+    // can't put a file over a folder that has members though, that header is skipped.
+    if (auto it = m_index.find(std::string(memberPath)); it != m_index.end()) {
+        Entry& existing = m_entries[it->second];
+        if (type != FileType::DIR && existing.type == FileType::DIR && !existing.children.empty()) {
+            return kSkipped;
+        }
+        replaceEntry(existing, type);
+        return it->second;
+    }
+    size_t slash = memberPath.rfind('/');
+    uint32_t parent = ensureFolder(slash == std::string_view::npos ? std::string_view() : memberPath.substr(0, slash));
+    uint32_t index = static_cast<uint32_t>(m_entries.size());
+    Entry entry;
+    entry.name = std::string(slash == std::string_view::npos ? memberPath : memberPath.substr(slash + 1));
+    entry.parent = parent;
+    entry.type = type;
+    m_entries.push_back(std::move(entry));
+    m_entries[parent].children.push_back(index);
+    m_index.emplace(std::string(memberPath), index);
+    return index;
+}
+
+void TarArchive::replaceEntry(Entry& entry, FileType type) {
+    // Name, place and members stay, whatever the earlier header said about the data goes
+    entry.type = type;
+    entry.isSymlink = false;
+    entry.offset = 0;
+    entry.size = 0;
+    entry.modifiedTime = 0;
+    entry.linkTarget.clear();
+}
+
+bool TarArchive::open(const std::filesystem::path& archivePath) {
+    MIR_PROFILE_SCOPE("TarArchive::open");
+    m_path = archivePath;
+    m_entries.clear();
+    m_index.clear();
+    m_mapping.close();
+    m_error.clear();
+    m_entries.emplace_back(); // root
+
+    std::ifstream file(archivePath, std::ios::binary);
+    if (!file.is_open()) {
+        m_error = "cannot open archive";
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    uint64_t archiveSize = static_cast<uint64_t>(file.tellg());
+
+    // Extension headers apply to the next real header only
+    std::string longName;
+    std::string longLink;
+    std::string paxPath;
+    std::string paxLink;
+    uint64_t paxSize = 0;
+    bool hasPaxSize = false;
+    int64_t paxTime = 0;
+    bool hasPaxTime = false;
+    std::vector<std::pair<uint32_t, std::string>> hardLinks;
+
+    char header[kBlock];
+    uint64_t position = 0;
+    auto readData = [&](uint64_t offset, uint64_t size, std::string& out) {
+        out.resize(static_cast<size_t>(size));
+        file.seekg(static_cast<std::streamoff>(offset));
+        file.read(out.data(), static_cast<std::streamsize>(size));
+        out.resize(static_cast<size_t>(file.gcount()));
+        while (!out.empty() && out.back() == '\0') {
+            out.pop_back();
+        }
+    };
+
+    while (position + kBlock <= archiveSize) {
+        file.seekg(static_cast<std::streamoff>(position));
+        if (!file.read(header, kBlock)) {
+            break;
+        }
+        // Two zero blocks end the archive, one is enough to stop
+        if (std::all_of(header, header + kBlock, [](char c) { return c == '\0'; })) {
+            break;
+        }
+        if (!checksumMatches(header)) {
+            m_error = "bad header checksum at offset " + std::to_string(position);
+            break;
+        }
+        char typeflag = header[156];
+        uint64_t size = parseNumber(header + 124, 12);
+        if (hasPaxSize && typeflag != 'x' && typeflag != 'g') {
+            size = paxSize;
+        }
+        uint64_t dataOffset = position + kBlock;
+        uint64_t next = dataOffset + (size + kBlock - 1) / kBlock * kBlock;
+
+        if (typeflag == 'L' || typeflag == 'K') {
+            readData(dataOffset, size, typeflag == 'L' ? longName : longLink);
+            position = next;
+            continue;
+        }
+        if (typeflag == 'x' || typeflag == 'g') {
+            std::string records;
+            readData(dataOffset, size, records);
+            // Global headers are rare in practice and only carry defaults, they are skipped
+            if (typeflag == 'x') {
+                parsePax(records, [&](std::string_view key, std::string_view value) {
+                    if (key == "path") {
+                        paxPath = value;
+                    } else if (key == "linkpath") {
+                        paxLink = value;
+                    } else if (key == "size") {
+                        paxSize = std::strtoull(std::string(value).c_str(), nullptr, 10);
+                        hasPaxSize = true;
+                    } else if (key == "mtime") {
+                        paxTime = std::strtoll(std::string(value).c_str(), nullptr, 10);
+                        hasPaxTime = true;
+                    }
+                });
+            }
+            position = next;
+            continue;
+        }
+
+        std::string name;
+        if (!paxPath.empty()) {
+            name = std::move(paxPath);
+        } else if (!longName.empty()) {
+            name = std::move(longName);
+        } else {
+            std::string_view prefix = std::memcmp(header + 257, "ustar\0", 6) == 0 ? fieldText(header + 345, 155) : std::string_view();
+            name = prefix.empty() ? std::string(fieldText(header, 100)) : std::string(prefix) + "/" + std::string(fieldText(header, 100));
+        }
+        std::string link = !paxLink.empty() ? std::move(paxLink) : !longLink.empty() ? std::move(longLink) : std::string(fieldText(header + 157, 100));
+        int64_t modifiedTime = hasPaxTime ? paxTime : static_cast<int64_t>(parseNumber(header + 136, 12));
+        longName.clear();
+        longLink.clear();
+        paxPath.clear();
+        paxLink.clear();
+        hasPaxSize = false;
+        hasPaxTime = false;
+
+        std::string memberPath = normalize(name);
+        bool isFolder = typeflag == '5';
+        bool isFile = typeflag == '0' || typeflag == '\0' || typeflag == '7';
+        bool isSymlink = typeflag == '2';
+        bool isHardLink = typeflag == '1';
+        // Devices, fifos and unknown types have nothing to show
+        if (!memberPath.empty() && (isFolder || isFile || isSymlink || isHardLink)) {
+            uint32_t index = addEntry(memberPath, isFolder ? FileType::DIR : FileType::FILE);
+            if (index == kSkipped) {
+                position = next;
+                continue;
+            }
+            Entry& entry = m_entries[index];
+            entry.modifiedTime = modifiedTime;
+            entry.isSymlink = isSymlink;
+            if (isFile) {
+                entry.offset = dataOffset;
+                entry.size = size;
+            }
+            if (isSymlink || isHardLink) {
+                entry.linkTarget = link;
+            }
+            if (isHardLink) {
+                hardLinks.emplace_back(index, normalize(link));
+            }
+        }
+        position = next;
+    }
+
+    // Hard links share the data of an earlier member, unless a later header replaced the link
+    for (const auto& [index, target] : hardLinks) {
+        const Entry& link = m_entries[index];
+        if (link.type != FileType::FILE || link.isSymlink || normalize(link.linkTarget) != target) {
+            continue;
+        }
+        if (const Entry* source = find(target); source && source->type == FileType::FILE) {
+            m_entries[index].offset = source->offset;
+            m_entries[index].size = source->size;
+        }
+    }
+    if (!m_error.empty()) {
+        std::cout << "[TarArchive::open] " << m_error << "\n";
+    }
+    // Whatever was indexed before a damaged header is still worth browsing
+    return m_entries.size() > 1 || m_error.empty();
+}
+
+const TarArchive::Entry* TarArchive::find(std::string_view memberPath) const {
+    std::string key = normalize(memberPath);
+    if (key.empty()) {
+        return &m_entries[kRoot];
+    }
+    auto it = m_index.find(key);
+    return it == m_index.end() ? nullptr : &m_entries[it->second];
+}
+
+std::string_view TarArchive::read(const Entry& entry) {
+    if (entry.type != FileType::FILE || entry.size == 0) {
+        return {};
+    }
+    if (!m_mapping.isOpen() && !m_mapping.open(m_path)) {
+        return {};
+    }
+    // A truncated archive keeps whatever part of the member is there
+    if (entry.offset >= m_mapping.size()) {
+        return {};
+    }
+    return m_mapping.view().substr(static_cast<size_t>(entry.offset), static_cast<size_t>(entry.size));
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "FileNode.h"
+#include "utils/MappedFile.h"
+
+// Index of a tar archive for browsing it like a folder. open() reads only the 512 byte headers
+// and seeks over member data, so a multi-GB artifact is indexed in a few header reads per
+// member. Member contents are views into a read-only mapping of the archive, made on first read.
+//
+// Understands ustar, GNU (long names, base-256 sizes) and pax (path, linkpath, size, mtime)
+// headers. Folders missing from the archive are made up from the member paths.
+//
+//   TarArchive archive;
+//   if (archive.open(path)) {
+//       for (uint32_t child : archive.getEntry(TarArchive::kRoot).children) { ... }
+//       std::string_view data = archive.read(*archive.find("bin/app.json"));
+//   }
+class TarArchive
+{
+public:
+    struct Entry {
+        std::string name;               // last path component, as stored (usually UTF-8)
+        uint32_t parent = 0;
+        FileType type = FileType::DIR;
+        bool isSymlink = false;
+        uint64_t offset = 0;            // of the data in the archive, files only
+        uint64_t size = 0;
+        int64_t modifiedTime = 0;       // seconds since the epoch
+        std::string linkTarget;         // symlinks and hard links
+        std::vector<uint32_t> children; // folders only, in archive order
+    };
+    static constexpr uint32_t kRoot = 0;
+
+    TarArchive() = default;
+    TarArchive(const TarArchive&) = delete;
+    TarArchive& operator=(const TarArchive&) = delete;
+
+    bool open(const std::filesystem::path& archivePath);
+    const std::string& getError() const { return m_error; }
+    const std::filesystem::path& getPath() const { return m_path; }
+
+    size_t getEntryCount() const { return m_entries.size(); }
+    const Entry& getEntry(uint32_t index) const { return m_entries[index]; }
+    // "dir/file" relative to the archive root, nullptr if missing. "" is the root.
+    const Entry* find(std::string_view memberPath) const;
+    // Member contents, empty for folders or when the archive cannot be mapped
+    std::string_view read(const Entry& entry);
+
+    // By file name only, the header check happens in open()
+    static bool isArchiveName(const std::filesystem::path& path);
+
+private:
+    std::filesystem::path m_path;
+    std::vector<Entry> m_entries;
+    std::unordered_map<std::string, uint32_t> m_index; // full member path -> entry
+    Mir::Utils::File::MappedFile m_mapping;
+    std::string m_error;
+
+    static constexpr uint32_t kSkipped = UINT32_MAX;    // addEntry() refused the header
+
+    uint32_t addEntry(std::string_view memberPath, FileType type);
+    uint32_t ensureFolder(std::string_view memberPath);
+    static void replaceEntry(Entry& entry, FileType type);
+};
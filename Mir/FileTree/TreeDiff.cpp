@@ -0,0 +1,240 @@
+#include "TreeDiff.h"
+#include "FileTree.h"
+#include "utils/BatchIo.h"
+#include "utils/MappedFile.h"
+#include "utils/Profiler.h"
+#include "utils/Utils.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <string_view>
+
+struct TreeDiff::ContentJob {
+    Mir::Utils::File::MappedFile left;
+    Mir::Utils::File::MappedFile right;
+    FileNode* node = nullptr;
+    std::atomic<size_t> remaining{0};
+    std::atomic<bool> differs{false};
+};
+
+TreeDiff::TreeDiff() : TreeDiff(Options{}) {}
+
+TreeDiff::TreeDiff(Options options) : m_options(options) {}
+
+std::unique_ptr<FileNode> TreeDiff::compare(const std::filesystem::path& left, const std::filesystem::path& right) {
+    MIR_PROFILE_SCOPE("TreeDiff::compare");
+    std::string name = Mir::Utils::File::toUtf8(left.filename()) + " <> " + Mir::Utils::File::toUtf8(right.filename());
+    auto root = std::make_unique<FileNode>(Mir::Utils::Text::sanitizeUtf8(name), FileType::DIR);
+    root->fullPath = right;
+
+    m_pool = std::make_unique<Mir::ThreadPool>(m_options.threadCount);
+    // Directory tasks queue their subdirectories and content chunks on the same pool,
+    // so the pool going idle means the whole comparison is done
+    m_pool->submit([this, node = root.get(), left, right]() { compareDirectory(node, left, right); });
+    m_pool->waitIdle();
+    m_pool.reset();
+
+    // Folders that were never scanned would come out as Unchanged
+    if (m_cancelled.load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    finalize(root.get());
+    return root;
+}
+
+TreeDiff::Stats TreeDiff::getStats() const {
+    Stats stats;
+    stats.scanned = m_scanned.load(std::memory_order_relaxed);
+    stats.unchanged = m_unchanged.load(std::memory_order_relaxed);
+    stats.added = m_added.load(std::memory_order_relaxed);
+    stats.removed = m_removed.load(std::memory_order_relaxed);
+    stats.sizeChanged = m_sizeChanged.load(std::memory_order_relaxed);
+    stats.timeChanged = m_timeChanged.load(std::memory_order_relaxed);
+    stats.contentChanged = m_contentChanged.load(std::memory_order_relaxed);
+    stats.comparedBytes = m_comparedBytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+std::vector<std::unique_ptr<FileNode>> TreeDiff::list(const std::filesystem::path& directory) {
+    std::vector<std::unique_ptr<FileNode>> entries;
+    std::error_code ec;
+    const std::filesystem::directory_iterator end;
+    for (std::filesystem::directory_iterator it(directory, ec); !ec && it != end; it.increment(ec)) {
+        try {
+            if (auto node = FileTree::makeNode(*it, false)) {
+                entries.push_back(std::move(node));
+            }
+        }
+        catch (const std::exception&) { }
+    }
+    FileTree::loadMetadata(entries);
+    m_scanned.fetch_add(entries.size(), std::memory_order_relaxed);
+    // Exact byte order, only needed for the merge join, the renderer sorts for display
+    std::sort(entries.begin(), entries.end(), [](const std::unique_ptr<FileNode>& a, const std::unique_ptr<FileNode>& b) {
+        return a->name < b->name;
+    });
+    return entries;
+}
+
+void TreeDiff::compareDirectory(FileNode* out, const std::filesystem::path& left, const std::filesystem::path& right) {
+    MIR_PROFILE_SCOPE("TreeDiff::compareDirectory");
+    if (m_cancelled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    std::vector<std::unique_ptr<FileNode>> leftEntries = list(left);
+    std::vector<std::unique_ptr<FileNode>> rightEntries = list(right);
+
+    struct SubDirectory {
+        FileNode* node;
+        std::filesystem::path left;
+    };
+    std::vector<SubDirectory> subDirectories;
+    std::vector<SmallFile> smallFiles;
+    out->children.reserve(std::max(leftEntries.size(), rightEntries.size()));
+
+    auto addOnly = [&](std::unique_ptr<FileNode> node, DiffStatus status) {
+        setStatus(node.get(), status);
+        out->children.push_back(std::move(node)); // directories stay lazy, expanding them lists one side
+    };
+
+    size_t i = 0;
+    size_t j = 0;
+    while (i < leftEntries.size() || j < rightEntries.size()) {
+        if (j == rightEntries.size()) {
+            addOnly(std::move(leftEntries[i++]), DiffStatus::Removed);
+            continue;
+        }
+        if (i == leftEntries.size()) {
+            addOnly(std::move(rightEntries[j++]), DiffStatus::Added);
+            continue;
+        }
+        int order = leftEntries[i]->name.compare(rightEntries[j]->name);
+        if (order < 0) {
+            addOnly(std::move(leftEntries[i++]), DiffStatus::Removed);
+            continue;
+        }
+        if (order > 0) {
+            addOnly(std::move(rightEntries[j++]), DiffStatus::Added);
+            continue;
+        }
+
+        std::unique_ptr<FileNode> leftNode = std::move(leftEntries[i++]);
+        std::unique_ptr<FileNode> rightNode = std::move(rightEntries[j++]);
+        if (leftNode->type != rightNode->type) {
+            // A file replaced by a folder (or the other way around) is a removal plus an addition
+            addOnly(std::move(leftNode), DiffStatus::Removed);
+            addOnly(std::move(rightNode), DiffStatus::Added);
+            continue;
+        }
+        if (rightNode->type == FileType::DIR && !rightNode->isSymlink && !leftNode->isSymlink) {
+            rightNode->hasUnexpandedChildren = false;
+            subDirectories.push_back({rightNode.get(), leftNode->fullPath});
+        } else if (rightNode->type == FileType::DIR) {
+            setStatus(rightNode.get(), DiffStatus::Unchanged); // linked folders are not followed
+        } else {
+            compareFiles(rightNode.get(), *leftNode, smallFiles);
+        }
+        out->children.push_back(std::move(rightNode));
+    }
+    compareSmallFiles(smallFiles);
+
+    // Children are complete before any subdirectory task starts, tasks only touch their own node
+    for (const SubDirectory& sub : subDirectories) {
+        m_pool->submit([this, node = sub.node, left = sub.left]() { compareDirectory(node, left, node->fullPath); });
+    }
+}
+
+void TreeDiff::compareFiles(FileNode* out, const FileNode& left, std::vector<SmallFile>& smallFiles) {
+    if (out->size != left.size) {
+        setStatus(out, DiffStatus::SizeChanged);
+    } else if (out->modifiedTime == left.modifiedTime) {
+        setStatus(out, DiffStatus::Unchanged);
+    } else if (m_options.compareContent && out->size > 0 && out->size <= kSmallFileSize) {
+        smallFiles.push_back({out, left.fullPath});
+    } else if (m_options.compareContent && out->size > 0) {
+        compareContent(out, left.fullPath);
+    } else {
+        setStatus(out, DiffStatus::TimeChanged);
+    }
+}
+
+void TreeDiff::compareSmallFiles(const std::vector<SmallFile>& smallFiles) {
+    if (smallFiles.empty()) {
+        return;
+    }
+    MIR_PROFILE_SCOPE("TreeDiff::compareSmallFiles");
+    // Both sides of every file in one batch, with io_uring that is all opens and reads in flight at once
+    thread_local Mir::Utils::File::BatchIo io;
+    std::vector<const std::filesystem::path*> paths;
+    paths.reserve(smallFiles.size() * 2);
+    for (const SmallFile& file : smallFiles) {
+        paths.push_back(&file.left);
+        paths.push_back(&file.node->fullPath);
+    }
+    std::vector<std::string> contents;
+    io.readHeads(paths, kSmallFileSize, contents);
+    for (size_t i = 0; i < smallFiles.size(); i++) {
+        const std::string& leftContent = contents[i * 2];
+        const std::string& rightContent = contents[i * 2 + 1];
+        m_comparedBytes.fetch_add(leftContent.size() + rightContent.size(), std::memory_order_relaxed);
+        setStatus(smallFiles[i].node, leftContent != rightContent ? DiffStatus::ContentChanged : DiffStatus::TimeChanged);
+    }
+}
+
+void TreeDiff::compareContent(FileNode* out, const std::filesystem::path& left) {
+    auto job = std::make_shared<ContentJob>();
+    job->node = out;
+    if (!job->left.open(left) || !job->right.open(out->fullPath) || job->left.size() != job->right.size()) {
+        setStatus(out, DiffStatus::TimeChanged);
+        return;
+    }
+
+    size_t chunkSize = std::max<size_t>(m_options.chunkSize, 64 * 1024);
+    size_t chunks = (job->left.size() + chunkSize - 1) / chunkSize;
+    job->remaining.store(chunks, std::memory_order_relaxed);
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+        m_pool->submit([this, job, offset = chunk * chunkSize]() { compareChunk(job, offset); });
+    }
+}
+
+void TreeDiff::compareChunk(const std::shared_ptr<ContentJob>& job, size_t offset) {
+    MIR_PROFILE_SCOPE("TreeDiff::compareChunk");
+    // Once one chunk differs the rest only count down
+    if (!job->differs.load(std::memory_order_relaxed) && !m_cancelled.load(std::memory_order_relaxed)) {
+        size_t length = std::min(std::max<size_t>(m_options.chunkSize, 64 * 1024), job->left.size() - offset);
+        // Both sides are mapped, comparing the bytes is cheaper than hashing them and exact
+        if (std::memcmp(job->left.view().data() + offset, job->right.view().data() + offset, length) != 0) {
+            job->differs.store(true, std::memory_order_relaxed);
+        }
+        m_comparedBytes.fetch_add(length * 2, std::memory_order_relaxed);
+    }
+    if (job->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        setStatus(job->node, job->differs.load(std::memory_order_relaxed) ? DiffStatus::ContentChanged : DiffStatus::TimeChanged);
+    }
+}
+
+void TreeDiff::setStatus(FileNode* node, DiffStatus status) {
+    node->diffStatus = status;
+    switch (status) {
+        case DiffStatus::Unchanged:      m_unchanged.fetch_add(1, std::memory_order_relaxed); break;
+        case DiffStatus::Added:          m_added.fetch_add(1, std::memory_order_relaxed); break;
+        case DiffStatus::Removed:        m_removed.fetch_add(1, std::memory_order_relaxed); break;
+        case DiffStatus::SizeChanged:    m_sizeChanged.fetch_add(1, std::memory_order_relaxed); break;
+        case DiffStatus::TimeChanged:    m_timeChanged.fetch_add(1, std::memory_order_relaxed); break;
+        case DiffStatus::ContentChanged: m_contentChanged.fetch_add(1, std::memory_order_relaxed); break;
+        default: break;
+    }
+}
+
+DiffStatus TreeDiff::finalize(FileNode* node) {
+    if (node->type != FileType::DIR || node->diffStatus != DiffStatus::None) {
+        return node->diffStatus;
+    }
+    bool changed = false;
+    for (const auto& child : node->children) {
+        DiffStatus status = finalize(child.get());
+        changed |= status != DiffStatus::Unchanged;
+    }
+    node->diffStatus = changed ? DiffStatus::ChildrenChanged : DiffStatus::Unchanged;
+    return node->diffStatus;
+}
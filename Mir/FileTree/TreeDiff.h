@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "FileNode.h"
+#include "utils/ThreadPool.h"
+
+// Compares two directory trees, e.g. a deployed folder against a build output.
+// Every directory pair is a task on a worker pool, so both trees are scanned in parallel.
+// Children of each level are sorted by name and merge-joined. The result is a normal
+// FileNode tree (paths of the right side, left side for removed entries) with diffStatus set.
+//
+//   TreeDiff diff({.compareContent = true});
+//   std::unique_ptr<FileNode> root = diff.compare(deployed, buildOutput);
+class TreeDiff
+{
+public:
+    struct Options {
+        bool compareContent = false;          // compare the bytes of same sized files whose mtime differs
+        size_t chunkSize = 4 * 1024 * 1024;   // files are compared in chunks on the pool
+        size_t threadCount = 0;               // 0 = hardware concurrency
+    };
+
+    struct Stats {
+        size_t scanned = 0;
+        size_t unchanged = 0;
+        size_t added = 0;
+        size_t removed = 0;
+        size_t sizeChanged = 0;
+        size_t timeChanged = 0;
+        size_t contentChanged = 0;
+        size_t comparedBytes = 0;
+    };
+
+    TreeDiff();
+    explicit TreeDiff(Options options);
+    ~TreeDiff() = default;
+
+    // nullptr when cancelled, a partial tree would show unscanned folders as unchanged
+    std::unique_ptr<FileNode> compare(const std::filesystem::path& left, const std::filesystem::path& right);
+    // Thread safe, compare() stops early and returns nullptr
+    void cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+    Stats getStats() const;
+
+private:
+    struct ContentJob;
+    struct SmallFile {
+        FileNode* node;
+        std::filesystem::path left;
+    };
+    // Files up to this size are read in one BatchIo round per directory instead of being mapped
+    static constexpr size_t kSmallFileSize = 64 * 1024;
+
+    Options m_options;
+    std::atomic<bool> m_cancelled{false};
+    std::atomic<size_t> m_scanned{0};
+    std::atomic<size_t> m_unchanged{0};
+    std::atomic<size_t> m_added{0};
+    std::atomic<size_t> m_removed{0};
+    std::atomic<size_t> m_sizeChanged{0};
+    std::atomic<size_t> m_timeChanged{0};
+    std::atomic<size_t> m_contentChanged{0};
+    std::atomic<size_t> m_comparedBytes{0};
+    std::unique_ptr<Mir::ThreadPool> m_pool;
+
+    void compareDirectory(FileNode* out, const std::filesystem::path& left, const std::filesystem::path& right);
+    std::vector<std::unique_ptr<FileNode>> list(const std::filesystem::path& directory);
+    void compareFiles(FileNode* out, const FileNode& left, std::vector<SmallFile>& smallFiles);
+    void compareSmallFiles(const std::vector<SmallFile>& smallFiles);
+    void compareContent(FileNode* out, const std::filesystem::path& left);
+    void compareChunk(const std::shared_ptr<ContentJob>& job, size_t offset);
+    void setStatus(FileNode* node, DiffStatus status);
+    static DiffStatus finalize(FileNode* node);
+};
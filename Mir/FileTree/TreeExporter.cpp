@@ -0,0 +1,282 @@
+#include "TreeExporter.h"
+#include "utils/Profiler.h"
+#include "utils/Utils.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+namespace {
+    std::string makeName(const std::filesystem::path& filename) {
+        std::string name = Mir::Utils::File::toUtf8(filename);
+        if (!Mir::Utils::Text::isValidUtf8(name)) {
+            name = Mir::Utils::Text::sanitizeUtf8(name);
+        }
+        return name;
+    }
+
+    int64_t toUnixSeconds(std::filesystem::file_time_type time) {
+        auto system = std::chrono::file_clock::to_sys(time);
+        return std::chrono::duration_cast<std::chrono::seconds>(system.time_since_epoch()).count();
+    }
+}
+
+TreeExporter::TreeExporter(Mir::Utils::File::BufferedWriter& out, Options options)
+    : m_out(out), m_options(options) {}
+
+bool TreeExporter::parseFormat(std::string_view text, Format& format) {
+    if (text == "text" || text == "txt") {
+        format = Format::Text;
+    } else if (text == "jsonl" || text == "json") {
+        format = Format::JsonLines;
+    } else if (text == "csv") {
+        format = Format::Csv;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool TreeExporter::exportTree(const std::filesystem::path& root) {
+    MIR_PROFILE_SCOPE("TreeExporter::exportTree");
+    std::error_code ec;
+    if (!std::filesystem::is_directory(root, ec)) {
+        std::cerr << "[TreeExporter::exportTree] not a directory: " << Mir::Utils::File::toUtf8(root) << "\n";
+        return false;
+    }
+    if (m_options.format == Format::Csv) {
+        m_out.write("path,type,size,mtime,depth\n");
+    } else if (m_options.format == Format::Text) {
+        auto filename = root.filename().empty() ? root : root.filename();
+        m_out.write("[DIR] ");
+        m_out.write(makeName(filename));
+        m_out.put('\n');
+    }
+    m_relativePath.clear();
+    walk(root, 1);
+    return m_out.flush();
+}
+
+bool TreeExporter::exportNode(const FileNode& root) {
+    if (m_options.format == Format::Csv) {
+        m_out.write("path,type,size,mtime,depth\n");
+    } else if (m_options.format == Format::Text) {
+        m_out.write("[DIR] ");
+        m_out.write(root.name);
+        m_out.put('\n');
+    }
+    m_relativePath.clear();
+    walkNode(root, 1);
+    return m_out.flush();
+}
+
+bool TreeExporter::readEntry(const std::filesystem::directory_entry& dirEntry, Entry& entry) {
+    entry.path = dirEntry.path();
+#ifdef _WIN32
+    // The directory enumeration already cached size, time and attributes
+    std::error_code ec;
+    if (dirEntry.is_directory(ec)) {
+        entry.type = FileType::DIR;
+        entry.size = 0;
+    } else if (dirEntry.is_regular_file(ec)) {
+        entry.type = FileType::FILE;
+        entry.size = dirEntry.file_size(ec);
+    } else {
+        return false;
+    }
+    entry.modifiedTime = toUnixSeconds(dirEntry.last_write_time(ec));
+#else
+    std::error_code ec;
+    // One stat for type, size and time instead of one per std::filesystem query
+    struct stat info;
+    if (::stat(entry.path.c_str(), &info) != 0) {
+        return false;
+    }
+    if (S_ISDIR(info.st_mode)) {
+        entry.type = FileType::DIR;
+        entry.size = 0;
+    } else if (S_ISREG(info.st_mode)) {
+        entry.type = FileType::FILE;
+        entry.size = static_cast<uint64_t>(info.st_size);
+    } else {
+        return false;
+    }
+    entry.modifiedTime = static_cast<int64_t>(info.st_mtime);
+#endif
+    entry.name = makeName(entry.path.filename());
+    entry.isSymlink = entry.type == FileType::DIR && dirEntry.is_symlink(ec);
+    return true;
+}
+
+bool TreeExporter::lessThan(const Entry& a, const Entry& b) {
+    if (a.type != b.type) {
+        return a.type == FileType::DIR;
+    }
+    return Mir::Utils::Text::compareCaseInsensitive(a.name, b.name) < 0;
+}
+
+void TreeExporter::walk(const std::filesystem::path& directory, int depth) {
+    std::error_code ec;
+    std::filesystem::directory_iterator it(directory, ec);
+    if (ec) {
+        m_stats.errors++;
+        return;
+    }
+    const std::filesystem::directory_iterator end;
+    bool descend = m_options.maxDepth < 0 || depth <= m_options.maxDepth;
+
+    auto visit = [&](const Entry& entry) {
+        size_t parentLength = m_relativePath.size();
+        if (parentLength > 0) {
+            m_relativePath.push_back('/');
+        }
+        m_relativePath += entry.name;
+        emit(entry, depth);
+        // Linked folders are listed but not followed, links can form cycles
+        if (entry.type == FileType::DIR && !entry.isSymlink && descend) {
+            walk(entry.path, depth + 1);
+        }
+        m_relativePath.resize(parentLength);
+    };
+
+    if (!m_options.sorted) {
+        // Streams as the OS enumerates, only one entry per open directory is alive
+        Entry entry;
+        for (; !ec && it != end; it.increment(ec)) {
+            if (readEntry(*it, entry)) {
+                visit(entry);
+            }
+        }
+        return;
+    }
+
+    std::vector<Entry> entries;
+    for (; !ec && it != end; it.increment(ec)) {
+        Entry entry;
+        if (readEntry(*it, entry)) {
+            entries.push_back(std::move(entry));
+        }
+    }
+    std::sort(entries.begin(), entries.end(), lessThan);
+    for (const Entry& entry : entries) {
+        visit(entry);
+    }
+}
+
+void TreeExporter::walkNode(const FileNode& node, int depth) {
+    bool descend = m_options.maxDepth < 0 || depth <= m_options.maxDepth;
+    Entry entry;
+    for (const auto& child : node.children) {
+        entry.type = child->type;
+        entry.name = child->name;
+        entry.size = child->size;
+        entry.modifiedTime = toUnixSeconds(std::filesystem::file_time_type(std::filesystem::file_time_type::duration(child->modifiedTime)));
+
+        size_t parentLength = m_relativePath.size();
+        if (parentLength > 0) {
+            m_relativePath.push_back('/');
+        }
+        m_relativePath += entry.name;
+        emit(entry, depth);
+        if (child->type == FileType::DIR && !child->isSymlink && descend) {
+            walkNode(*child, depth + 1);
+        }
+        m_relativePath.resize(parentLength);
+    }
+}
+
+void TreeExporter::emit(const Entry& entry, int depth) {
+    bool isDir = entry.type == FileType::DIR;
+    if (isDir) {
+        m_stats.directories++;
+    } else {
+        m_stats.files++;
+        m_stats.totalBytes += entry.size;
+    }
+
+    switch (m_options.format) {
+        case Format::Text:
+            m_out.fill(' ', static_cast<size_t>(depth) * 2);
+            if (isDir) {
+                m_out.write("[DIR] ");
+                m_out.write(entry.name);
+            } else {
+                m_out.write("[FILE] ");
+                m_out.write(entry.name);
+                m_out.write(" (");
+                m_out.writeNumber(entry.size);
+                m_out.write(" bytes)");
+            }
+            m_out.put('\n');
+            break;
+
+        case Format::JsonLines:
+            m_out.write("{\"path\":");
+            writeJsonString(m_relativePath);
+            m_out.write(isDir ? ",\"type\":\"dir\",\"size\":" : ",\"type\":\"file\",\"size\":");
+            m_out.writeNumber(entry.size);
+            m_out.write(",\"mtime\":");
+            m_out.writeNumber(entry.modifiedTime);
+            m_out.write(",\"depth\":");
+            m_out.writeNumber(static_cast<uint64_t>(depth));
+            m_out.write("}\n");
+            break;
+
+        case Format::Csv:
+            writeCsvField(m_relativePath);
+            m_out.write(isDir ? ",dir," : ",file,");
+            m_out.writeNumber(entry.size);
+            m_out.put(',');
+            m_out.writeNumber(entry.modifiedTime);
+            m_out.put(',');
+            m_out.writeNumber(static_cast<uint64_t>(depth));
+            m_out.put('\n');
+            break;
+    }
+}
+
+void TreeExporter::writeJsonString(std::string_view text) {
+    static constexpr char kHex[] = "0123456789abcdef";
+    m_out.put('"');
+    size_t runStart = 0;
+    for (size_t i = 0; i < text.size(); i++) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        // Names are valid UTF-8 already, only quotes, backslashes and control bytes need escaping
+        m_out.write(text.substr(runStart, i - runStart));
+        runStart = i + 1;
+        switch (c) {
+            case '"':  m_out.write("\\\""); break;
+            case '\\': m_out.write("\\\\"); break;
+            case '\n': m_out.write("\\n"); break;
+            case '\r': m_out.write("\\r"); break;
+            case '\t': m_out.write("\\t"); break;
+            default: {
+                char escaped[] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xF]};
+                m_out.write(std::string_view(escaped, sizeof(escaped)));
+            }
+        }
+    }
+    m_out.write(text.substr(runStart));
+    m_out.put('"');
+}
+
+void TreeExporter::writeCsvField(std::string_view text) {
+    if (text.find_first_of(",\"\r\n") == std::string_view::npos) {
+        m_out.write(text);
+        return;
+    }
+    m_out.put('"');
+    for (char c : text) {
+        if (c == '"') {
+            m_out.put('"');
+        }
+        m_out.put(c);
+    }
+    m_out.put('"');
+}
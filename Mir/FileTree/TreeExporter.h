@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "FileNode.h"
+#include "utils/BufferedWriter.h"
+
+// Streams a directory tree straight from disk into a writer. Nothing but the directories
+// currently being walked is held in memory, so trees of any size can be dumped.
+//
+//   Mir::Utils::File::BufferedWriter out("tree.jsonl");
+//   TreeExporter exporter(out, {.format = TreeExporter::Format::JsonLines});
+//   exporter.exportTree("C:/Projects");
+class TreeExporter
+{
+public:
+    enum class Format {
+        Text,       // indented like FileTree::print
+        JsonLines,  // one object per entry
+        Csv         // path,type,size,mtime,depth with a header row
+    };
+
+    struct Options {
+        Format format = Format::Text;
+        int maxDepth = -1;   // -1 = unlimited, 0 = only the root's children
+        bool sorted = true;  // folders first, then by name, like the tree view
+    };
+
+    struct Stats {
+        size_t directories = 0;
+        size_t files = 0;
+        uint64_t totalBytes = 0;
+        size_t errors = 0;   // directories that could not be read
+    };
+
+    TreeExporter(Mir::Utils::File::BufferedWriter& out, Options options);
+
+    bool exportTree(const std::filesystem::path& root);
+    // Writes an already loaded tree (e.g. the one shown in the UI) in the same format
+    bool exportNode(const FileNode& root);
+    const Stats& getStats() const { return m_stats; }
+
+    static bool parseFormat(std::string_view text, Format& format);
+
+private:
+    struct Entry {
+        std::filesystem::path path;
+        std::string name;
+        FileType type = FileType::UNKNOWN;
+        bool isSymlink = false;
+        uint64_t size = 0;
+        int64_t modifiedTime = 0; // seconds since the Unix epoch
+    };
+
+    Mir::Utils::File::BufferedWriter& m_out;
+    Options m_options;
+    Stats m_stats;
+    std::string m_relativePath; // UTF-8, '/' separated, grows and shrinks while walking
+
+    void walk(const std::filesystem::path& directory, int depth);
+    void walkNode(const FileNode& node, int depth);
+    void emit(const Entry& entry, int depth);
+    static bool readEntry(const std::filesystem::directory_entry& dirEntry, Entry& entry);
+    static bool lessThan(const Entry& a, const Entry& b);
+    void writeJsonString(std::string_view text);
+    void writeCsvField(std::string_view text);
+};
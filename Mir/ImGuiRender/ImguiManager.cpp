@@ -1,12 +1,37 @@
 #include "ImguiManager.h"
 #include "FileTree/FileTree.h"
+#include "FileTree/MemoryFileSystem.h"
 #include "FileTree/Rendering/FileTreeRenderer.h"
+#include "ProfilerOverlay.h"
+#include "utils/Profiler.h"
+#include "utils/Redraw.h"
+#include <cstdlib>
+#include <iostream>
 #include <memory>
 #include <filesystem>
 
+namespace {
+    // MIR_MEMORY_FS="depth=3,dirs=10,files=1000,call_us=20000" browses a made up tree instead of
+    // the working directory, for measuring the UI on huge or slow trees the same way every run
+    std::shared_ptr<FileTree> makeFileTree() {
+        const char* spec = std::getenv("MIR_MEMORY_FS");
+        if (!spec) {
+            return std::make_shared<FileTree>();
+        }
+        MemoryFileSystem::Shape shape;
+        MemoryFileSystem::Latency latency;
+        if (!MemoryFileSystem::parseSpec(spec, shape, latency)) {
+            std::cout << "[ImguiManager] ignoring bad MIR_MEMORY_FS: " << spec << "\n";
+            return std::make_shared<FileTree>();
+        }
+        auto memory = std::make_shared<MemoryFileSystem>("/mem", shape, latency);
+        return std::make_shared<FileTree>(memory->getRoot(), memory);
+    }
+}
+
 void ImguiManager::Render() {
     
-    static std::shared_ptr<FileTree> fTree = std::make_shared<FileTree>();
+    static std::shared_ptr<FileTree> fTree = makeFileTree();
     static FileTreeRenderer r(fTree);
 
     
@@ -88,6 +113,11 @@ void ImguiManager::Render() {
         callbacksInitialized = true;
     }
     r.Render();
+
+#ifdef MIR_ENABLE_PROFILER
+    static ProfilerOverlay profilerOverlay;
+    profilerOverlay.Render();
+#endif
 }
 
 void glfwErrorCallback(int error, const char* description) {
@@ -138,6 +168,7 @@ void ImguiManager::CreateDockspace() {
 }
 
 ImguiManager::~ImguiManager() {
+    Mir::Redraw::setWakeHandler(nullptr);
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -177,9 +208,42 @@ bool ImguiManager::initialize() {
 
     ImGui_ImplGlfw_InitForOpenGL(m_window, true);
     ImGui_ImplOpenGL3_Init(glsl_version);
+
+    Mir::Redraw::setWakeHandler([]() { glfwPostEmptyEvent(); });
     return true;
 }
 
+bool ImguiManager::WaitForFrame() {
+    if (!m_idleRendering) {
+        glfwPollEvents();
+        return true;
+    }
+
+    bool woken = false;
+    if (m_settleFrames > 0) {
+        glfwPollEvents();
+    } else if (glfwGetWindowAttrib(m_window, GLFW_ICONIFIED)) {
+        glfwWaitEvents();
+        woken = true;
+    } else {
+        // Returning before the timeout means some event arrived, on any viewport window
+        const bool caretBlinking = ImGui::GetIO().WantTextInput;
+        const double timeout = caretBlinking ? kCaretBlinkTimeout : kIdleTimeout;
+        const double start = glfwGetTime();
+        glfwWaitEventsTimeout(timeout);
+        woken = glfwGetTime() - start < timeout - 0.001 || caretBlinking;
+    }
+
+    if (Mir::Redraw::consume() || woken) {
+        m_settleFrames = kSettleFrames;
+    }
+    if (m_settleFrames > 0) {
+        m_settleFrames--;
+        return true;
+    }
+    return false;
+}
+
 void ImguiManager::Begin(){
     glClearColor(0.45f, 0.55f, 0.60f, 1.00f);
     glClear(GL_COLOR_BUFFER_BIT);
@@ -203,6 +267,8 @@ void ImguiManager::End(){
     }
   
     glfwSwapBuffers(m_window);
+    m_renderedFrames++;
+    MIR_PROFILE_FRAME();
 }
 
 
@@ -4,12 +4,21 @@
 #include "imgui_impl_opengl3.h"
 #include <GLFW/glfw3.h> // Will drag system OpenGL headers
 #include "misc/cpp/imgui_stdlib.h" // stdlib support
+#include <cstdint>
 
 class ImguiManager
 {
 private:
     GLFWwindow* m_window = nullptr;
 
+    // Idle mode: block in glfwWaitEvents until input or a Mir::Redraw request arrives,
+    // then render a few frames so ImGui hover/popup state settles before sleeping again
+    static constexpr int kSettleFrames = 3;
+    static constexpr double kIdleTimeout = 1.0;
+    static constexpr double kCaretBlinkTimeout = 0.5;
+    bool m_idleRendering = true;
+    int m_settleFrames = kSettleFrames;
+    uint64_t m_renderedFrames = 0;
 
 private:
     void CreateDockspace();
@@ -21,6 +30,10 @@ public:
     void OnDetach();
     bool ShouldClose() const { return glfwWindowShouldClose(m_window); }
     void PollEvents() { glfwPollEvents(); }
+    // Waits for events, returns true when a frame should be rendered
+    bool WaitForFrame();
+    void SetIdleRendering(bool enabled) { m_idleRendering = enabled; }
+    uint64_t GetRenderedFrames() const { return m_renderedFrames; }
     void Begin();
     void End();
     void Render();
@@ -0,0 +1,54 @@
+#include "ProfilerOverlay.h"
+#ifdef MIR_ENABLE_PROFILER
+#include "imgui.h"
+#include <algorithm>
+#include <numeric>
+
+void ProfilerOverlay::Render() {
+    // Aggregating walks every ring buffer, a few times per second is plenty
+    double time = ImGui::GetTime();
+    if (time - m_lastRefresh > 0.25) {
+        m_frameTimes = Mir::Profiler::getFrameTimes();
+        m_topZones = Mir::Profiler::topZones(1'000'000'000, 12);
+        m_lastRefresh = time;
+    }
+
+    ImGui::SetNextWindowSize(ImVec2(420, 360), ImGuiCond_FirstUseEver);
+    ImGui::Begin("Profiler");
+
+    if (!m_frameTimes.empty()) {
+        float maxTime = *std::max_element(m_frameTimes.begin(), m_frameTimes.end());
+        float avgTime = std::accumulate(m_frameTimes.begin(), m_frameTimes.end(), 0.0f) / m_frameTimes.size();
+        char overlay[64];
+        snprintf(overlay, sizeof(overlay), "avg %.2f ms  max %.2f ms", avgTime, maxTime);
+        ImGui::PlotLines("##FrameTimes", m_frameTimes.data(), static_cast<int>(m_frameTimes.size()), 0, overlay,
+            0.0f, std::max(maxTime, 16.7f), ImVec2(-1.0f, 80.0f));
+    }
+
+    if (ImGui::BeginTable("##Zones", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Zone (last 1s)");
+        ImGui::TableSetupColumn("Total ms");
+        ImGui::TableSetupColumn("Calls");
+        ImGui::TableSetupColumn("Avg us");
+        ImGui::TableHeadersRow();
+        for (const auto& zone : m_topZones) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(zone.name);
+            ImGui::TableNextColumn(); ImGui::Text("%.2f", zone.totalNs / 1e6);
+            ImGui::TableNextColumn(); ImGui::Text("%u", zone.calls);
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", zone.totalNs / 1e3 / std::max(1u, zone.calls));
+        }
+        ImGui::EndTable();
+    }
+
+    if (ImGui::Button("Export Chrome trace")) {
+        const char* path = "mir_trace.json";
+        m_exportStatus = Mir::Profiler::exportChromeTrace(path) ? std::string("Wrote ") + path : "Export failed";
+    }
+    if (!m_exportStatus.empty()) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("%s", m_exportStatus.c_str());
+    }
+    ImGui::End();
+}
+#endif
@@ -0,0 +1,19 @@
+#pragma once
+#ifdef MIR_ENABLE_PROFILER
+#include "utils/Profiler.h"
+#include <string>
+#include <vector>
+
+// ImGui window with the frame time history, the heaviest zones of the last second and trace export
+class ProfilerOverlay
+{
+public:
+    void Render();
+
+private:
+    std::vector<float> m_frameTimes;
+    std::vector<Mir::Profiler::ZoneStats> m_topZones;
+    double m_lastRefresh = 0.0;
+    std::string m_exportStatus;
+};
+#endif
@@ -8,7 +8,9 @@ int main(int argc, char const *argv[])
     }
     
     while (!imgui.ShouldClose()) {
-        imgui.PollEvents();
+        if (!imgui.WaitForFrame()) {
+            continue;
+        }
         imgui.Begin();
         imgui.Render();
         imgui.End();
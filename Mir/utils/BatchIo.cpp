@@ -0,0 +1,508 @@
+#include "BatchIo.h"
+#include <chrono>
+#include <fstream>
+
+#if defined(MIR_ENABLE_IO_URING) && defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define MIR_HAS_IO_URING 1
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Mir {
+namespace Utils {
+namespace File {
+    namespace {
+#ifndef _WIN32
+        int64_t toFileClockTicks(int64_t seconds, int64_t nanoseconds) {
+            auto system = std::chrono::sys_time<std::chrono::nanoseconds>(std::chrono::seconds(seconds) + std::chrono::nanoseconds(nanoseconds));
+            auto file = std::chrono::file_clock::from_sys(system);
+            return std::chrono::duration_cast<std::filesystem::file_time_type::duration>(file.time_since_epoch()).count();
+        }
+#endif
+    }
+
+    FileStat BatchIo::statSync(const std::filesystem::path& path) {
+        FileStat result;
+#ifdef _WIN32
+        std::error_code ec;
+        auto status = std::filesystem::status(path, ec);
+        if (ec) {
+            return result;
+        }
+        result.ok = true;
+        result.isDirectory = std::filesystem::is_directory(status);
+        result.isRegularFile = std::filesystem::is_regular_file(status);
+        if (result.isRegularFile) {
+            result.size = std::filesystem::file_size(path, ec);
+        }
+        result.modifiedTime = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+#else
+        struct stat info;
+        if (::stat(path.c_str(), &info) != 0) {
+            return result;
+        }
+        result.ok = true;
+        result.isDirectory = S_ISDIR(info.st_mode);
+        result.isRegularFile = S_ISREG(info.st_mode);
+        result.size = result.isRegularFile ? static_cast<uint64_t>(info.st_size) : 0;
+        result.modifiedTime = toFileClockTicks(info.st_mtim.tv_sec, info.st_mtim.tv_nsec);
+#endif
+        return result;
+    }
+
+    std::string BatchIo::readHeadSync(const std::filesystem::path& path, size_t maxBytes) {
+        std::string head(maxBytes, '\0');
+#ifdef _WIN32
+        std::ifstream file(path, std::ios::binary);
+        file.read(head.data(), static_cast<std::streamsize>(maxBytes));
+        head.resize(static_cast<size_t>(file.gcount()));
+#else
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return {};
+        }
+        ssize_t total = 0;
+        while (static_cast<size_t>(total) < maxBytes) {
+            ssize_t count = ::read(fd, head.data() + total, maxBytes - total);
+            if (count <= 0) {
+                break;
+            }
+            total += count;
+        }
+        ::close(fd);
+        head.resize(static_cast<size_t>(total));
+#endif
+        return head;
+    }
+
+#ifdef MIR_HAS_IO_URING
+    // Raw io_uring without liburing: the kernel header and three syscalls are all it takes
+    struct BatchIo::Ring {
+        int fd = -1;
+        unsigned entries = 0;
+
+        void* sqMemory = nullptr;
+        size_t sqMemorySize = 0;
+        void* cqMemory = nullptr;
+        size_t cqMemorySize = 0;
+        io_uring_sqe* sqes = nullptr;
+        size_t sqesSize = 0;
+
+        unsigned* sqHead = nullptr;
+        unsigned* sqTail = nullptr;
+        unsigned sqMask = 0;
+        unsigned* sqArray = nullptr;
+        unsigned* cqHead = nullptr;
+        unsigned* cqTail = nullptr;
+        unsigned cqMask = 0;
+        io_uring_cqe* cqes = nullptr;
+
+        unsigned pendingSubmit = 0;
+
+        bool open(unsigned queueDepth) {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            fd = static_cast<int>(syscall(__NR_io_uring_setup, queueDepth, &params));
+            if (fd < 0) {
+                return false; // ENOSYS on old kernels, EPERM when disabled by policy or seccomp
+            }
+            entries = params.sq_entries;
+
+            sqMemorySize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cqMemorySize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (singleMap) {
+                sqMemorySize = cqMemorySize = std::max(sqMemorySize, cqMemorySize);
+            }
+            sqMemory = mmap(nullptr, sqMemorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            if (sqMemory == MAP_FAILED) {
+                sqMemory = nullptr;
+                return false;
+            }
+            if (singleMap) {
+                cqMemory = sqMemory;
+            } else {
+                cqMemory = mmap(nullptr, cqMemorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+                if (cqMemory == MAP_FAILED) {
+                    cqMemory = nullptr;
+                    return false;
+                }
+            }
+            sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+            void* sqeMemory = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+            if (sqeMemory == MAP_FAILED) {
+                return false;
+            }
+            sqes = static_cast<io_uring_sqe*>(sqeMemory);
+
+            char* sq = static_cast<char*>(sqMemory);
+            sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+            sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            char* cq = static_cast<char*>(cqMemory);
+            cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+            return true;
+        }
+
+        ~Ring() {
+            if (sqes) {
+                munmap(sqes, sqesSize);
+            }
+            if (cqMemory && cqMemory != sqMemory) {
+                munmap(cqMemory, cqMemorySize);
+            }
+            if (sqMemory) {
+                munmap(sqMemory, sqMemorySize);
+            }
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+
+        // nullptr when the submission queue is full
+        io_uring_sqe* nextSqe() {
+            unsigned tail = *sqTail;
+            unsigned head = std::atomic_ref<unsigned>(*sqHead).load(std::memory_order_acquire);
+            if (tail - head >= entries) {
+                return nullptr;
+            }
+            unsigned index = tail & sqMask;
+            io_uring_sqe* sqe = &sqes[index];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqArray[index] = index;
+            std::atomic_ref<unsigned>(*sqTail).store(tail + 1, std::memory_order_release);
+            pendingSubmit++;
+            return sqe;
+        }
+
+        // Submits everything prepared and waits for at least waitFor completions
+        bool submitAndWait(unsigned waitFor) {
+            while (true) {
+                long result = syscall(__NR_io_uring_enter, fd, pendingSubmit, waitFor, waitFor ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+                if (result >= 0) {
+                    pendingSubmit -= std::min<unsigned>(pendingSubmit, static_cast<unsigned>(result));
+                    return true;
+                }
+                if (errno != EINTR) {
+                    return false;
+                }
+            }
+        }
+
+        template <typename Handler>
+        unsigned drain(Handler&& handler) {
+            unsigned head = *cqHead;
+            unsigned tail = std::atomic_ref<unsigned>(*cqTail).load(std::memory_order_acquire);
+            unsigned count = 0;
+            for (; head != tail; head++, count++) {
+                const io_uring_cqe& cqe = cqes[head & cqMask];
+                handler(cqe.user_data, cqe.res);
+            }
+            std::atomic_ref<unsigned>(*cqHead).store(head, std::memory_order_release);
+            return count;
+        }
+
+        // Winds the ring down after submitAndWait failed, so nothing writes into the caller's
+        // buffers once it returns. Entries the kernel never picked up are taken back, the rest
+        // are cancelled and reaped until none of the outstanding ones is left; every one of
+        // them still reaches handler once (taken back ones with -ECANCELED). False when the
+        // kernel stays unreachable, the ring and its buffers must then be leaked, not freed.
+        template <typename Handler>
+        bool quiesce(size_t outstanding, Handler&& handler) {
+            constexpr uint64_t kCancelTag = ~uint64_t(0);
+            constexpr int kMaxFailures = 1000;
+
+            unsigned tail = *sqTail;
+            for (; pendingSubmit > 0 && outstanding > 0; pendingSubmit--, outstanding--) {
+                tail--;
+                handler(sqes[tail & sqMask].user_data, -ECANCELED);
+            }
+            std::atomic_ref<unsigned>(*sqTail).store(tail, std::memory_order_release);
+
+            if (outstanding > 0) {
+                if (io_uring_sqe* sqe = nextSqe()) {
+                    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                    sqe->fd = -1;
+                    sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY; // older kernels reject it, then we just wait
+                    sqe->user_data = kCancelTag;
+                }
+            }
+
+            int failures = 0;
+            while (true) {
+                drain([&](uint64_t userData, int result) {
+                    if (userData != kCancelTag) {
+                        handler(userData, result);
+                        outstanding--;
+                    }
+                });
+                if (outstanding == 0) {
+                    return true;
+                }
+                if (!submitAndWait(1)) {
+                    if (++failures >= kMaxFailures) {
+                        return false;
+                    }
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1)); // completions still land in the CQ
+                }
+            }
+        }
+    };
+
+    BatchIo::BatchIo(unsigned queueDepth, Backend backend) {
+        if (backend == Backend::Auto) {
+            auto ring = std::make_unique<Ring>();
+            if (ring->open(queueDepth)) {
+                m_ring = std::move(ring);
+            }
+        }
+    }
+
+    BatchIo::~BatchIo() = default;
+
+    bool BatchIo::usesIoUring() const {
+        return m_ring != nullptr;
+    }
+
+    void BatchIo::stat(const std::vector<const std::filesystem::path*>& paths, std::vector<FileStat>& results) {
+        results.assign(paths.size(), FileStat{});
+        if (!m_ring) {
+            for (size_t i = 0; i < paths.size(); i++) {
+                results[i] = statSync(*paths[i]);
+            }
+            return;
+        }
+
+        // One statx buffer per slot, the slot index travels in user_data
+        std::vector<struct statx> buffers(m_ring->entries);
+        std::vector<size_t> slotRequest(m_ring->entries);
+        std::vector<unsigned> freeSlots;
+        for (unsigned slot = 0; slot < m_ring->entries; slot++) {
+            freeSlots.push_back(slot);
+        }
+
+        auto complete = [&](uint64_t userData, int result) {
+            unsigned slot = static_cast<unsigned>(userData);
+            FileStat& stat = results[slotRequest[slot]];
+            if (result == -EINVAL || result == -EOPNOTSUPP) {
+                stat = statSync(*paths[slotRequest[slot]]); // kernel without IORING_OP_STATX
+            } else if (result >= 0) {
+                const struct statx& info = buffers[slot];
+                stat.ok = true;
+                stat.isDirectory = S_ISDIR(info.stx_mode);
+                stat.isRegularFile = S_ISREG(info.stx_mode);
+                stat.size = stat.isRegularFile ? info.stx_size : 0;
+                stat.modifiedTime = toFileClockTicks(info.stx_mtime.tv_sec, info.stx_mtime.tv_nsec);
+            }
+            freeSlots.push_back(slot);
+        };
+
+        size_t next = 0;
+        size_t inFlight = 0;
+        while (next < paths.size() || inFlight > 0) {
+            while (next < paths.size() && !freeSlots.empty()) {
+                io_uring_sqe* sqe = m_ring->nextSqe();
+                if (!sqe) {
+                    break;
+                }
+                unsigned slot = freeSlots.back();
+                freeSlots.pop_back();
+                slotRequest[slot] = next;
+                sqe->opcode = IORING_OP_STATX;
+                sqe->fd = AT_FDCWD;
+                sqe->addr = reinterpret_cast<uint64_t>(paths[next]->c_str());
+                sqe->len = STATX_TYPE | STATX_SIZE | STATX_MTIME;
+                sqe->off = reinterpret_cast<uint64_t>(&buffers[slot]);
+                sqe->statx_flags = 0;
+                sqe->user_data = slot;
+                next++;
+                inFlight++;
+            }
+            if (!m_ring->submitAndWait(1)) {
+                // Ring broke down. Settle what the kernel still holds, then finish the rest the blocking way.
+                if (!m_ring->quiesce(inFlight, complete)) {
+                    static_cast<void>(new std::vector<struct statx>(std::move(buffers))); // may still be written to
+                    static_cast<void>(m_ring.release());
+                }
+                m_ring.reset();
+                for (size_t i = 0; i < paths.size(); i++) {
+                    if (!results[i].ok) {
+                        results[i] = statSync(*paths[i]);
+                    }
+                }
+                return;
+            }
+            inFlight -= m_ring->drain(complete);
+        }
+    }
+
+    void BatchIo::readHeads(const std::vector<const std::filesystem::path*>& paths, size_t maxBytes, std::vector<std::string>& results) {
+        results.assign(paths.size(), std::string());
+        if (!m_ring) {
+            for (size_t i = 0; i < paths.size(); i++) {
+                results[i] = readHeadSync(*paths[i], maxBytes);
+            }
+            return;
+        }
+
+        // Each request is a small state machine: openat -> read -> close, one ring entry at a time
+        enum class Stage : uint8_t { Open, Read, Close };
+        struct Slot {
+            size_t request = 0;
+            int fd = -1;
+            Stage stage = Stage::Open;
+        };
+        std::vector<Slot> slots(m_ring->entries);
+        std::vector<unsigned> freeSlots;
+        for (unsigned slot = 0; slot < m_ring->entries; slot++) {
+            freeSlots.push_back(slot);
+        }
+        std::vector<unsigned> ready; // slots whose next stage still needs an sqe
+
+        auto prepare = [&](unsigned index) -> bool {
+            io_uring_sqe* sqe = m_ring->nextSqe();
+            if (!sqe) {
+                return false;
+            }
+            Slot& slot = slots[index];
+            sqe->user_data = index;
+            switch (slot.stage) {
+                case Stage::Open:
+                    sqe->opcode = IORING_OP_OPENAT;
+                    sqe->fd = AT_FDCWD;
+                    sqe->addr = reinterpret_cast<uint64_t>(paths[slot.request]->c_str());
+                    sqe->open_flags = O_RDONLY | O_CLOEXEC;
+                    break;
+                case Stage::Read:
+                    sqe->opcode = IORING_OP_READ;
+                    sqe->fd = slot.fd;
+                    sqe->addr = reinterpret_cast<uint64_t>(results[slot.request].data());
+                    sqe->len = static_cast<unsigned>(maxBytes);
+                    sqe->off = 0;
+                    break;
+                case Stage::Close:
+                    sqe->opcode = IORING_OP_CLOSE;
+                    sqe->fd = slot.fd;
+                    break;
+            }
+            return true;
+        };
+
+        size_t next = 0;
+        size_t active = 0;
+        while (next < paths.size() || active > 0) {
+            while (next < paths.size() && !freeSlots.empty()) {
+                unsigned index = freeSlots.back();
+                freeSlots.pop_back();
+                slots[index] = Slot{next++, -1, Stage::Open};
+                results[slots[index].request].resize(maxBytes);
+                ready.push_back(index);
+                active++;
+            }
+            while (!ready.empty() && prepare(ready.back())) {
+                ready.pop_back();
+            }
+            if (!m_ring->submitAndWait(1)) {
+                // Leave the ring alone from here on and finish with blocking reads, once the kernel
+                // has let go of every request. Opens that still went through hand us a descriptor,
+                // closes that got cancelled leave theirs with us.
+                bool settled = m_ring->quiesce(active - ready.size(), [&](uint64_t userData, int result) {
+                    Slot& slot = slots[static_cast<unsigned>(userData)];
+                    if (slot.stage == Stage::Open && result >= 0) {
+                        slot.fd = result;
+                    } else if (slot.stage == Stage::Close && result != -ECANCELED) {
+                        slot.fd = -1;
+                    }
+                });
+                for (Slot& slot : slots) {
+                    // Without settling, a close may still run and its descriptor number be reused
+                    if (slot.fd >= 0 && (settled || slot.stage != Stage::Close)) {
+                        ::close(slot.fd);
+                    }
+                }
+                if (!settled) {
+                    static_cast<void>(new std::vector<std::string>(std::move(results))); // reads may still land
+                    static_cast<void>(m_ring.release());
+                    results.assign(paths.size(), std::string());
+                }
+                m_ring.reset();
+                for (size_t i = 0; i < paths.size(); i++) {
+                    results[i] = readHeadSync(*paths[i], maxBytes);
+                }
+                return;
+            }
+            m_ring->drain([&](uint64_t userData, int result) {
+                unsigned index = static_cast<unsigned>(userData);
+                Slot& slot = slots[index];
+                std::string& head = results[slot.request];
+                switch (slot.stage) {
+                    case Stage::Open:
+                        if (result < 0) {
+                            head.clear();
+                            freeSlots.push_back(index);
+                            active--;
+                            return;
+                        }
+                        slot.fd = result;
+                        slot.stage = Stage::Read;
+                        ready.push_back(index);
+                        return;
+                    case Stage::Read:
+                        head.resize(result < 0 ? 0 : static_cast<size_t>(result));
+                        slot.stage = Stage::Close;
+                        ready.push_back(index);
+                        return;
+                    case Stage::Close:
+                        slot.fd = -1;
+                        freeSlots.push_back(index);
+                        active--;
+                        return;
+                }
+            });
+        }
+    }
+#else
+    struct BatchIo::Ring {};
+
+    BatchIo::BatchIo(unsigned, Backend) {}
+    BatchIo::~BatchIo() = default;
+
+    bool BatchIo::usesIoUring() const {
+        return false;
+    }
+
+    void BatchIo::stat(const std::vector<const std::filesystem::path*>& paths, std::vector<FileStat>& results) {
+        results.resize(paths.size());
+        for (size_t i = 0; i < paths.size(); i++) {
+            results[i] = statSync(*paths[i]);
+        }
+    }
+
+    void BatchIo::readHeads(const std::vector<const std::filesystem::path*>& paths, size_t maxBytes, std::vector<std::string>& results) {
+        results.resize(paths.size());
+        for (size_t i = 0; i < paths.size(); i++) {
+            results[i] = readHeadSync(*paths[i], maxBytes);
+        }
+    }
+#endif
+} // namespace File
+} // namespace Utils
+} // namespace Mir
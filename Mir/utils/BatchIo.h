@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Mir {
+namespace Utils {
+namespace File {
+    struct FileStat {
+        bool ok = false;
+        bool isDirectory = false;
+        bool isRegularFile = false;
+        uint64_t size = 0;
+        int64_t modifiedTime = 0; // file clock ticks, same as FileNode::modifiedTime
+    };
+
+    // Metadata and small reads for many files at once. On Linux with MIR_ENABLE_IO_URING the
+    // requests go through an io_uring with up to queueDepth in flight, which hides per call latency
+    // on network storage. Everywhere else (or when the kernel refuses a ring) it runs the same
+    // requests one by one with the normal blocking calls. Not thread safe, use one per thread.
+    class BatchIo {
+    public:
+        enum class Backend {
+            Auto,         // io_uring when available
+            Synchronous   // always blocking calls, for comparisons
+        };
+
+        explicit BatchIo(unsigned queueDepth = 64, Backend backend = Backend::Auto);
+        ~BatchIo();
+
+        BatchIo(const BatchIo&) = delete;
+        BatchIo& operator=(const BatchIo&) = delete;
+
+        bool usesIoUring() const;
+
+        // results[i] belongs to paths[i], symlinks are followed
+        void stat(const std::vector<const std::filesystem::path*>& paths, std::vector<FileStat>& results);
+        // First maxBytes of every file (previews, sniffing, hashing heads), empty on failure
+        void readHeads(const std::vector<const std::filesystem::path*>& paths, size_t maxBytes, std::vector<std::string>& results);
+
+        // Blocking fallbacks, also used by the io_uring path for requests the kernel rejects
+        static FileStat statSync(const std::filesystem::path& path);
+        static std::string readHeadSync(const std::filesystem::path& path, size_t maxBytes);
+
+    private:
+        struct Ring;
+        std::unique_ptr<Ring> m_ring;
+    };
+} // namespace File
+} // namespace Utils
+} // namespace Mir
@@ -0,0 +1,91 @@
+#include "BufferedWriter.h"
+#include <charconv>
+#include <cstring>
+
+namespace Mir {
+namespace Utils {
+namespace File {
+    BufferedWriter::BufferedWriter(size_t bufferSize)
+        : m_file(stdout), m_buffer(std::make_unique<char[]>(bufferSize)), m_capacity(bufferSize) {}
+
+    BufferedWriter::BufferedWriter(const std::filesystem::path& filepath, size_t bufferSize)
+        : m_buffer(std::make_unique<char[]>(bufferSize)), m_capacity(bufferSize) {
+#ifdef _WIN32
+        m_file = _wfopen(filepath.c_str(), L"wb");
+#else
+        m_file = std::fopen(filepath.c_str(), "wb");
+#endif
+        m_ownsFile = m_file != nullptr;
+        m_good = m_file != nullptr;
+    }
+
+    BufferedWriter::~BufferedWriter() {
+        close();
+    }
+
+    void BufferedWriter::writeNumber(uint64_t value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        write(std::string_view(digits, result.ptr - digits));
+    }
+
+    void BufferedWriter::writeNumber(int64_t value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        write(std::string_view(digits, result.ptr - digits));
+    }
+
+    void BufferedWriter::fill(char c, size_t count) {
+        while (count > 0) {
+            if (m_used == m_capacity) {
+                flush();
+            }
+            size_t chunk = std::min(count, m_capacity - m_used);
+            std::memset(m_buffer.get() + m_used, c, chunk);
+            m_used += chunk;
+            count -= chunk;
+        }
+    }
+
+    void BufferedWriter::writeSlow(std::string_view text) {
+        flush();
+        // Anything bigger than the buffer goes straight through
+        if (text.size() >= m_capacity) {
+            if (m_file && std::fwrite(text.data(), 1, text.size(), m_file) != text.size()) {
+                m_good = false;
+            }
+            return;
+        }
+        std::memcpy(m_buffer.get(), text.data(), text.size());
+        m_used = text.size();
+    }
+
+    bool BufferedWriter::flush() {
+        if (!m_file) {
+            m_used = 0;
+            return false;
+        }
+        if (m_used > 0 && std::fwrite(m_buffer.get(), 1, m_used, m_file) != m_used) {
+            m_good = false;
+        }
+        m_used = 0;
+        if (std::fflush(m_file) != 0) {
+            m_good = false;
+        }
+        return m_good;
+    }
+
+    bool BufferedWriter::close() {
+        if (!m_file) {
+            return m_good;
+        }
+        flush();
+        if (m_ownsFile && std::fclose(m_file) != 0) {
+            m_good = false;
+        }
+        m_file = nullptr;
+        return m_good;
+    }
+} // namespace File
+} // namespace Utils
+} // namespace Mir
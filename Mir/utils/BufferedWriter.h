@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+
+namespace Mir {
+namespace Utils {
+namespace File {
+    // Append only output with one large buffer and no per line flushing, for dumps of
+    // millions of lines. Writes to a file or to stdout.
+    class BufferedWriter {
+    public:
+        static constexpr size_t kDefaultBufferSize = 1 << 20;
+
+        // Writes to stdout
+        explicit BufferedWriter(size_t bufferSize = kDefaultBufferSize);
+        explicit BufferedWriter(const std::filesystem::path& filepath, size_t bufferSize = kDefaultBufferSize);
+        ~BufferedWriter();
+
+        BufferedWriter(const BufferedWriter&) = delete;
+        BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+        bool isOpen() const { return m_file != nullptr; }
+        // False once any write failed (disk full, closed pipe)
+        bool good() const { return m_good; }
+
+        void write(std::string_view text) {
+            if (text.size() > m_capacity - m_used) {
+                writeSlow(text);
+                return;
+            }
+            std::memcpy(m_buffer.get() + m_used, text.data(), text.size());
+            m_used += text.size();
+        }
+        void put(char c) {
+            if (m_used == m_capacity) {
+                flush();
+            }
+            m_buffer[m_used++] = c;
+        }
+        void writeNumber(uint64_t value);
+        void writeNumber(int64_t value);
+        // Repeats c count times, used for indentation
+        void fill(char c, size_t count);
+
+        // Hands the buffer to the OS, returns false on error
+        bool flush();
+        bool close();
+
+    private:
+        std::FILE* m_file = nullptr;
+        bool m_ownsFile = false;
+        bool m_good = true;
+        std::unique_ptr<char[]> m_buffer;
+        size_t m_capacity = 0;
+        size_t m_used = 0;
+
+        void writeSlow(std::string_view text);
+    };
+} // namespace File
+} // namespace Utils
+} // namespace Mir
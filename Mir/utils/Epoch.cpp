@@ -0,0 +1,157 @@
+#include "Epoch.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+namespace Mir {
+namespace Epoch {
+    namespace {
+        constexpr uint64_t kIdle = std::numeric_limits<uint64_t>::max();
+        constexpr size_t kCollectEvery = 64;
+
+        // One per thread that ever entered a guard, reused after the thread exits, never freed
+        struct Slot {
+            std::atomic<uint64_t> epoch{kIdle};     // announced while inside a guard
+            std::atomic<bool> used{false};
+            Slot* next = nullptr;
+        };
+
+        struct Retired {
+            uint64_t epoch;
+            std::function<void()> deleter;
+        };
+
+        struct Domain {
+            std::atomic<uint64_t> epoch{1};
+            std::atomic<Slot*> slots{nullptr};
+            std::mutex mutex;                       // guards retired, writers only
+            std::vector<Retired> retired;
+            std::atomic<size_t> retiredCount{0};
+            std::atomic<size_t> freedCount{0};
+            std::atomic<size_t> pending{0};
+        };
+
+        // Never destroyed, worker threads may still retire while statics go away at exit
+        Domain& domain() {
+            static Domain* instance = new Domain();
+            return *instance;
+        }
+
+        Slot* acquireSlot() {
+            Domain& shared = domain();
+            for (Slot* slot = shared.slots.load(std::memory_order_acquire); slot; slot = slot->next) {
+                bool expected = false;
+                if (!slot->used.load(std::memory_order_relaxed) && slot->used.compare_exchange_strong(expected, true)) {
+                    return slot;
+                }
+            }
+            Slot* slot = new Slot();
+            slot->used.store(true, std::memory_order_relaxed);
+            Slot* head = shared.slots.load(std::memory_order_relaxed);
+            do {
+                slot->next = head;
+            } while (!shared.slots.compare_exchange_weak(head, slot, std::memory_order_release, std::memory_order_relaxed));
+            return slot;
+        }
+
+        struct ThreadState {
+            Slot* slot = nullptr;
+            int depth = 0;
+            ~ThreadState() {
+                if (slot) {
+                    slot->epoch.store(kIdle, std::memory_order_release);
+                    slot->used.store(false, std::memory_order_release);
+                }
+            }
+        };
+        thread_local ThreadState t_state;
+    }
+
+    ReadGuard::ReadGuard() {
+        if (t_state.depth++ > 0) {
+            return;
+        }
+        if (!t_state.slot) {
+            t_state.slot = acquireSlot();
+        }
+        // A read-modify-write, so when collect() scanned this slot first the exchange reads from
+        // its scan and every unlink before that scan is visible to the loads of this guard
+        t_state.slot->epoch.exchange(domain().epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    }
+
+    ReadGuard::~ReadGuard() {
+        if (--t_state.depth == 0) {
+            t_state.slot->epoch.store(kIdle, std::memory_order_release);
+        }
+    }
+
+    void retireWith(std::function<void()> deleter) {
+        Domain& shared = domain();
+        // Guards that read the epoch after this increment synchronize with it and can't reach the
+        // object anymore, the writer unlinked it before calling retire
+        uint64_t epoch = shared.epoch.fetch_add(1, std::memory_order_seq_cst);
+        {
+            std::lock_guard lock(shared.mutex);
+            shared.retired.push_back({epoch, std::move(deleter)});
+        }
+        shared.retiredCount.fetch_add(1, std::memory_order_relaxed);
+        if (shared.pending.fetch_add(1, std::memory_order_relaxed) + 1 >= kCollectEvery) {
+            collect();
+        }
+    }
+
+    size_t collect() {
+        Domain& shared = domain();
+        if (shared.pending.load(std::memory_order_relaxed) == 0) {
+            return 0;
+        }
+        // Only objects retired before this point are considered. Each slot is read with a
+        // read-modify-write: a guard announcing after it synchronizes with it (see ReadGuard),
+        // one announcing before it shows up in oldest.
+        uint64_t current = shared.epoch.load(std::memory_order_seq_cst);
+        uint64_t oldest = current;
+        for (Slot* slot = shared.slots.load(std::memory_order_acquire); slot; slot = slot->next) {
+            oldest = std::min(oldest, slot->epoch.fetch_add(0, std::memory_order_seq_cst));
+        }
+
+        std::vector<std::function<void()>> ready;
+        {
+            std::lock_guard lock(shared.mutex);
+            auto keep = shared.retired.begin();
+            for (auto it = shared.retired.begin(); it != shared.retired.end(); ++it) {
+                if (it->epoch < oldest) {
+                    ready.push_back(std::move(it->deleter));
+                } else {
+                    if (keep != it) {
+                        *keep = std::move(*it);
+                    }
+                    ++keep;
+                }
+            }
+            shared.retired.erase(keep, shared.retired.end());
+        }
+        // Outside the lock, deleting a big subtree takes a while
+        for (auto& deleter : ready) {
+            deleter();
+        }
+        shared.pending.fetch_sub(ready.size(), std::memory_order_relaxed);
+        shared.freedCount.fetch_add(ready.size(), std::memory_order_relaxed);
+        return ready.size();
+    }
+
+    Stats getStats() {
+        Domain& shared = domain();
+        Stats stats;
+        stats.retired = shared.retiredCount.load(std::memory_order_relaxed);
+        stats.freed = shared.freedCount.load(std::memory_order_relaxed);
+        stats.pending = shared.pending.load(std::memory_order_relaxed);
+        for (Slot* slot = shared.slots.load(std::memory_order_acquire); slot; slot = slot->next) {
+            stats.readers += slot->used.load(std::memory_order_relaxed) ? 1 : 0;
+        }
+        return stats;
+    }
+} // namespace Epoch
+} // namespace Mir
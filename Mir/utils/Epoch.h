@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+// Epoch based reclamation for data that is read without locks. Readers wrap their reads in a
+// ReadGuard (a couple of atomic stores, no lock, nestable). A writer that unlinks something hands
+// it to retire() instead of deleting it, it is destroyed once no guard that could still see it is
+// left. Guards should be short (a frame, one walk), a guard that never ends keeps everything
+// retired after it alive.
+//
+//   {
+//       Mir::Epoch::ReadGuard guard;
+//       for (FileNode* child : node->readChildren()) { ... }   // valid until the guard ends
+//   }
+//
+//   node->publishChildren();                                   // writer, retires the old list
+namespace Mir {
+namespace Epoch {
+    class ReadGuard {
+    public:
+        ReadGuard();
+        ~ReadGuard();
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+    };
+
+    struct Stats {
+        size_t retired = 0;     // since start
+        size_t freed = 0;
+        size_t pending = 0;
+        size_t readers = 0;     // threads that used a guard and are still running
+    };
+
+    // Thread safe. Runs deleter on whichever thread collects, once no guard can see the object.
+    void retireWith(std::function<void()> deleter);
+
+    // Takes ownership of object (a unique_ptr, a vector of them, a raw pointer's owner...)
+    template<typename T>
+    void retire(T&& object) {
+        auto* owned = new std::decay_t<T>(std::forward<T>(object));
+        retireWith([owned]() { delete owned; });
+    }
+
+    // Frees what no guard can reach anymore, returns how many objects were freed. retire()
+    // collects on its own every so often, owners call it once a frame so memory does not linger.
+    size_t collect();
+    Stats getStats();
+} // namespace Epoch
+} // namespace Mir
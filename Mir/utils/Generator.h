@@ -0,0 +1,124 @@
+#pragma once
+// Mir::Generator<Ref> is std::generator<Ref> where the standard library has it (C++23 <generator>).
+// Older libraries (GCC 12, Clang with libstdc++ 12) get a minimal stand-in with the same usage:
+//
+//   Mir::Generator<const Entry&> entries() { Entry e; ... co_yield e; }
+//   for (const Entry& e : entries()) { if (done) break; }
+//
+// The stand-in only covers what the walkers need: co_yield of lvalues/temporaries, range-for,
+// early break (destroys the frame) and exceptions rethrown to the consumer. No elements_of.
+#if __has_include(<version>)
+#include <version>
+#endif
+
+#if defined(__cpp_lib_generator) && __cpp_lib_generator >= 202207L
+#include <generator>
+
+namespace Mir {
+    template <typename Ref>
+    using Generator = std::generator<Ref>;
+} // namespace Mir
+
+#else
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace Mir {
+    template <typename Ref>
+    class Generator {
+    public:
+        using value_type = std::remove_cvref_t<Ref>;
+        using reference = std::conditional_t<std::is_reference_v<Ref>, Ref, Ref&&>;
+
+        struct promise_type {
+            std::add_pointer_t<reference> current = nullptr;
+            std::exception_ptr exception;
+
+            Generator get_return_object() { return Generator(std::coroutine_handle<promise_type>::from_promise(*this)); }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            // Temporaries live until the consumer resumes, so storing their address is fine
+            std::suspend_always yield_value(std::remove_reference_t<reference>& value) noexcept {
+                current = std::addressof(value);
+                return {};
+            }
+            std::suspend_always yield_value(std::remove_reference_t<reference>&& value) noexcept {
+                current = std::addressof(value);
+                return {};
+            }
+            void return_void() noexcept {}
+            void unhandled_exception() { exception = std::current_exception(); }
+
+            template <typename U>
+            std::suspend_never await_transform(U&&) = delete; // generators cannot co_await
+        };
+
+        class iterator {
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using difference_type = std::ptrdiff_t;
+            using value_type = Generator::value_type;
+
+            iterator() = default;
+            explicit iterator(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+
+            iterator& operator++() {
+                m_handle.resume();
+                rethrowIfFailed(m_handle);
+                return *this;
+            }
+            void operator++(int) { ++*this; }
+            reference operator*() const { return static_cast<reference>(*m_handle.promise().current); }
+            bool operator==(std::default_sentinel_t) const { return !m_handle || m_handle.done(); }
+
+        private:
+            std::coroutine_handle<promise_type> m_handle;
+        };
+
+        Generator(Generator&& other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+        Generator& operator=(Generator&& other) noexcept {
+            if (this != &other) {
+                destroy();
+                m_handle = std::exchange(other.m_handle, {});
+            }
+            return *this;
+        }
+        Generator(const Generator&) = delete;
+        Generator& operator=(const Generator&) = delete;
+        ~Generator() { destroy(); }
+
+        // Single pass, like std::generator
+        iterator begin() {
+            if (m_handle) {
+                m_handle.resume();
+                rethrowIfFailed(m_handle);
+            }
+            return iterator(m_handle);
+        }
+        std::default_sentinel_t end() const noexcept { return {}; }
+
+    private:
+        std::coroutine_handle<promise_type> m_handle;
+
+        explicit Generator(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+
+        void destroy() {
+            if (m_handle) {
+                m_handle.destroy();
+                m_handle = {};
+            }
+        }
+
+        static void rethrowIfFailed(std::coroutine_handle<promise_type> handle) {
+            if (handle.done() && handle.promise().exception) {
+                std::rethrow_exception(std::exchange(handle.promise().exception, {}));
+            }
+        }
+    };
+} // namespace Mir
+#endif
@@ -0,0 +1,286 @@
+#include "IoScheduler.h"
+#include <algorithm>
+#include <iterator>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Mir {
+    namespace {
+        // Speculative jobs should only get the disk when nobody else wants it
+        class BackgroundIoScope {
+        public:
+            explicit BackgroundIoScope(bool enabled) : m_enabled(enabled) {
+                if (!m_enabled) {
+                    return;
+                }
+#ifdef _WIN32
+                // Lowers both CPU and I/O priority of the thread
+                SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+#elif defined(__linux__) && defined(SYS_ioprio_set)
+                // IOPRIO_WHO_PROCESS with 0 = calling thread, class idle
+                m_previous = static_cast<int>(syscall(SYS_ioprio_get, 1, 0));
+                syscall(SYS_ioprio_set, 1, 0, 3 << 13);
+#endif
+            }
+            ~BackgroundIoScope() {
+                if (!m_enabled) {
+                    return;
+                }
+#ifdef _WIN32
+                SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+#elif defined(__linux__) && defined(SYS_ioprio_set)
+                if (m_previous >= 0) {
+                    syscall(SYS_ioprio_set, 1, 0, m_previous);
+                }
+#endif
+            }
+
+        private:
+            bool m_enabled;
+            [[maybe_unused]] int m_previous = -1;
+        };
+
+        double elapsedMs(std::chrono::steady_clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+
+    IoScheduler::IoScheduler(size_t threadCount) {
+        threadCount = std::max<size_t>(threadCount, 1);
+        m_workers.reserve(threadCount);
+        for (size_t i = 0; i < threadCount; i++) {
+            m_workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    IoScheduler::~IoScheduler() {
+        // Queued work is finished first, like ThreadPool, owners wait for their own jobs anyway
+        waitIdle();
+        {
+            std::lock_guard lock(m_mutex);
+            m_stopping = true;
+        }
+        m_workAvailable.notify_all();
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    IoScheduler& IoScheduler::shared() {
+        static IoScheduler scheduler;
+        return scheduler;
+    }
+
+    IoScheduler::DeviceId IoScheduler::deviceOf(const std::filesystem::path& path) {
+#ifdef _WIN32
+        return std::hash<std::filesystem::path::string_type>{}(path.root_name().native());
+#else
+        std::filesystem::path current = path;
+        while (true) {
+            struct stat info;
+            if (::stat(current.c_str(), &info) == 0) {
+                return static_cast<DeviceId>(info.st_dev);
+            }
+            if (!current.has_relative_path()) {
+                return 0;
+            }
+            current = current.parent_path();
+        }
+#endif
+    }
+
+    void IoScheduler::submit(const std::filesystem::path& path, IoPriority priority, Job job) {
+        submit(deviceOf(path), priority, std::move(job));
+    }
+
+    void IoScheduler::submit(DeviceId deviceId, IoPriority priority, Job job) {
+        {
+            std::lock_guard lock(m_mutex);
+            Device& device = m_devices[deviceId];
+            if (device.limit == 0) {
+                device.limit = std::clamp(m_limits.initialConcurrency, m_limits.minConcurrency, m_limits.maxConcurrency);
+            }
+            device.queues[static_cast<size_t>(priority)].push_back(std::move(job));
+            m_queued++;
+        }
+        m_workAvailable.notify_one();
+    }
+
+    void IoScheduler::waitIdle() {
+        std::unique_lock lock(m_mutex);
+        m_idle.wait(lock, [this] { return m_queued == 0 && m_running == 0; });
+    }
+
+    IoScheduler::Foreground::Foreground(IoScheduler& scheduler, const std::filesystem::path& path)
+        : m_scheduler(scheduler), m_device(deviceOf(path)), m_start(std::chrono::steady_clock::now()) {
+        std::lock_guard lock(m_scheduler.m_mutex);
+        Device& device = m_scheduler.m_devices[m_device];
+        if (device.limit == 0) {
+            device.limit = std::clamp(m_scheduler.m_limits.initialConcurrency, m_scheduler.m_limits.minConcurrency, m_scheduler.m_limits.maxConcurrency);
+        }
+        device.foreground++;
+    }
+
+    IoScheduler::Foreground::~Foreground() {
+        {
+            std::lock_guard lock(m_scheduler.m_mutex);
+            Device& device = m_scheduler.m_devices[m_device];
+            device.foreground--;
+            m_scheduler.recordLocked(device, elapsedMs(m_start), m_operations);
+        }
+        m_scheduler.m_workAvailable.notify_all();
+    }
+
+    void IoScheduler::setLimits(const Limits& limits) {
+        {
+            std::lock_guard lock(m_mutex);
+            m_limits = limits;
+            m_limits.minConcurrency = std::max<size_t>(m_limits.minConcurrency, 1);
+            m_limits.maxConcurrency = std::max(m_limits.maxConcurrency, m_limits.minConcurrency);
+            for (auto& [id, device] : m_devices) {
+                device.limit = std::clamp(device.limit, m_limits.minConcurrency, m_limits.maxConcurrency);
+            }
+        }
+        m_workAvailable.notify_all();
+    }
+
+    IoScheduler::Limits IoScheduler::getLimits() const {
+        std::lock_guard lock(m_mutex);
+        return m_limits;
+    }
+
+    std::vector<IoScheduler::DeviceStats> IoScheduler::getStats() const {
+        std::lock_guard lock(m_mutex);
+        std::vector<DeviceStats> stats;
+        stats.reserve(m_devices.size());
+        for (const auto& [id, device] : m_devices) {
+            DeviceStats entry;
+            entry.device = id;
+            entry.limit = device.limit;
+            entry.running = device.running;
+            for (const auto& queue : device.queues) {
+                entry.queued += queue.size();
+            }
+            entry.completed = device.completed;
+            entry.latencyMs = device.latencyMs;
+            entry.baselineMs = device.baselineMs;
+            stats.push_back(entry);
+        }
+        return stats;
+    }
+
+    bool IoScheduler::takeLocked(Job& job, DeviceId& deviceId, IoPriority& priority) {
+        if (m_queued == 0 || m_devices.empty()) {
+            return false;
+        }
+        size_t start = m_rotation++ % m_devices.size();
+        for (size_t level = 0; level < kPriorityCount; level++) {
+            auto it = std::next(m_devices.begin(), static_cast<std::ptrdiff_t>(start));
+            for (size_t i = 0; i < m_devices.size(); i++, ++it) {
+                if (it == m_devices.end()) {
+                    it = m_devices.begin();
+                }
+                Device& device = it->second;
+                auto& queue = device.queues[level];
+                if (queue.empty()) {
+                    continue;
+                }
+                bool speculative = level == static_cast<size_t>(IoPriority::Speculative);
+                size_t limit = device.limit;
+                if (speculative) {
+                    if (device.foreground > 0) {
+                        continue;
+                    }
+                    // One slot stays free for whatever the user asks for next. At limit 1 that
+                    // leaves none, then a single one may run while the device is otherwise idle.
+                    limit = std::max<size_t>(limit - 1, 1);
+                } else {
+                    // The reserved slot: speculative jobs never hold all of them, at limit 1
+                    // this lets the user's job run next to the one speculative job
+                    limit = std::max(limit, device.speculative + 1);
+                }
+                if (device.running >= limit) {
+                    device.saturated = true;
+                    continue;
+                }
+                job = std::move(queue.front());
+                queue.pop_front();
+                device.running++;
+                device.speculative += speculative ? 1 : 0;
+                deviceId = it->first;
+                priority = static_cast<IoPriority>(level);
+                m_queued--;
+                m_running++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void IoScheduler::recordLocked(Device& device, double elapsedMs, size_t operations) {
+        device.completed++;
+        if (operations == 0) {
+            return; // cancelled or skipped, its time says nothing about the disk
+        }
+        double latencyMs = elapsedMs / static_cast<double>(operations);
+        device.latencyMs = device.latencyMs == 0 ? latencyMs : device.latencyMs * 0.8 + latencyMs * 0.2;
+        device.baselineMs = device.baselineMs == 0 ? latencyMs : std::min(latencyMs, device.baselineMs * 1.02);
+
+        // One decision per round of limit jobs, so the average has time to react to the last one
+        if (++device.sinceAdjust < device.limit) {
+            return;
+        }
+        device.sinceAdjust = 0;
+        if (device.latencyMs > device.baselineMs * m_limits.latencyTolerance) {
+            device.limit = std::max(m_limits.minConcurrency, std::min(device.limit - 1, device.limit * 3 / 4));
+        } else if (device.saturated) {
+            device.limit = std::min(m_limits.maxConcurrency, device.limit + 1);
+        }
+        device.saturated = false;
+    }
+
+    void IoScheduler::workerLoop() {
+        while (true) {
+            Job job;
+            DeviceId deviceId = 0;
+            IoPriority priority = IoPriority::Normal;
+            {
+                std::unique_lock lock(m_mutex);
+                m_workAvailable.wait(lock, [&] { return m_stopping || takeLocked(job, deviceId, priority); });
+                if (!job) {
+                    return;
+                }
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            size_t operations;
+            {
+                BackgroundIoScope background(priority == IoPriority::Speculative);
+                operations = job();
+            }
+            double elapsed = elapsedMs(start);
+
+            {
+                std::lock_guard lock(m_mutex);
+                Device& device = m_devices[deviceId];
+                device.running--;
+                device.speculative -= priority == IoPriority::Speculative ? 1 : 0;
+                recordLocked(device, elapsed, operations);
+                m_running--;
+                if (m_queued == 0 && m_running == 0) {
+                    m_idle.notify_all();
+                }
+            }
+            // A finished job may free room on a device other workers are waiting for
+            m_workAvailable.notify_all();
+        }
+    }
+} // namespace Mir
@@ -0,0 +1,128 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Mir {
+    // Lower value wins. Within one priority jobs run in submission order.
+    enum class IoPriority : uint8_t {
+        Visible,        // rows on screen, the open preview
+        Normal,         // asked for by the user but scrolled away
+        Speculative     // prefetching, runs at idle I/O priority and only when a device has spare room
+    };
+
+    // Shared workers for disk bound jobs, grouped by the device the job's path lives on.
+    // Every device gets its own concurrency limit that adapts to the latency of its I/O operations:
+    // while latency stays near the best seen, the limit grows when work is waiting, once the disk
+    // is saturated and latency climbs it shrinks again. An NVMe drive ends up with many jobs in
+    // flight, a spinning disk or a slow share with one or two, and a busy network mount never
+    // holds up scans of the local disk.
+    //
+    //   Mir::IoScheduler::shared().submit(folder, Mir::IoPriority::Visible, [folder] { return scan(folder); });
+    class IoScheduler {
+    public:
+        // Returns the I/O operations it did (entries listed, files opened). Latency is tracked per
+        // operation, a job over a huge folder is not a slow disk. 0 (cancelled) leaves it alone.
+        using Job = std::function<size_t()>;
+        using DeviceId = uint64_t;
+
+        struct Limits {
+            size_t minConcurrency = 1;
+            size_t maxConcurrency = 16;
+            size_t initialConcurrency = 4;
+            double latencyTolerance = 2.0;  // shrink once average latency is this many times the baseline
+        };
+
+        struct DeviceStats {
+            DeviceId device = 0;
+            size_t limit = 0;
+            size_t running = 0;
+            size_t queued = 0;
+            size_t completed = 0;
+            double latencyMs = 0;   // per operation, moving average
+            double baselineMs = 0;  // best seen, drifts up slowly so one lucky job does not stick
+        };
+
+        // threadCount caps the total over all devices
+        explicit IoScheduler(size_t threadCount = 16);
+        ~IoScheduler();
+
+        IoScheduler(const IoScheduler&) = delete;
+        IoScheduler& operator=(const IoScheduler&) = delete;
+
+        // The one used by FileTree and DirectoryPrefetcher, so limits cover all their work together
+        static IoScheduler& shared();
+        // st_dev on POSIX, the drive or server name on Windows. Falls back to the parent for paths
+        // that do not exist (yet).
+        static DeviceId deviceOf(const std::filesystem::path& path);
+
+        void submit(const std::filesystem::path& path, IoPriority priority, Job job);
+        void submit(DeviceId device, IoPriority priority, Job job);
+        // Blocks until nothing is queued or running
+        void waitIdle();
+
+        // Marks I/O the UI thread does itself (opening a preview): speculative jobs on the same
+        // device wait until the scope ends, and its duration feeds the device's latency
+        class Foreground {
+        public:
+            Foreground(IoScheduler& scheduler, const std::filesystem::path& path);
+            explicit Foreground(const std::filesystem::path& path) : Foreground(shared(), path) {}
+            ~Foreground();
+            Foreground(const Foreground&) = delete;
+            Foreground& operator=(const Foreground&) = delete;
+
+            // Operations the scope did, 1 unless told otherwise
+            void setOperations(size_t operations) { m_operations = operations; }
+
+        private:
+            IoScheduler& m_scheduler;
+            DeviceId m_device;
+            std::chrono::steady_clock::time_point m_start;
+            size_t m_operations = 1;
+        };
+
+        void setLimits(const Limits& limits);
+        Limits getLimits() const;
+        std::vector<DeviceStats> getStats() const;
+
+    private:
+        static constexpr size_t kPriorityCount = 3;
+
+        struct Device {
+            std::deque<Job> queues[kPriorityCount];
+            size_t limit = 0;
+            size_t running = 0;
+            size_t speculative = 0;     // of running
+            size_t foreground = 0;
+            size_t completed = 0;
+            size_t sinceAdjust = 0;
+            double latencyMs = 0;      // per operation
+            double baselineMs = 0;
+            bool saturated = false;     // work was waiting on the limit since the last adjustment
+        };
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_workAvailable;
+        std::condition_variable m_idle;
+        std::unordered_map<DeviceId, Device> m_devices;
+        Limits m_limits;
+        size_t m_queued = 0;
+        size_t m_running = 0;
+        size_t m_rotation = 0;      // devices take turns within a priority
+        bool m_stopping = false;
+        std::vector<std::thread> m_workers;
+
+        void workerLoop();
+        // Highest priority job of any device with room, under the lock
+        bool takeLocked(Job& job, DeviceId& device, IoPriority& priority);
+        void recordLocked(Device& device, double elapsedMs, size_t operations);
+    };
+} // namespace Mir
@@ -0,0 +1,124 @@
+#include "LineIndex.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIR_LINE_INDEX_SSE2 1
+#endif
+
+namespace Mir {
+namespace Utils {
+namespace File {
+    void LineIndex::findNewlines(std::string_view text, size_t base, std::vector<size_t>& out) {
+        const char* data = text.data();
+        size_t size = text.size();
+        size_t i = 0;
+#ifdef MIR_LINE_INDEX_SSE2
+        // 32 bytes per round, one compare and movemask per half, set bits are the newlines
+        const __m128i newline = _mm_set1_epi8('\n');
+        for (; i + 32 <= size; i += 32) {
+            __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 16));
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(low, newline)))
+                | static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(high, newline))) << 16;
+            while (mask != 0) {
+                out.push_back(base + i + static_cast<size_t>(std::countr_zero(mask)));
+                mask &= mask - 1;
+            }
+        }
+#endif
+        // Tail, or everything without SSE2, memchr is vectorized by the libc there
+        while (i < size) {
+            const void* found = std::memchr(data + i, '\n', size - i);
+            if (!found) {
+                break;
+            }
+            i = static_cast<size_t>(static_cast<const char*>(found) - data);
+            out.push_back(base + i);
+            i++;
+        }
+    }
+
+    bool LineIndex::open(const std::filesystem::path& filepath, size_t threadCount) {
+        MIR_PROFILE_SCOPE("LineIndex::open");
+        close();
+        if (!m_file.open(filepath)) {
+            return false;
+        }
+        m_text = m_file.view();
+        build(threadCount);
+        return true;
+    }
+
+    void LineIndex::assign(std::string_view text, size_t threadCount) {
+        close();
+        m_text = text;
+        build(threadCount);
+    }
+
+    void LineIndex::close() {
+        m_file.close();
+        m_text = {};
+        m_ends.clear();
+    }
+
+    std::string_view LineIndex::operator[](size_t index) const {
+        size_t start = index == 0 ? 0 : m_ends[index - 1] + 1;
+        size_t end = m_ends[index];
+        if (end > start && m_text[end - 1] == '\r') {
+            end--;
+        }
+        return m_text.substr(start, end - start);
+    }
+
+    void LineIndex::build(size_t threadCount) {
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        size_t chunks = std::min(threadCount, m_text.size() / kMinChunkBytes);
+        if (m_text.size() < kParallelBytes || chunks < 2) {
+            // Rough guess of 64 bytes a line saves most regrowth on typical text
+            m_ends.reserve(m_text.size() / 64 + 1);
+            findNewlines(m_text, 0, m_ends);
+        } else {
+            // Every chunk finds its newlines on its own, the parts are joined in order
+            std::vector<std::vector<size_t>> parts(chunks);
+            size_t perChunk = (m_text.size() + chunks - 1) / chunks;
+            {
+                Mir::ThreadPool pool(chunks);
+                for (size_t chunk = 0; chunk < chunks; chunk++) {
+                    pool.submit([this, &parts, chunk, perChunk]() {
+                        size_t first = chunk * perChunk;
+                        std::string_view part = m_text.substr(first, std::min(perChunk, m_text.size() - first));
+                        parts[chunk].reserve(part.size() / 64 + 1);
+                        findNewlines(part, first, parts[chunk]);
+                    });
+                }
+                pool.waitIdle();
+            }
+            size_t total = 0;
+            for (const auto& part : parts) {
+                total += part.size();
+            }
+            m_ends.reserve(total + 1);
+            for (const auto& part : parts) {
+                m_ends.insert(m_ends.end(), part.begin(), part.end());
+            }
+        }
+        // Like getline, text after the last newline is a line, an empty remainder is not
+        if (!m_text.empty() && m_text.back() != '\n') {
+            m_ends.push_back(m_text.size());
+        }
+        // Only a far off guess is worth the copy
+        if (m_ends.capacity() > 2 * m_ends.size() + 1024) {
+            m_ends.shrink_to_fit();
+        }
+    }
+} // namespace File
+} // namespace Utils
+} // namespace Mir
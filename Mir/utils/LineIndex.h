@@ -0,0 +1,93 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <iterator>
+#include <string_view>
+#include <vector>
+
+#include "MappedFile.h"
+
+namespace Mir {
+namespace Utils {
+namespace File {
+    // Lines of a file without copying them: the file is mapped, newlines are found 32 bytes at a
+    // time and only their offsets are kept (8 bytes a line instead of a std::string each).
+    // Same lines as readLines: split on '\n', one trailing '\r' dropped, no empty line after a
+    // final newline.
+    //
+    //   Mir::Utils::File::LineIndex lines;
+    //   if (lines.open(path)) {
+    //       for (std::string_view line : lines) { ... }
+    //       std::string_view tenth = lines[9];
+    //   }
+    //
+    // Views stay valid until the index is reopened, closed or destroyed.
+    class LineIndex {
+    public:
+        LineIndex() = default;
+        explicit LineIndex(const std::filesystem::path& filepath, size_t threadCount = 0) { open(filepath, threadCount); }
+
+        LineIndex(LineIndex&&) noexcept = default;
+        LineIndex& operator=(LineIndex&&) noexcept = default;
+
+        // Files from kParallelBytes up are indexed in chunks on threadCount threads (0 = hardware
+        // concurrency, 1 = this thread only)
+        bool open(const std::filesystem::path& filepath, size_t threadCount = 0);
+        // Indexes text owned by the caller, e.g. a file already in memory
+        void assign(std::string_view text, size_t threadCount = 0);
+        void close();
+
+        size_t size() const { return m_ends.size(); }
+        bool empty() const { return m_ends.empty(); }
+        std::string_view operator[](size_t index) const;
+        std::string_view getText() const { return m_text; }
+
+        // Pushes base + offset of every '\n' in text to out, in order
+        static void findNewlines(std::string_view text, size_t base, std::vector<size_t>& out);
+
+        class Iterator {
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = std::string_view;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = std::string_view;
+
+            Iterator() = default;
+            Iterator(const LineIndex* index, size_t line) : m_index(index), m_line(line) {}
+            std::string_view operator*() const { return (*m_index)[m_line]; }
+            std::string_view operator[](difference_type n) const { return (*m_index)[m_line + n]; }
+            Iterator& operator++() { m_line++; return *this; }
+            Iterator operator++(int) { Iterator copy = *this; m_line++; return copy; }
+            Iterator& operator--() { m_line--; return *this; }
+            Iterator operator--(int) { Iterator copy = *this; m_line--; return copy; }
+            Iterator& operator+=(difference_type n) { m_line += n; return *this; }
+            Iterator& operator-=(difference_type n) { m_line -= n; return *this; }
+            Iterator operator+(difference_type n) const { return Iterator(m_index, m_line + n); }
+            Iterator operator-(difference_type n) const { return Iterator(m_index, m_line - n); }
+            friend Iterator operator+(difference_type n, const Iterator& it) { return it + n; }
+            difference_type operator-(const Iterator& other) const { return static_cast<difference_type>(m_line - other.m_line); }
+            bool operator==(const Iterator& other) const { return m_line == other.m_line; }
+            auto operator<=>(const Iterator& other) const { return m_line <=> other.m_line; }
+
+        private:
+            const LineIndex* m_index = nullptr;
+            size_t m_line = 0;
+        };
+
+        Iterator begin() const { return Iterator(this, 0); }
+        Iterator end() const { return Iterator(this, size()); }
+
+    private:
+        MappedFile m_file;
+        std::string_view m_text;
+        std::vector<size_t> m_ends;     // end of every line: its '\n', or the text size for an unterminated last line
+        // Below this a single scan beats starting threads
+        static constexpr size_t kParallelBytes = 16 * 1024 * 1024;
+        static constexpr size_t kMinChunkBytes = 4 * 1024 * 1024;
+
+        void build(size_t threadCount);
+    };
+} // namespace File
+} // namespace Utils
+} // namespace Mir
@@ -0,0 +1,139 @@
+#include "MappedFile.h"
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Mir {
+namespace Utils {
+namespace File {
+    MappedFile::MappedFile(MappedFile&& other) noexcept {
+        swap(other);
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            swap(other);
+        }
+        return *this;
+    }
+
+    void MappedFile::swap(MappedFile& other) noexcept {
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        std::swap(m_isOpen, other.m_isOpen);
+#ifdef _WIN32
+        std::swap(m_file, other.m_file);
+        std::swap(m_mapping, other.m_mapping);
+#else
+        std::swap(m_fd, other.m_fd);
+#endif
+    }
+
+#ifdef _WIN32
+    bool MappedFile::open(const std::filesystem::path& filepath) {
+        close();
+        HANDLE file = CreateFileW(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                  nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            CloseHandle(file);
+            return false;
+        }
+        m_file = file;
+        m_size = static_cast<size_t>(fileSize.QuadPart);
+        m_isOpen = true;
+
+        // Zero sized files cannot be mapped, they are just empty views
+        if (m_size == 0) {
+            return true;
+        }
+
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            close();
+            return false;
+        }
+        m_mapping = mapping;
+        m_data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!m_data) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void MappedFile::close() {
+        if (m_data) {
+            UnmapViewOfFile(m_data);
+        }
+        if (m_mapping) {
+            CloseHandle(static_cast<HANDLE>(m_mapping));
+        }
+        if (m_file) {
+            CloseHandle(static_cast<HANDLE>(m_file));
+        }
+        m_data = nullptr;
+        m_mapping = nullptr;
+        m_file = nullptr;
+        m_size = 0;
+        m_isOpen = false;
+    }
+#else
+    bool MappedFile::open(const std::filesystem::path& filepath) {
+        close();
+        int fd = ::open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            ::close(fd);
+            return false;
+        }
+        m_fd = fd;
+        m_size = static_cast<size_t>(st.st_size);
+        m_isOpen = true;
+
+        if (m_size == 0) {
+            return true;
+        }
+
+        void* addr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            close();
+            return false;
+        }
+        madvise(addr, m_size, MADV_SEQUENTIAL);
+        m_data = static_cast<const char*>(addr);
+        return true;
+    }
+
+    void MappedFile::close() {
+        if (m_data) {
+            munmap(const_cast<char*>(m_data), m_size);
+        }
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+        m_data = nullptr;
+        m_fd = -1;
+        m_size = 0;
+        m_isOpen = false;
+    }
+#endif
+} // namespace File
+} // namespace Utils
+} // namespace Mir
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+namespace Mir {
+namespace Utils {
+namespace File {
+    // Read-only memory mapping of a whole file. Move only.
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        explicit MappedFile(const std::filesystem::path& filepath) { open(filepath); }
+        ~MappedFile() { close(); }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        bool open(const std::filesystem::path& filepath);
+        void close();
+
+        bool isOpen() const { return m_isOpen; }
+        const char* data() const { return m_data; }
+        size_t size() const { return m_size; }
+        std::string_view view() const { return {m_data, m_size}; }
+
+    private:
+        const char* m_data = nullptr;
+        size_t m_size = 0;
+        bool m_isOpen = false;
+#ifdef _WIN32
+        void* m_file = nullptr;
+        void* m_mapping = nullptr;
+#else
+        int m_fd = -1;
+#endif
+        void swap(MappedFile& other) noexcept;
+    };
+} // namespace File
+} // namespace Utils
+} // namespace Mir
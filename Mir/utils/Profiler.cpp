@@ -0,0 +1,193 @@
+#include "Profiler.h"
+#ifdef MIR_ENABLE_PROFILER
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace Mir {
+namespace Profiler {
+    namespace {
+        constexpr size_t kRingCapacity = size_t(1) << 16;
+        constexpr size_t kFrameHistory = 240;
+
+        // Fields are relaxed atomics so a reader racing the writer near the wrap point reads
+        // a stale event instead of invoking UB. On x86 these are plain moves.
+        struct Slot {
+            std::atomic<const char*> name{nullptr};
+            std::atomic<int64_t> startNs{0};
+            std::atomic<int64_t> durationNs{0};
+        };
+
+        struct ThreadBuffer {
+            std::unique_ptr<Slot[]> slots = std::make_unique<Slot[]>(kRingCapacity);
+            std::atomic<uint64_t> head{0};
+            uint32_t threadId = 0;
+            bool inUse = true;  // guarded by the registry mutex
+        };
+
+        struct Registry {
+            std::mutex mutex;
+            std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        };
+
+        // Never destroyed, threads may still record or exit while statics go away
+        Registry& registry() {
+            static Registry* instance = new Registry();
+            return *instance;
+        }
+
+        const std::chrono::steady_clock::time_point& epoch() {
+            static const auto start = std::chrono::steady_clock::now();
+            return start;
+        }
+
+        // Returns the buffer to the registry when its thread exits
+        struct BufferLease {
+            std::shared_ptr<ThreadBuffer> buffer;
+            ~BufferLease() {
+                auto& reg = registry();
+                std::lock_guard lock(reg.mutex);
+                buffer->inUse = false;
+            }
+        };
+
+        ThreadBuffer& threadBuffer() {
+            // Buffers outlive their thread so events of finished workers can still be exported.
+            // A new thread takes over the buffer (and thread id) of a finished one, so the short
+            // lived std::async threads of file operations and diffs do not add a ring each.
+            thread_local BufferLease lease{[] {
+                auto& reg = registry();
+                std::lock_guard lock(reg.mutex);
+                for (const auto& buffer : reg.buffers) {
+                    if (!buffer->inUse) {
+                        buffer->inUse = true;
+                        return buffer;
+                    }
+                }
+                auto created = std::make_shared<ThreadBuffer>();
+                created->threadId = static_cast<uint32_t>(reg.buffers.size() + 1);
+                reg.buffers.push_back(created);
+                return created;
+            }()};
+            return *lease.buffer;
+        }
+
+        // Only touched by the render thread
+        struct FrameHistory {
+            std::array<float, kFrameHistory> times{};
+            size_t next = 0;
+            size_t count = 0;
+            int64_t lastFrameNs = -1;
+        } g_frames;
+    }
+
+    int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch()).count();
+    }
+
+    void record(const char* name, int64_t startNs, int64_t endNs) {
+        ThreadBuffer& buffer = threadBuffer();
+        uint64_t index = buffer.head.load(std::memory_order_relaxed);
+        Slot& slot = buffer.slots[index & (kRingCapacity - 1)];
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.startNs.store(startNs, std::memory_order_relaxed);
+        slot.durationNs.store(endNs - startNs, std::memory_order_relaxed);
+        buffer.head.store(index + 1, std::memory_order_release);
+    }
+
+    void endFrame() {
+        int64_t current = now();
+        if (g_frames.lastFrameNs >= 0) {
+            record("Frame", g_frames.lastFrameNs, current);
+            g_frames.times[g_frames.next] = static_cast<float>(current - g_frames.lastFrameNs) / 1e6f;
+            g_frames.next = (g_frames.next + 1) % kFrameHistory;
+            g_frames.count = std::min(g_frames.count + 1, kFrameHistory);
+        }
+        g_frames.lastFrameNs = current;
+    }
+
+    std::vector<Event> collect(int64_t sinceNs) {
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        {
+            auto& reg = registry();
+            std::lock_guard lock(reg.mutex);
+            buffers = reg.buffers;
+        }
+
+        std::vector<Event> events;
+        for (const auto& buffer : buffers) {
+            uint64_t head = buffer->head.load(std::memory_order_acquire);
+            // Leave the oldest eighth alone, the writer may be overwriting it right now
+            uint64_t available = std::min<uint64_t>(head, kRingCapacity - kRingCapacity / 8);
+            for (uint64_t i = head - available; i < head; i++) {
+                const Slot& slot = buffer->slots[i & (kRingCapacity - 1)];
+                Event event{slot.name.load(std::memory_order_relaxed), slot.startNs.load(std::memory_order_relaxed),
+                            slot.durationNs.load(std::memory_order_relaxed), buffer->threadId};
+                if (event.name && event.startNs >= sinceNs) {
+                    events.push_back(event);
+                }
+            }
+        }
+        return events;
+    }
+
+    std::vector<ZoneStats> topZones(int64_t windowNs, size_t count) {
+        std::unordered_map<const char*, ZoneStats> totals;
+        for (const Event& event : collect(now() - windowNs)) {
+            auto& stats = totals.try_emplace(event.name, ZoneStats{event.name, 0, 0}).first->second;
+            stats.totalNs += event.durationNs;
+            stats.calls++;
+        }
+
+        std::vector<ZoneStats> result;
+        result.reserve(totals.size());
+        for (const auto& [name, stats] : totals) {
+            result.push_back(stats);
+        }
+        std::sort(result.begin(), result.end(), [](const ZoneStats& a, const ZoneStats& b) { return a.totalNs > b.totalNs; });
+        if (result.size() > count) {
+            result.resize(count);
+        }
+        return result;
+    }
+
+    std::vector<float> getFrameTimes() {
+        std::vector<float> result;
+        result.reserve(g_frames.count);
+        size_t first = (g_frames.next + kFrameHistory - g_frames.count) % kFrameHistory;
+        for (size_t i = 0; i < g_frames.count; i++) {
+            result.push_back(g_frames.times[(first + i) % kFrameHistory]);
+        }
+        return result;
+    }
+
+    bool exportChromeTrace(const std::filesystem::path& path) {
+        std::vector<Event> events = collect();
+        std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.startNs < b.startNs; });
+
+        FILE* file = std::fopen(path.string().c_str(), "wb");
+        if (!file) {
+            return false;
+        }
+        std::vector<char> buffer(1 << 20);
+        std::setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+
+        std::fputs("{\"traceEvents\":[\n", file);
+        bool first = true;
+        for (const Event& event : events) {
+            // Zone names are literals or function names, nothing to escape
+            std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                first ? "" : ",\n", event.name, event.startNs / 1000.0, event.durationNs / 1000.0, event.threadId);
+            first = false;
+        }
+        std::fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+        return std::fclose(file) == 0;
+    }
+} // namespace Profiler
+} // namespace Mir
+#endif
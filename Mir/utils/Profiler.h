@@ -0,0 +1,68 @@
+#pragma once
+// Scoped timing zones for hot paths. Everything here compiles to nothing unless
+// MIR_ENABLE_PROFILER is defined (cmake -DMIR_ENABLE_PROFILER=ON).
+//
+//   void FileTree::sortChildren(FileNode* node) {
+//       MIR_PROFILE_SCOPE("FileTree::sortChildren");
+//       ...
+//   }
+//
+// Zone names must be string literals, only the pointer is stored.
+#ifdef MIR_ENABLE_PROFILER
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace Mir {
+namespace Profiler {
+    struct Event {
+        const char* name;
+        int64_t startNs;
+        int64_t durationNs;
+        uint32_t threadId;
+    };
+
+    struct ZoneStats {
+        const char* name;
+        int64_t totalNs;
+        uint32_t calls;
+    };
+
+    // Nanoseconds since the profiler was first used
+    int64_t now();
+    void record(const char* name, int64_t startNs, int64_t endNs);
+    // Called once per frame by the render loop, feeds the frame time history
+    void endFrame();
+
+    // Snapshot of the per thread ring buffers, events that started before sinceNs are skipped
+    std::vector<Event> collect(int64_t sinceNs = 0);
+    // Inclusive time per zone name over the last windowNs, largest first
+    std::vector<ZoneStats> topZones(int64_t windowNs, size_t count);
+    // Frame times in milliseconds, oldest first
+    std::vector<float> getFrameTimes();
+    bool exportChromeTrace(const std::filesystem::path& path);
+
+    class ScopedZone {
+    public:
+        explicit ScopedZone(const char* name) : m_name(name), m_start(now()) {}
+        ~ScopedZone() { record(m_name, m_start, now()); }
+        ScopedZone(const ScopedZone&) = delete;
+        ScopedZone& operator=(const ScopedZone&) = delete;
+
+    private:
+        const char* m_name;
+        int64_t m_start;
+    };
+} // namespace Profiler
+} // namespace Mir
+
+#define MIR_PROFILE_CONCAT_INNER(a, b) a##b
+#define MIR_PROFILE_CONCAT(a, b) MIR_PROFILE_CONCAT_INNER(a, b)
+#define MIR_PROFILE_SCOPE(name) ::Mir::Profiler::ScopedZone MIR_PROFILE_CONCAT(mirProfileZone, __LINE__)(name)
+#define MIR_PROFILE_FUNCTION() MIR_PROFILE_SCOPE(__func__)
+#define MIR_PROFILE_FRAME() ::Mir::Profiler::endFrame()
+#else
+#define MIR_PROFILE_SCOPE(name)
+#define MIR_PROFILE_FUNCTION()
+#define MIR_PROFILE_FRAME()
+#endif
@@ -0,0 +1,28 @@
+#include "Redraw.h"
+#include <atomic>
+
+namespace Mir {
+namespace Redraw {
+    namespace {
+        std::atomic<bool> g_requested{false};
+        std::atomic<void (*)()> g_wakeHandler{nullptr};
+    }
+
+    void request() {
+        // Only the first request since the last frame needs to wake the loop
+        if (!g_requested.exchange(true, std::memory_order_acq_rel)) {
+            if (auto handler = g_wakeHandler.load(std::memory_order_acquire)) {
+                handler();
+            }
+        }
+    }
+
+    bool consume() {
+        return g_requested.exchange(false, std::memory_order_acq_rel);
+    }
+
+    void setWakeHandler(void (*handler)()) {
+        g_wakeHandler.store(handler, std::memory_order_release);
+    }
+} // namespace Redraw
+} // namespace Mir
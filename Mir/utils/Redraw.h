@@ -0,0 +1,13 @@
+#pragma once
+
+// Lets background work (scans, watchers, async callbacks) wake an idle render loop.
+// The loop installs a wake handler (glfwPostEmptyEvent), workers call request() after posting results.
+namespace Mir {
+namespace Redraw {
+    // Thread safe, marks the UI dirty and wakes the loop
+    void request();
+    // Render thread: true if a redraw was requested since the last call
+    bool consume();
+    void setWakeHandler(void (*handler)());
+} // namespace Redraw
+} // namespace Mir
@@ -0,0 +1,124 @@
+#include "Sha1.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Mir {
+namespace Utils {
+    namespace {
+        inline uint32_t rotateLeft(uint32_t value, int bits) {
+            return (value << bits) | (value >> (32 - bits));
+        }
+    }
+
+    void Sha1::reset() {
+        m_state = {0x67452301u, 0xEFCDAB89u, 0x98BADCFEu, 0x10325476u, 0xC3D2E1F0u};
+        m_blockSize = 0;
+        m_length = 0;
+    }
+
+    void Sha1::update(const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        m_length += size;
+        if (m_blockSize > 0) {
+            size_t take = std::min(size, m_block.size() - m_blockSize);
+            std::memcpy(m_block.data() + m_blockSize, bytes, take);
+            m_blockSize += take;
+            bytes += take;
+            size -= take;
+            if (m_blockSize < m_block.size()) {
+                return;
+            }
+            processBlock(m_block.data());
+            m_blockSize = 0;
+        }
+        // Whole blocks straight from the input, no copy
+        for (; size >= 64; bytes += 64, size -= 64) {
+            processBlock(bytes);
+        }
+        std::memcpy(m_block.data(), bytes, size);
+        m_blockSize = size;
+    }
+
+    Sha1::Digest Sha1::finish() {
+        uint64_t bits = m_length * 8;
+        uint8_t padding[72] = {0x80};
+        size_t padLength = (m_blockSize < 56 ? 56 : 120) - m_blockSize;
+        for (int i = 0; i < 8; i++) {
+            padding[padLength + i] = static_cast<uint8_t>(bits >> (56 - i * 8));
+        }
+        update(padding, padLength + 8);
+
+        Digest digest;
+        for (size_t i = 0; i < m_state.size(); i++) {
+            digest[i * 4] = static_cast<uint8_t>(m_state[i] >> 24);
+            digest[i * 4 + 1] = static_cast<uint8_t>(m_state[i] >> 16);
+            digest[i * 4 + 2] = static_cast<uint8_t>(m_state[i] >> 8);
+            digest[i * 4 + 3] = static_cast<uint8_t>(m_state[i]);
+        }
+        return digest;
+    }
+
+    Sha1::Digest Sha1::hash(std::string_view data) {
+        Sha1 sha;
+        sha.update(data);
+        return sha.finish();
+    }
+
+    std::string Sha1::toHex(const Digest& digest) {
+        static constexpr char kDigits[] = "0123456789abcdef";
+        std::string hex;
+        hex.reserve(digest.size() * 2);
+        for (uint8_t byte : digest) {
+            hex += kDigits[byte >> 4];
+            hex += kDigits[byte & 15];
+        }
+        return hex;
+    }
+
+    void Sha1::processBlock(const uint8_t* block) {
+        // 16 word ring instead of the 80 word schedule, stays in registers and L1
+        uint32_t w[16];
+        for (int i = 0; i < 16; i++) {
+            w[i] = (uint32_t(block[i * 4]) << 24) | (uint32_t(block[i * 4 + 1]) << 16) |
+                   (uint32_t(block[i * 4 + 2]) << 8) | uint32_t(block[i * 4 + 3]);
+        }
+        uint32_t a = m_state[0];
+        uint32_t b = m_state[1];
+        uint32_t c = m_state[2];
+        uint32_t d = m_state[3];
+        uint32_t e = m_state[4];
+        for (int i = 0; i < 80; i++) {
+            if (i >= 16) {
+                uint32_t next = w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ w[(i + 2) & 15] ^ w[i & 15];
+                w[i & 15] = rotateLeft(next, 1);
+            }
+            uint32_t f;
+            uint32_t k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999u;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1u;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDCu;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6u;
+            }
+            uint32_t temp = rotateLeft(a, 5) + f + e + k + w[i & 15];
+            e = d;
+            d = c;
+            c = rotateLeft(b, 30);
+            b = a;
+            a = temp;
+        }
+        m_state[0] += a;
+        m_state[1] += b;
+        m_state[2] += c;
+        m_state[3] += d;
+        m_state[4] += e;
+    }
+} // namespace Utils
+} // namespace Mir
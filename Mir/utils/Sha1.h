@@ -0,0 +1,40 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Mir {
+namespace Utils {
+    // Incremental SHA-1, only for naming content the way git does (object ids), not for security.
+    //
+    //   Mir::Utils::Sha1 sha;
+    //   sha.update("blob 5");
+    //   sha.update(std::string_view("\0hello", 6));
+    //   Mir::Utils::Sha1::Digest id = sha.finish();
+    class Sha1 {
+    public:
+        using Digest = std::array<uint8_t, 20>;
+
+        Sha1() { reset(); }
+
+        void reset();
+        void update(const void* data, size_t size);
+        void update(std::string_view data) { update(data.data(), data.size()); }
+        // Pads and returns the digest, reset() before hashing something else
+        Digest finish();
+
+        static Digest hash(std::string_view data);
+        static std::string toHex(const Digest& digest);
+
+    private:
+        std::array<uint32_t, 5> m_state{};
+        std::array<uint8_t, 64> m_block{};
+        size_t m_blockSize = 0;
+        uint64_t m_length = 0;  // bytes hashed so far
+
+        void processBlock(const uint8_t* block);
+    };
+} // namespace Utils
+} // namespace Mir
@@ -0,0 +1,415 @@
+#include "TailFile.h"
+#include "Profiler.h"
+#include "LineIndex.h"
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#endif
+
+namespace Mir {
+namespace Utils {
+namespace File {
+    //--------------------------------------------------------------------------------------------------------------------------------------------------
+    // Handle START
+    //--------------------------------------------------------------------------------------------------------------------------------------------------
+#ifdef _WIN32
+    bool TailFile::Handle::open(const std::filesystem::path& filepath) {
+        close();
+        // The writer keeps the file open, rotation renames or deletes it under us
+        HANDLE file = CreateFileW(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                  nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        m_file = file;
+        return true;
+    }
+
+    void TailFile::Handle::close() {
+        if (m_file) {
+            CloseHandle(m_file);
+            m_file = nullptr;
+        }
+    }
+
+    bool TailFile::Handle::isOpen() const { return m_file != nullptr; }
+
+    void TailFile::Handle::swap(Handle& other) noexcept { std::swap(m_file, other.m_file); }
+
+    bool TailFile::Handle::size(uint64_t& out) const {
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(m_file, &fileSize)) {
+            return false;
+        }
+        out = static_cast<uint64_t>(fileSize.QuadPart);
+        return true;
+    }
+
+    int64_t TailFile::Handle::readAt(uint64_t offset, char* buffer, size_t count) const {
+        OVERLAPPED overlapped{};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD read = 0;
+        DWORD toRead = static_cast<DWORD>(std::min<size_t>(count, 1u << 30));
+        if (!ReadFile(m_file, buffer, toRead, &read, &overlapped)) {
+            return GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+        }
+        return static_cast<int64_t>(read);
+    }
+
+    bool TailFile::Handle::isSameFile(const std::filesystem::path& filepath) const {
+        HANDLE other = CreateFileW(filepath.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                   nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (other == INVALID_HANDLE_VALUE) {
+            return true; // nothing there right now, keep following what we have
+        }
+        BY_HANDLE_FILE_INFORMATION a;
+        BY_HANDLE_FILE_INFORMATION b;
+        bool same = GetFileInformationByHandle(m_file, &a) && GetFileInformationByHandle(other, &b)
+            && a.dwVolumeSerialNumber == b.dwVolumeSerialNumber
+            && a.nFileIndexHigh == b.nFileIndexHigh && a.nFileIndexLow == b.nFileIndexLow;
+        CloseHandle(other);
+        return same;
+    }
+#else
+    bool TailFile::Handle::open(const std::filesystem::path& filepath) {
+        close();
+        m_fd = ::open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+        return m_fd >= 0;
+    }
+
+    void TailFile::Handle::close() {
+        if (m_fd >= 0) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+    bool TailFile::Handle::isOpen() const { return m_fd >= 0; }
+
+    void TailFile::Handle::swap(Handle& other) noexcept { std::swap(m_fd, other.m_fd); }
+
+    bool TailFile::Handle::size(uint64_t& out) const {
+        struct stat info;
+        if (::fstat(m_fd, &info) != 0) {
+            return false;
+        }
+        out = static_cast<uint64_t>(info.st_size);
+        return true;
+    }
+
+    int64_t TailFile::Handle::readAt(uint64_t offset, char* buffer, size_t count) const {
+        return ::pread(m_fd, buffer, count, static_cast<off_t>(offset));
+    }
+
+    bool TailFile::Handle::isSameFile(const std::filesystem::path& filepath) const {
+        struct stat opened;
+        struct stat named;
+        if (::stat(filepath.c_str(), &named) != 0) {
+            return true; // nothing there right now, keep following what we have
+        }
+        return ::fstat(m_fd, &opened) == 0 && opened.st_dev == named.st_dev && opened.st_ino == named.st_ino;
+    }
+#endif
+    //--------------------------------------------------------------------------------------------------------------------------------------------------
+    // Handle END
+    //--------------------------------------------------------------------------------------------------------------------------------------------------
+
+    TailFile::~TailFile() {
+        close();
+    }
+
+    bool TailFile::open(const std::filesystem::path& filepath) {
+        close();
+        if (!m_handle.open(filepath)) {
+            return false;
+        }
+        m_path = filepath;
+        reset();
+        // A long existing log is joined near its end, the first partial line is skipped
+        uint64_t size = 0;
+        if (m_handle.size(size) && size > m_options.initialBytes) {
+            m_offset = size - m_options.initialBytes;
+            m_headSkipped = true;
+            m_joinPending = true;
+        }
+        m_changed.store(true, std::memory_order_relaxed);
+        return true;
+    }
+
+    void TailFile::close() {
+        stopWatching();
+        m_handle.close();
+        m_path.clear();
+        reset();
+    }
+
+    void TailFile::reset() {
+        m_offset = 0;
+        m_buffer.clear();
+        m_lineStarts.assign(1, 0);
+        m_droppedLines = 0;
+        m_headSkipped = false;
+        m_joinPending = false;
+    }
+
+    size_t TailFile::getLineCount() const {
+        // A buffer ending in a newline has an empty line start after it, that one is not shown
+        size_t count = m_lineStarts.size();
+        return m_lineStarts.back() == m_buffer.size() ? count - 1 : count;
+    }
+
+    std::string_view TailFile::getLine(size_t index) const {
+        size_t start = m_lineStarts[index];
+        size_t end = index + 1 < m_lineStarts.size() ? m_lineStarts[index + 1] - 1 : m_buffer.size();
+        if (end > start && m_buffer[end - 1] == '\r') {
+            end--;
+        }
+        return std::string_view(m_buffer).substr(start, end - start);
+    }
+
+    bool TailFile::poll() {
+        if (!isOpen()) {
+            return false;
+        }
+        // With a watcher nothing is touched until it reported something
+        if (isWatching() && !m_changed.exchange(false, std::memory_order_acq_rel)) {
+            return false;
+        }
+        MIR_PROFILE_SCOPE("TailFile::poll");
+        bool changed = false;
+        uint64_t size = 0;
+
+        if (!m_handle.isSameFile(m_path)) {
+            // Rotated: whatever was written to the old file before the switch is still shown
+            if (m_handle.size(size)) {
+                changed |= readAppended(size);
+            }
+            Handle next;
+            if (next.open(m_path)) {
+                m_handle.swap(next);
+                m_offset = 0;
+                m_rotations++;
+                // An unfinished last line of the old file is not continued by the new one
+                if (!m_buffer.empty() && m_buffer.back() != '\n') {
+                    m_buffer.push_back('\n');
+                    m_lineStarts.push_back(m_buffer.size());
+                }
+                changed = true;
+            }
+        }
+
+        if (!m_handle.size(size)) {
+            return changed;
+        }
+        if (size < m_offset) {
+            // Truncated in place (> log, logrotate copytruncate), start over from the top
+            reset();
+            m_truncations++;
+            changed = true;
+        }
+        if (size > m_offset) {
+            changed |= readAppended(size);
+        }
+        return changed;
+    }
+
+    bool TailFile::readAppended(uint64_t size) {
+        uint64_t end = std::min<uint64_t>(size, m_offset + m_options.maxReadPerPoll);
+
+        // Straight into the buffer, no intermediate copy
+        size_t base = m_buffer.size();
+        size_t wanted = static_cast<size_t>(end - m_offset);
+        m_buffer.resize(base + wanted);
+        size_t got = 0;
+        while (got < wanted) {
+            int64_t count = m_handle.readAt(m_offset + got, m_buffer.data() + base + got, wanted - got);
+            if (count <= 0) {
+                break;
+            }
+            got += static_cast<size_t>(count);
+        }
+        m_buffer.resize(base + got);
+        m_offset += got;
+
+        if (m_joinPending) {
+            // Joined in the middle of a line, start at the next one
+            size_t newline = m_buffer.find('\n');
+            m_joinPending = newline == std::string::npos;
+            m_buffer.erase(0, m_joinPending ? m_buffer.size() : newline + 1);
+            base = 0;
+        }
+        indexFrom(base);
+        trim();
+
+        // Far behind: come back for the rest without waiting for the next change
+        if (end < size) {
+            m_changed.store(true, std::memory_order_relaxed);
+            if (m_onChange) {
+                m_onChange();
+            }
+        }
+        return got > 0;
+    }
+
+    void TailFile::indexFrom(size_t base) {
+        // Newline offsets, then one past each as line starts
+        size_t first = m_lineStarts.size();
+        LineIndex::findNewlines(std::string_view(m_buffer).substr(base), base, m_lineStarts);
+        for (size_t i = first; i < m_lineStarts.size(); i++) {
+            m_lineStarts[i]++;
+        }
+    }
+
+    void TailFile::trim() {
+        if (m_buffer.size() <= m_options.maxBytes) {
+            return;
+        }
+        // Drop down to half the budget so trimming happens once per maxBytes / 2 of new data
+        size_t keepFrom = m_buffer.size() - m_options.maxBytes / 2;
+        auto first = std::lower_bound(m_lineStarts.begin(), m_lineStarts.end(), keepFrom);
+        if (first == m_lineStarts.end()) {
+            first = std::prev(m_lineStarts.end());
+        }
+        size_t cut = *first;
+        size_t dropped = static_cast<size_t>(first - m_lineStarts.begin());
+        m_buffer.erase(0, cut);
+        m_lineStarts.erase(m_lineStarts.begin(), first);
+        for (size_t& start : m_lineStarts) {
+            start -= cut;
+        }
+        m_droppedLines += dropped;
+    }
+
+    //--------------------------------------------------------------------------------------------------------------------------------------------------
+    // Watcher START
+    //--------------------------------------------------------------------------------------------------------------------------------------------------
+    void TailFile::watch(std::function<void()> onChange) {
+        stopWatching();
+        if (!isOpen()) {
+            return;
+        }
+        m_onChange = std::move(onChange);
+        m_stop.store(false, std::memory_order_relaxed);
+        m_changed.store(true, std::memory_order_relaxed);
+        m_usesInotify = false;
+        // Set up before returning, a write right after watch() must not slip past
+        int inotifyFd = -1;
+#ifdef __linux__
+        m_wakeFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        // The folder is watched, not the file, so a rotated in replacement is seen too
+        inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd >= 0 && m_wakeFd >= 0) {
+            std::filesystem::path folder = m_path.has_parent_path() ? m_path.parent_path() : std::filesystem::path(".");
+            uint32_t mask = IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+            m_usesInotify = ::inotify_add_watch(inotifyFd, folder.c_str(), mask) >= 0;
+        }
+        if (!m_usesInotify && inotifyFd >= 0) {
+            ::close(inotifyFd);
+            inotifyFd = -1;
+        }
+#endif
+        m_watcher = std::thread([this, inotifyFd, last = snapshot(m_path)]() { watchLoop(inotifyFd, last); });
+    }
+
+    void TailFile::stopWatching() {
+        if (!m_watcher.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard lock(m_stopMutex);
+            m_stop.store(true, std::memory_order_relaxed);
+        }
+        m_stopSignal.notify_all();
+#ifdef __linux__
+        if (m_wakeFd >= 0) {
+            uint64_t one = 1;
+            [[maybe_unused]] ssize_t written = ::write(m_wakeFd, &one, sizeof(one));
+        }
+#endif
+        m_watcher.join();
+#ifdef __linux__
+        if (m_wakeFd >= 0) {
+            ::close(m_wakeFd);
+            m_wakeFd = -1;
+        }
+#endif
+        m_onChange = nullptr;
+    }
+
+    TailFile::Snapshot TailFile::snapshot(const std::filesystem::path& filepath) {
+        std::error_code ec;
+        uint64_t size = std::filesystem::file_size(filepath, ec);
+        auto time = std::filesystem::last_write_time(filepath, ec).time_since_epoch().count();
+        return {ec ? 0 : size, static_cast<int64_t>(time)};
+    }
+
+    void TailFile::watchLoop(int inotifyFd, Snapshot last) {
+        // Size and time of the path are also checked on every interval, as the fallback and as a
+        // safety net (inotify sees nothing on network shares)
+        auto notify = [this]() {
+            m_changed.store(true, std::memory_order_release);
+            if (m_onChange) {
+                m_onChange();
+            }
+        };
+
+#ifdef __linux__
+        std::string name = m_path.filename().native();
+        if (inotifyFd >= 0) {
+            alignas(inotify_event) char events[4096];
+            pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {m_wakeFd, POLLIN, 0}};
+            while (!m_stop.load(std::memory_order_relaxed)) {
+                int ready = ::poll(fds, 2, m_options.pollIntervalMs);
+                if (ready < 0 && errno != EINTR) {
+                    break;
+                }
+                bool hit = false;
+                if (ready > 0 && (fds[0].revents & POLLIN)) {
+                    ssize_t length;
+                    while ((length = ::read(inotifyFd, events, sizeof(events))) > 0) {
+                        for (char* cursor = events; cursor < events + length;) {
+                            auto* event = reinterpret_cast<inotify_event*>(cursor);
+                            hit |= event->len > 0 && name == event->name;
+                            cursor += sizeof(inotify_event) + event->len;
+                        }
+                    }
+                }
+                Snapshot now = snapshot(m_path);
+                if (hit || now != last) {
+                    last = now;
+                    notify();
+                }
+            }
+            ::close(inotifyFd);
+            return;
+        }
+#endif
+        std::unique_lock lock(m_stopMutex);
+        while (!m_stop.load(std::memory_order_relaxed)) {
+            m_stopSignal.wait_for(lock, std::chrono::milliseconds(m_options.pollIntervalMs));
+            Snapshot now = snapshot(m_path);
+            if (now != last) {
+                last = now;
+                notify();
+            }
+        }
+    }
+    //--------------------------------------------------------------------------------------------------------------------------------------------------
+    // Watcher END
+    //--------------------------------------------------------------------------------------------------------------------------------------------------
+} // namespace File
+} // namespace Utils
+} // namespace Mir
@@ -0,0 +1,130 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Mir {
+namespace Utils {
+namespace File {
+    // Follows a growing file like tail -f. The file stays open and only bytes appended since the
+    // last poll are read and indexed, so a log growing by megabytes a second costs about as much
+    // as copying those bytes once. Truncation (log cleared) starts over from the top, rotation
+    // (the path now names a new file) finishes the old file and switches to the new one.
+    //
+    //   TailFile tail;
+    //   tail.open(path);
+    //   tail.watch([] { Mir::Redraw::request(); });   // optional, wakes the UI on changes
+    //   ... every frame: if (tail.poll()) { lines changed }, then getLine(0..getLineCount())
+    //
+    // Everything except watch's callback runs on the owning thread.
+    class TailFile {
+    public:
+        struct Options {
+            size_t initialBytes = 4 * 1024 * 1024;  // a big existing file is only read from its last few MB
+            size_t maxBytes = 64 * 1024 * 1024;     // older lines are dropped beyond this
+            size_t maxReadPerPoll = 16 * 1024 * 1024; // keeps one poll short when far behind
+            int pollIntervalMs = 250;               // change checks without inotify, also a safety net with it
+        };
+
+        TailFile() : TailFile(Options()) {}
+        explicit TailFile(const Options& options) : m_options(options) {}
+        ~TailFile();
+
+        TailFile(const TailFile&) = delete;
+        TailFile& operator=(const TailFile&) = delete;
+
+        bool open(const std::filesystem::path& filepath);
+        void close();
+        bool isOpen() const { return m_handle.isOpen(); }
+        const std::filesystem::path& getPath() const { return m_path; }
+
+        // Starts a thread that calls onChange whenever the file may have changed. Uses inotify on
+        // Linux, size and time polling elsewhere. Without it every poll() checks the file.
+        void watch(std::function<void()> onChange);
+        bool isWatching() const { return m_watcher.joinable(); }
+        bool usesInotify() const { return m_usesInotify; }
+
+        // Reads what was appended since the last call, true if the lines changed
+        bool poll();
+
+        // Lines without their line ending. A last line without a newline yet is included.
+        size_t getLineCount() const;
+        std::string_view getLine(size_t index) const;
+        // Lines dropped from the front (maxBytes, or skipped by initialBytes when known), for numbering
+        size_t getDroppedLines() const { return m_droppedLines; }
+        bool isHeadSkipped() const { return m_headSkipped; }
+        size_t getBufferedBytes() const { return m_buffer.size(); }
+        uint64_t getFileOffset() const { return m_offset; }
+        size_t getRotations() const { return m_rotations; }
+        size_t getTruncations() const { return m_truncations; }
+
+    private:
+        // Platform file handle that stays open across polls
+        class Handle {
+        public:
+            Handle() = default;
+            ~Handle() { close(); }
+            Handle(const Handle&) = delete;
+            Handle& operator=(const Handle&) = delete;
+            void swap(Handle& other) noexcept;
+
+            bool open(const std::filesystem::path& filepath);
+            void close();
+            bool isOpen() const;
+            bool size(uint64_t& out) const;
+            // Bytes read, 0 at the end, -1 on errors
+            int64_t readAt(uint64_t offset, char* buffer, size_t count) const;
+            // Same file as what path names now
+            bool isSameFile(const std::filesystem::path& filepath) const;
+
+        private:
+#ifdef _WIN32
+            void* m_file = nullptr;
+#else
+            int m_fd = -1;
+#endif
+        };
+
+        Options m_options;
+        std::filesystem::path m_path;
+        Handle m_handle;
+        uint64_t m_offset = 0;                  // next byte to read from the file
+        std::string m_buffer;
+        std::vector<size_t> m_lineStarts{0};    // into m_buffer, one past every newline
+        size_t m_droppedLines = 0;
+        bool m_headSkipped = false;
+        bool m_joinPending = false;             // still inside the partial line where reading started
+        size_t m_rotations = 0;
+        size_t m_truncations = 0;
+
+        std::thread m_watcher;
+        std::atomic<bool> m_changed{true};
+        std::atomic<bool> m_stop{false};
+        std::function<void()> m_onChange;
+        bool m_usesInotify = false;
+        std::mutex m_stopMutex;
+        std::condition_variable m_stopSignal;
+#ifndef _WIN32
+        int m_wakeFd = -1;
+#endif
+
+        void reset();
+        bool readAppended(uint64_t size);
+        void indexFrom(size_t base);
+        void trim();
+        using Snapshot = std::pair<uint64_t, int64_t>;     // size, write time
+        static Snapshot snapshot(const std::filesystem::path& filepath);
+        void stopWatching();
+        void watchLoop(int inotifyFd, Snapshot last);
+    };
+} // namespace File
+} // namespace Utils
+} // namespace Mir
@@ -0,0 +1,145 @@
+#include "TextTemplate.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace Mir {
+namespace Utils {
+    TextTemplate::TextTemplate(std::string_view source, char oChar, char cChar) : m_source(source) {
+        auto addLiteral = [this](size_t offset, size_t length) {
+            if (length == 0) {
+                return;
+            }
+            m_literalSize += length;
+            // Unmatched braces end up as neighbouring literals, keep them one segment
+            if (!m_segments.empty() && m_segments.back().slot < 0 && m_segments.back().offset + m_segments.back().length == offset) {
+                m_segments.back().length += static_cast<uint32_t>(length);
+                return;
+            }
+            m_segments.push_back({static_cast<uint32_t>(offset), static_cast<uint32_t>(length), -1});
+        };
+
+        size_t copied = 0;
+        size_t start = 0;
+        while ((start = source.find(oChar, start)) != std::string_view::npos) {
+            size_t end = source.find(cChar, start);
+            if (end == std::string_view::npos) {
+                break;
+            }
+            addLiteral(copied, start - copied);
+            std::string_view name = source.substr(start + 1, end - start - 1);
+            int slot = findSlot(name);
+            if (slot < 0) {
+                slot = static_cast<int>(m_slots.size());
+                m_slots.emplace_back(name);
+            }
+            m_segments.push_back({static_cast<uint32_t>(start), static_cast<uint32_t>(end - start + 1), slot});
+            copied = end + 1;
+            start = end + 1;
+        }
+        addLiteral(copied, source.size() - copied);
+    }
+
+    int TextTemplate::findSlot(std::string_view name) const {
+        for (size_t i = 0; i < m_slots.size(); i++) {
+            if (m_slots[i] == name) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    size_t TextTemplate::measure(std::span<const std::string_view> values) const {
+        size_t size = m_literalSize;
+        for (const Segment& segment : m_segments) {
+            if (segment.slot >= 0) {
+                size += static_cast<size_t>(segment.slot) < values.size() ? values[segment.slot].size() : segment.length;
+            }
+        }
+        return size;
+    }
+
+    char* TextTemplate::write(std::span<const std::string_view> values, char* out) const {
+        for (const Segment& segment : m_segments) {
+            std::string_view piece = segment.slot >= 0 && static_cast<size_t>(segment.slot) < values.size()
+                ? values[segment.slot] : text(segment);
+            if (!piece.empty()) {
+                std::memcpy(out, piece.data(), piece.size());
+                out += piece.size();
+            }
+        }
+        return out;
+    }
+
+    void TextTemplate::render(std::span<const std::string_view> values, std::string& out) const {
+        out.resize(measure(values));
+        write(values, out.data());
+    }
+
+    std::string TextTemplate::render(std::span<const std::string_view> values) const {
+        std::string out;
+        render(values, out);
+        return out;
+    }
+
+    size_t TextTemplate::rowCount(std::span<const std::string_view> table) const {
+        return m_slots.empty() ? 0 : table.size() / m_slots.size();
+    }
+
+    namespace {
+        // Runs body(firstRow, endRow) over contiguous ranges, on the calling thread for small jobs
+        template <typename Body>
+        void forEachRange(size_t rows, size_t minRows, size_t threadCount, Body&& body) {
+            if (threadCount == 0) {
+                threadCount = std::max(1u, std::thread::hardware_concurrency());
+            }
+            size_t chunks = std::min(threadCount * 4, rows / minRows);
+            if (threadCount == 1 || chunks < 2) {
+                body(size_t(0), rows);
+                return;
+            }
+            Mir::ThreadPool pool(std::min(threadCount, chunks));
+            size_t perChunk = (rows + chunks - 1) / chunks;
+            for (size_t first = 0; first < rows; first += perChunk) {
+                pool.submit([&body, first, end = std::min(rows, first + perChunk)]() { body(first, end); });
+            }
+            pool.waitIdle();
+        }
+    }
+
+    void TextTemplate::renderBatch(std::span<const std::string_view> table, std::vector<std::string>& out, size_t threadCount) const {
+        MIR_PROFILE_SCOPE("TextTemplate::renderBatch");
+        size_t rows = rowCount(table);
+        size_t width = m_slots.size();
+        out.resize(rows);
+        forEachRange(rows, kParallelRows, threadCount, [&](size_t first, size_t end) {
+            for (size_t row = first; row < end; row++) {
+                render(table.subspan(row * width, width), out[row]);
+            }
+        });
+    }
+
+    void TextTemplate::renderJoined(std::span<const std::string_view> table, std::string_view separator, std::string& out, size_t threadCount) const {
+        MIR_PROFILE_SCOPE("TextTemplate::renderJoined");
+        size_t rows = rowCount(table);
+        size_t width = m_slots.size();
+
+        // Row offsets first, then every row is written in place
+        std::vector<size_t> offsets(rows + 1, 0);
+        for (size_t row = 0; row < rows; row++) {
+            offsets[row + 1] = offsets[row] + measure(table.subspan(row * width, width)) + separator.size();
+        }
+        out.resize(offsets[rows]);
+        forEachRange(rows, kParallelRows, threadCount, [&](size_t first, size_t end) {
+            for (size_t row = first; row < end; row++) {
+                char* cursor = write(table.subspan(row * width, width), out.data() + offsets[row]);
+                if (!separator.empty()) {
+                    std::memcpy(cursor, separator.data(), separator.size());
+                }
+            }
+        });
+    }
+} // namespace Utils
+} // namespace Mir
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Mir {
+namespace Utils {
+    // A text with {placeholders}, parsed once and rendered many times. Same placeholder rules as
+    // Text::replacePlaceholderIf: a slot is whatever sits between an opening char and the next
+    // closing char, and a slot without a value is left as it was written.
+    //
+    //   Mir::Utils::TextTemplate tmpl("{Type}_{Module}_{Channel}");
+    //   std::string out;
+    //   std::string_view values[] = {"DI", "M12", "07"};      // in getSlots() order
+    //   tmpl.render(values, out);                               // "DI_M12_07"
+    //
+    // Rendering computes the exact size first and copies every segment once, so a reused out
+    // buffer does not allocate after the first call.
+    class TextTemplate {
+    public:
+        TextTemplate() = default;
+        explicit TextTemplate(std::string_view source, char oChar = '{', char cChar = '}');
+
+        // Distinct slot names, in order of first appearance. Values are passed in this order.
+        const std::vector<std::string>& getSlots() const { return m_slots; }
+        size_t getSlotCount() const { return m_slots.size(); }
+        // -1 if the template has no such slot
+        int findSlot(std::string_view name) const;
+        const std::string& getSource() const { return m_source; }
+
+        // values.size() may be below getSlotCount(), the missing slots keep their placeholder
+        size_t measure(std::span<const std::string_view> values) const;
+        void render(std::span<const std::string_view> values, std::string& out) const;
+        std::string render(std::span<const std::string_view> values) const;
+
+        // Rows of getSlotCount() values each, table.size() / getSlotCount() outputs. Big batches are
+        // split across a thread pool (threadCount 0 = hardware concurrency, 1 = this thread only).
+        void renderBatch(std::span<const std::string_view> table, std::vector<std::string>& out, size_t threadCount = 0) const;
+        // All rows into one buffer with separator after each row, e.g. the lines of a generated file.
+        // Sized once up front, every thread copies straight into its own part of out.
+        void renderJoined(std::span<const std::string_view> table, std::string_view separator, std::string& out, size_t threadCount = 0) const;
+
+    private:
+        struct Segment {
+            uint32_t offset = 0;    // into m_source, the whole placeholder for slots
+            uint32_t length = 0;
+            int32_t slot = -1;      // -1 = literal
+        };
+
+        std::string m_source;
+        std::vector<Segment> m_segments;
+        std::vector<std::string> m_slots;
+        size_t m_literalSize = 0;
+        // Below this many rows a batch is not worth the threads
+        static constexpr size_t kParallelRows = 4096;
+
+        std::string_view text(const Segment& segment) const { return std::string_view(m_source).substr(segment.offset, segment.length); }
+        size_t rowCount(std::span<const std::string_view> table) const;
+        char* write(std::span<const std::string_view> values, char* out) const;
+    };
+} // namespace Utils
+} // namespace Mir
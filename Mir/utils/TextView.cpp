@@ -0,0 +1,221 @@
+#include "TextView.h"
+#include <algorithm>
+
+namespace Mir {
+namespace Utils {
+namespace TextView {
+    size_t splitAt(std::string_view line, char delimiter, std::vector<std::string_view>& out) {
+        out.clear();
+        size_t start = 0;
+        bool inQuotes = false;
+        auto push = [&](size_t end) {
+            std::string_view field = line.substr(start, end - start);
+            if (field.size() >= 2 && field.front() == '"' && field.back() == '"') {
+                field = field.substr(1, field.size() - 2);
+            }
+            out.push_back(field);
+        };
+        for (size_t i = 0; i < line.size(); i++) {
+            char c = line[i];
+            if (c == '"') {
+                inQuotes = !inQuotes;
+            } else if (c == delimiter && !inQuotes) {
+                push(i);
+                start = i + 1;
+            }
+        }
+        push(line.size());
+        return out.size();
+    }
+
+    std::string_view getFirstCleanString(std::string_view str) {
+        return findNthCleanString(str, 0);
+    }
+
+    std::string_view findNthCleanString(std::string_view str, size_t index) {
+        size_t i = 0;
+        while (i < str.size()) {
+            while (i < str.size() && !isAlnum(str[i])) {
+                i++;
+            }
+            size_t start = i;
+            while (i < str.size() && isAlnum(str[i])) {
+                i++;
+            }
+            if (i == start) {
+                break;
+            }
+            if (index-- == 0) {
+                return str.substr(start, i - start);
+            }
+        }
+        return {};
+    }
+
+    size_t findAllCleanString(std::string_view str, std::vector<std::string_view>& out) {
+        out.clear();
+        size_t i = 0;
+        while (i < str.size()) {
+            while (i < str.size() && !isAlnum(str[i])) {
+                i++;
+            }
+            size_t start = i;
+            while (i < str.size() && isAlnum(str[i])) {
+                i++;
+            }
+            if (i > start) {
+                out.push_back(str.substr(start, i - start));
+            }
+        }
+        return out.size();
+    }
+
+    std::string_view findCleanStringAt(std::string_view str, int pos) {
+        if (pos < 1) {
+            return {};
+        }
+        return findNthCleanString(str, static_cast<size_t>(pos - 1));
+    }
+
+    size_t extractAllBetweenCurlyBraces(std::string_view str, std::vector<std::string_view>& out) {
+        out.clear();
+        size_t start = 0;
+        while (start < str.size()) {
+            size_t open = str.find('{', start);
+            if (open == std::string_view::npos) break;
+            size_t close = str.find('}', open + 1);
+            if (close == std::string_view::npos) break;
+            out.push_back(str.substr(open + 1, close - open - 1));
+            start = close + 1;
+        }
+        return out.size();
+    }
+
+    bool containsCaseInsensitive(std::string_view haystack, std::string_view lowerNeedle) {
+        if (lowerNeedle.empty()) {
+            return true;
+        }
+        if (lowerNeedle.size() > haystack.size()) {
+            return false;
+        }
+        // Candidates by the first character in both cases, then a folded compare
+        char first = lowerNeedle.front();
+        char firstUpper = is(first, Lower) ? static_cast<char>(first - ('a' - 'A')) : first;
+        size_t last = haystack.size() - lowerNeedle.size();
+        for (size_t i = 0; i <= last; i++) {
+            if (haystack[i] != first && haystack[i] != firstUpper) {
+                continue;
+            }
+            size_t k = 0;
+            while (k < lowerNeedle.size() && toLower(haystack[i + k]) == lowerNeedle[k]) {
+                k++;
+            }
+            if (k == lowerNeedle.size()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string_view findMatchFrom(std::string_view str, const std::vector<std::string_view>& from) {
+        for (std::string_view candidate : from) {
+            if (containsCaseInsensitive(str, candidate)) {
+                return candidate;
+            }
+        }
+        return {};
+    }
+
+    std::string_view findIOdatatype(std::string_view str) {
+        static const std::vector<std::string_view> kTypes = {"ai", "ao", "di", "do"};
+        return findMatchFrom(str, kTypes);
+    }
+
+    namespace {
+        // Writes every byte and only advances past the kept ones, no branch per character
+        template <bool Keep>
+        void keepDigits(std::string_view str, std::string& out) {
+            out.resize(str.size());
+            size_t length = 0;
+            for (char c : str) {
+                out[length] = c;
+                length += isDigit(c) == Keep;
+            }
+            out.resize(length);
+        }
+    }
+
+    void findNumbers(std::string_view str, std::string& out) {
+        keepDigits<true>(str, out);
+    }
+
+    void filterNumbers(std::string_view str, std::string& out) {
+        keepDigits<false>(str, out);
+    }
+
+    void splitCharsFromNums(std::string_view str, std::string& chars, std::string& nums) {
+        chars.resize(str.size());
+        nums.resize(str.size());
+        size_t charCount = 0;
+        size_t numCount = 0;
+        for (char c : str) {
+            bool digit = isDigit(c);
+            chars[charCount] = c;
+            nums[numCount] = c;
+            charCount += !digit;
+            numCount += digit;
+        }
+        chars.resize(charCount);
+        nums.resize(numCount);
+    }
+
+    void toLowerCase(std::string_view str, std::string& out) {
+        out.resize(str.size());
+        std::transform(str.begin(), str.end(), out.begin(), toLower);
+    }
+
+    void removeCharactersFromStr(std::string_view str, const CharSet& chars, std::string& out) {
+        out.resize(str.size());
+        size_t length = 0;
+        for (char c : str) {
+            out[length] = c;
+            length += !chars.contains(c); // branch free, the byte is overwritten when skipped
+        }
+        out.resize(length);
+    }
+
+    void removeCharactersFromStr(std::string_view str, const CharSet& chars, std::string_view replacement, std::string& out) {
+        out.clear();
+        size_t start = 0;
+        for (size_t i = 0; i < str.size(); i++) {
+            if (chars.contains(str[i])) {
+                out.append(str.substr(start, i - start));
+                out.append(replacement);
+                start = i + 1;
+            }
+        }
+        out.append(str.substr(start));
+    }
+
+    void replacePlaceholderIf(std::string_view str, std::string_view placeholder, std::string_view replacement, std::string& out,
+                              char oChar, char cChar) {
+        out.clear();
+        size_t copied = 0;
+        size_t start = 0;
+        while ((start = str.find(oChar, start)) != std::string_view::npos) {
+            size_t end = str.find(cChar, start);
+            if (end == std::string_view::npos) {
+                break;
+            }
+            if (str.substr(start + 1, end - start - 1) == placeholder) {
+                out.append(str.substr(copied, start - copied));
+                out.append(replacement);
+                copied = end + 1;
+            }
+            start = end + 1;
+        }
+        out.append(str.substr(copied));
+    }
+} // namespace TextView
+} // namespace Utils
+} // namespace Mir
@@ -0,0 +1,96 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Allocation free counterparts of Mir::Utils::Text for hot loops (mapping files, millions of calls).
+// Results are views into the input, so the input has to outlive them, or go into buffers the
+// caller owns and reuses. Vector outputs are cleared first, their capacity is kept.
+//
+//   std::vector<std::string_view> fields;
+//   std::string cleaned;
+//   for (std::string_view line : lines) {
+//       Mir::Utils::TextView::splitAt(line, ',', fields);
+//       Mir::Utils::TextView::removeCharactersFromStr(fields[0], " \t", cleaned);
+//   }
+namespace Mir {
+namespace Utils {
+namespace TextView {
+    // Character classes as one table lookup instead of the locale aware <cctype> calls. ASCII only.
+    enum CharClass : uint8_t {
+        Digit = 1 << 0,
+        Upper = 1 << 1,
+        Lower = 1 << 2,
+        Space = 1 << 3,
+        Alpha = Upper | Lower,
+        Alnum = Alpha | Digit
+    };
+
+    inline constexpr std::array<uint8_t, 256> kCharClasses = [] {
+        std::array<uint8_t, 256> table{};
+        for (int c = '0'; c <= '9'; c++) table[c] |= Digit;
+        for (int c = 'A'; c <= 'Z'; c++) table[c] |= Upper;
+        for (int c = 'a'; c <= 'z'; c++) table[c] |= Lower;
+        for (char c : {' ', '\t', '\n', '\v', '\f', '\r'}) table[static_cast<unsigned char>(c)] |= Space;
+        return table;
+    }();
+
+    inline constexpr bool is(char c, uint8_t classes) { return kCharClasses[static_cast<unsigned char>(c)] & classes; }
+    inline constexpr bool isDigit(char c) { return is(c, Digit); }
+    inline constexpr bool isAlnum(char c) { return is(c, Alnum); }
+    inline constexpr bool isSpace(char c) { return is(c, Space); }
+    inline constexpr char toLower(char c) { return is(c, Upper) ? static_cast<char>(c + ('a' - 'A')) : c; }
+
+    // 256 bit membership set, replaces string_view::contains per character
+    class CharSet {
+    public:
+        constexpr CharSet() = default;
+        constexpr explicit CharSet(std::string_view chars) {
+            for (char c : chars) {
+                add(c);
+            }
+        }
+        constexpr void add(char c) {
+            auto byte = static_cast<unsigned char>(c);
+            m_bits[byte >> 6] |= uint64_t(1) << (byte & 63);
+        }
+        constexpr bool contains(char c) const {
+            auto byte = static_cast<unsigned char>(c);
+            return (m_bits[byte >> 6] >> (byte & 63)) & 1;
+        }
+
+    private:
+        uint64_t m_bits[4] = {};
+    };
+
+    // Quoted fields keep the delimiter. A field wrapped in quotes comes back without them,
+    // quotes anywhere else stay in the view (Text::splitAt drops every quote).
+    size_t splitAt(std::string_view line, char delimiter, std::vector<std::string_view>& out);
+    // First run of letters and digits, empty if there is none
+    std::string_view getFirstCleanString(std::string_view str);
+    inline std::string_view findFirstCleanString(std::string_view str) { return getFirstCleanString(str); }
+    size_t findAllCleanString(std::string_view str, std::vector<std::string_view>& out);
+    // 1 based like Text::findCleanStringAt, empty instead of "{overflow}" when there are fewer runs
+    std::string_view findCleanStringAt(std::string_view str, int pos);
+    std::string_view findNthCleanString(std::string_view str, size_t index);
+    size_t extractAllBetweenCurlyBraces(std::string_view str, std::vector<std::string_view>& out);
+
+    // Case insensitive substring search, returns the matching element of from (its view)
+    std::string_view findMatchFrom(std::string_view str, const std::vector<std::string_view>& from);
+    std::string_view findIOdatatype(std::string_view str);
+    bool containsCaseInsensitive(std::string_view haystack, std::string_view lowerNeedle);
+
+    // Buffer versions, out is overwritten
+    void findNumbers(std::string_view str, std::string& out);
+    void filterNumbers(std::string_view str, std::string& out);
+    void splitCharsFromNums(std::string_view str, std::string& chars, std::string& nums);
+    void toLowerCase(std::string_view str, std::string& out);
+    void removeCharactersFromStr(std::string_view str, const CharSet& chars, std::string& out);
+    void removeCharactersFromStr(std::string_view str, const CharSet& chars, std::string_view replacement, std::string& out);
+    void replacePlaceholderIf(std::string_view str, std::string_view placeholder, std::string_view replacement, std::string& out,
+                              char oChar = '{', char cChar = '}');
+} // namespace TextView
+} // namespace Utils
+} // namespace Mir
@@ -0,0 +1,90 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace Mir {
+    ThreadPool::ThreadPool(size_t threadCount, size_t maxQueued) : m_maxQueued(maxQueued) {
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        m_workers.reserve(threadCount);
+        for (size_t i = 0; i < threadCount; i++) {
+            m_workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stopping = true;
+        }
+        m_taskAvailable.notify_all();
+        m_spaceAvailable.notify_all();
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    bool ThreadPool::trySubmit(Task task) {
+        {
+            std::lock_guard lock(m_mutex);
+            if (m_stopping || (m_maxQueued != 0 && m_queue.size() >= m_maxQueued)) {
+                return false;
+            }
+            m_queue.push_back(std::move(task));
+        }
+        m_taskAvailable.notify_one();
+        return true;
+    }
+
+    void ThreadPool::submit(Task task) {
+        {
+            std::unique_lock lock(m_mutex);
+            m_spaceAvailable.wait(lock, [this] {
+                return m_stopping || m_maxQueued == 0 || m_queue.size() < m_maxQueued;
+            });
+            if (m_stopping) {
+                return;
+            }
+            m_queue.push_back(std::move(task));
+        }
+        m_taskAvailable.notify_one();
+    }
+
+    void ThreadPool::waitIdle() {
+        std::unique_lock lock(m_mutex);
+        m_idle.wait(lock, [this] { return m_queue.empty() && m_running == 0; });
+    }
+
+    size_t ThreadPool::getQueuedCount() const {
+        std::lock_guard lock(m_mutex);
+        return m_queue.size();
+    }
+
+    void ThreadPool::workerLoop() {
+        while (true) {
+            Task task;
+            {
+                std::unique_lock lock(m_mutex);
+                m_taskAvailable.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+                // Queued work is finished before stopping so nothing submitted is silently lost
+                if (m_queue.empty()) {
+                    return;
+                }
+                task = std::move(m_queue.front());
+                m_queue.pop_front();
+                m_running++;
+            }
+            m_spaceAvailable.notify_one();
+
+            task();
+
+            {
+                std::lock_guard lock(m_mutex);
+                m_running--;
+                if (m_queue.empty() && m_running == 0) {
+                    m_idle.notify_all();
+                }
+            }
+        }
+    }
+} // namespace Mir
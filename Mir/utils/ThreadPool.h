@@ -0,0 +1,45 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Mir {
+    // Fixed size worker pool with an optionally bounded FIFO queue.
+    class ThreadPool {
+    public:
+        using Task = std::function<void()>;
+
+        // threadCount 0 = hardware concurrency, maxQueued 0 = unbounded
+        explicit ThreadPool(size_t threadCount = 0, size_t maxQueued = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Returns false instead of blocking when the queue is full, safe to call from the UI thread
+        bool trySubmit(Task task);
+        // Blocks while the queue is full
+        void submit(Task task);
+        // Blocks until the queue is empty and no task is running
+        void waitIdle();
+
+        size_t getThreadCount() const { return m_workers.size(); }
+        size_t getQueuedCount() const;
+
+    private:
+        std::vector<std::thread> m_workers;
+        std::deque<Task> m_queue;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_taskAvailable;
+        std::condition_variable m_spaceAvailable;
+        std::condition_variable m_idle;
+        size_t m_maxQueued = 0;
+        size_t m_running = 0;
+        bool m_stopping = false;
+
+        void workerLoop();
+    };
+} // namespace Mir
@@ -1,5 +1,14 @@
 #include "Utils.h"
+#include "Profiler.h"
 #include <algorithm>
+#include <bit>
+#include <cwctype>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIR_UTILS_SSE2 1
+#endif
+
 #define MIR_ERROR 
 #define MIR_WARN
 
@@ -28,6 +37,7 @@ namespace Mir {
             }
 
             std::vector<std::vector<std::string>> readCsv(const std::filesystem::path& _filepath) {
+                MIR_PROFILE_SCOPE("Utils::File::readCsv");
                 std::vector<std::vector<std::string>> result;
                 std::ifstream file(_filepath);
                 if (!file.is_open()) {
@@ -128,6 +138,10 @@ namespace Mir {
             }
 
             std::vector<std::string> readLines(const std::filesystem::path& filepath) {
+                MIR_PROFILE_SCOPE("Utils::File::readLines");
+                // Streamed rather than mapped: works for files that report size 0 (/proc) and
+                // for files that shrink while being read. LineIndex is the fast path for
+                // regular files.
                 std::ifstream file = openFile(filepath);
 
                 if (!file.is_open()) {
@@ -148,6 +162,7 @@ namespace Mir {
             }
 
             std::string readFile(const std::filesystem::path& filepath) {
+                MIR_PROFILE_SCOPE("Utils::File::readFile");
                 std::ifstream file = openFile(filepath);
 
                 if (!file.is_open()) {
@@ -157,6 +172,16 @@ namespace Mir {
                 return readFile(file);
             }
 
+
+            std::string toUtf8(const std::filesystem::path& filepath) {
+#ifdef _WIN32
+                std::u8string utf8 = filepath.u8string();
+                return std::string(reinterpret_cast<const char*>(utf8.data()), utf8.size());
+#else
+                return filepath.native();
+#endif
+            }
+
         }  // namespace File
         namespace Text {
             std::vector<std::string> splitAt(const std::string& line, char delimiter) {
@@ -405,6 +430,147 @@ namespace Mir {
                 }
                 return result;
             }
+
+            bool isValidUtf8(std::string_view _str, bool _allowIncompleteTail) {
+                const auto* data = reinterpret_cast<const unsigned char*>(_str.data());
+                const size_t size = _str.size();
+                size_t i = 0;
+
+                while (i < size) {
+#ifdef MIR_UTILS_SSE2
+                    // Skip ASCII 16 bytes at a time, high bit set in any byte ends the run
+                    while (i + 16 <= size) {
+                        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+                        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(chunk));
+                        if (mask != 0) {
+                            i += std::countr_zero(mask);
+                            break;
+                        }
+                        i += 16;
+                    }
+                    if (i >= size) {
+                        break;
+                    }
+#endif
+                    unsigned char c = data[i];
+                    if (c < 0x80) {
+                        i++;
+                        continue;
+                    }
+
+                    size_t length;
+                    unsigned char low = 0x80, high = 0xBF; // allowed range of the second byte
+                    if (c >= 0xC2 && c <= 0xDF) {
+                        length = 2;
+                    } else if (c >= 0xE0 && c <= 0xEF) {
+                        length = 3;
+                        if (c == 0xE0) low = 0xA0;       // overlong
+                        else if (c == 0xED) high = 0x9F; // surrogates
+                    } else if (c >= 0xF0 && c <= 0xF4) {
+                        length = 4;
+                        if (c == 0xF0) low = 0x90;       // overlong
+                        else if (c == 0xF4) high = 0x8F; // above U+10FFFF
+                    } else {
+                        return false;
+                    }
+
+                    for (size_t k = 1; k < length; k++) {
+                        if (i + k >= size) {
+                            return _allowIncompleteTail;
+                        }
+                        unsigned char next = data[i + k];
+                        unsigned char min = k == 1 ? low : 0x80;
+                        unsigned char max = k == 1 ? high : 0xBF;
+                        if (next < min || next > max) {
+                            return false;
+                        }
+                    }
+                    i += length;
+                }
+                return true;
+            }
+
+            std::string sanitizeUtf8(std::string_view _str) {
+                std::string result;
+                result.reserve(_str.size() + 8);
+                size_t pos = 0;
+                while (pos < _str.size()) {
+                    size_t start = pos;
+                    uint32_t cp = decodeUtf8(_str, pos);
+                    if (cp == 0xFFFD && !(pos - start == 3 && _str.substr(start, 3) == "\xEF\xBF\xBD")) {
+                        result += "\xEF\xBF\xBD";
+                    } else {
+                        result.append(_str.substr(start, pos - start));
+                    }
+                }
+                return result;
+            }
+
+            uint32_t decodeUtf8(std::string_view _str, size_t& _pos) {
+                const auto* data = reinterpret_cast<const unsigned char*>(_str.data());
+                unsigned char c = data[_pos];
+                if (c < 0x80) {
+                    _pos++;
+                    return c;
+                }
+
+                size_t length;
+                uint32_t cp;
+                unsigned char low = 0x80, high = 0xBF;
+                if (c >= 0xC2 && c <= 0xDF) {
+                    length = 2; cp = c & 0x1F;
+                } else if (c >= 0xE0 && c <= 0xEF) {
+                    length = 3; cp = c & 0x0F;
+                    if (c == 0xE0) low = 0xA0;
+                    else if (c == 0xED) high = 0x9F;
+                } else if (c >= 0xF0 && c <= 0xF4) {
+                    length = 4; cp = c & 0x07;
+                    if (c == 0xF0) low = 0x90;
+                    else if (c == 0xF4) high = 0x8F;
+                } else {
+                    _pos++;
+                    return 0xFFFD;
+                }
+
+                for (size_t k = 1; k < length; k++) {
+                    if (_pos + k >= _str.size()) {
+                        _pos++;
+                        return 0xFFFD;
+                    }
+                    unsigned char next = data[_pos + k];
+                    if (next < (k == 1 ? low : 0x80) || next > (k == 1 ? high : 0xBF)) {
+                        _pos++;
+                        return 0xFFFD;
+                    }
+                    cp = (cp << 6) | (next & 0x3F);
+                }
+                _pos += length;
+                return cp;
+            }
+
+            int compareCaseInsensitive(std::string_view _a, std::string_view _b) {
+                size_t i = 0, j = 0;
+                while (i < _a.size() && j < _b.size()) {
+                    unsigned char ca = static_cast<unsigned char>(_a[i]);
+                    unsigned char cb = static_cast<unsigned char>(_b[j]);
+                    uint32_t la, lb;
+                    if ((ca | cb) < 0x80) {
+                        la = (ca >= 'A' && ca <= 'Z') ? ca + 32 : ca;
+                        lb = (cb >= 'A' && cb <= 'Z') ? cb + 32 : cb;
+                        i++;
+                        j++;
+                    } else {
+                        la = static_cast<uint32_t>(std::towlower(static_cast<wint_t>(decodeUtf8(_a, i))));
+                        lb = static_cast<uint32_t>(std::towlower(static_cast<wint_t>(decodeUtf8(_b, j))));
+                    }
+                    if (la != lb) {
+                        return la < lb ? -1 : 1;
+                    }
+                }
+                if (i < _a.size()) return 1;
+                if (j < _b.size()) return -1;
+                return 0;
+            }
         }  // namespace Text
 
     }  // namespace Utils
@@ -4,11 +4,14 @@
 #include <fstream>
 #include <filesystem>
 #include <vector>
+#include <cstdint>
+#include <string_view>
 namespace Mir {
 namespace Utils{
     namespace File
     {
         std::ifstream openFile(const std::filesystem::path &filepath);
+        // One string per line. Prefer LineIndex (LineIndex.h) for big files, it keeps views into a mapping.
         std::vector<std::string> readLines(const std::filesystem::path& filepath);
         std::string readFile(const std::filesystem::path& filepath);
         std::vector<std::string> readLines(std::istream& stream);
@@ -17,6 +20,8 @@ namespace Utils{
         bool hasExtension(const std::filesystem::path& filepath, const std::string& extension);
         std::vector<std::vector<std::string>> readCsv(const std::filesystem::path& _filepath);
         std::vector<std::string> parseCsvLine(const std::string& line, char delimiter = ',');
+        // UTF-8 on every platform. POSIX paths are returned as their raw bytes, Windows paths are converted.
+        std::string toUtf8(const std::filesystem::path& filepath);
 
    
     } // namespace File
@@ -40,6 +45,14 @@ namespace Utils{
         std::vector<std::string> extractAllBetweenCurlyBraces(const std::string& str);
         std::string removeCharactersFromStr(const std::string& _str, const std::string_view _chars);
         std::string removeCharactersFromStr(const std::string& _str, const std::string_view _chars, const std::string& _replacement);
+        // ASCII runs are checked 16 bytes at a time. allowIncompleteTail accepts a sequence cut at the end (for file heads).
+        bool isValidUtf8(std::string_view _str, bool _allowIncompleteTail = false);
+        // Invalid sequences become U+FFFD, only call when isValidUtf8 failed
+        std::string sanitizeUtf8(std::string_view _str);
+        // Next code point starting at _pos, advances _pos. Invalid bytes decode as U+FFFD.
+        uint32_t decodeUtf8(std::string_view _str, size_t& _pos);
+        // Case insensitive, ASCII bytes are folded inline, other code points through towlower. No allocation.
+        int compareCaseInsensitive(std::string_view _a, std::string_view _b);
         
     } // namespace String
     